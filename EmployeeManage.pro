@@ -1,25 +1,70 @@
-QT       += core gui widgets sql
+QT       += core gui widgets sql concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
+# 回放报告里的分配次数：qmake CONFIG+=alloc_count（见 alloccount.h）
+alloc_count: DEFINES += EM_ALLOC_COUNT
+
+# 员工主索引默认用 AVL，打开下面这行改用 B+ 树（见 empindex.h）
+#DEFINES += EMP_INDEX_BPTREE
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    avl.cpp \
+    alloccount.cpp \
+    bptree.cpp \
     dbmanager.cpp \
+    deptimport.cpp \
+    deptsalary.cpp \
     depttree.cpp \
+    depttreemodel.cpp \
+    empcolumns.cpp \
+    empsort.cpp \
+    empstore.cpp \
+    filterexpr.cpp \
+    journal.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    memusage.cpp \
+    namearena.cpp \
+    pavl.cpp \
+    salaryhistory.cpp \
+    sessionrec.cpp \
+    parallelview.cpp \
+    sqlpager.cpp \
+    trace.cpp \
+    viewcache.cpp
 
 HEADERS += \
+    alloccount.h \
     avl.h \
+    bptree.h \
     dbmanager.h \
+    deptimport.h \
+    deptsalary.h \
     depttree.h \
-    mainwindow.h
+    depttreemodel.h \
+    empcolumns.h \
+    empindex.h \
+    empsort.h \
+    empstore.h \
+    filterexpr.h \
+    journal.h \
+    mainwindow.h \
+    memusage.h \
+    namearena.h \
+    pavl.h \
+    salaryhistory.h \
+    sessionrec.h \
+    shardedstore.h \
+    parallelview.h \
+    sqlpager.h \
+    trace.h \
+    viewcache.h
 
 FORMS += \
     mainwindow.ui
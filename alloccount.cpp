@@ -0,0 +1,82 @@
+#include "alloccount.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef EM_ALLOC_COUNT
+
+namespace {
+std::atomic<quint64> g_count{0};
+std::atomic<quint64> g_bytes{0};
+
+inline void note(size_t n) {
+    g_count.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(n, std::memory_order_relaxed);
+}
+} // namespace
+
+#if defined(__GLIBC__)
+
+//可执行文件里定义的 malloc 优先于 libc 的，Qt 等共享库里的调用也会走到这里
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t k, size_t n);
+void* __libc_realloc(void* p, size_t n);
+
+void* malloc(size_t n) {
+    note(n);
+    return __libc_malloc(n);
+}
+
+void* calloc(size_t k, size_t n) {
+    note(k * n);
+    return __libc_calloc(k, n);
+}
+
+void* realloc(void* p, size_t n) {
+    note(n);
+    return __libc_realloc(p, n);
+}
+}
+
+#else
+
+//非 glibc：只能接管 operator new（默认的 operator delete 与 std::malloc 配对即可）
+void* operator new(size_t n) {
+    note(n);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t n) {
+    note(n);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+#endif
+
+namespace AllocCount {
+bool available() { return true; }
+Snapshot now() {
+    Snapshot s;
+    s.count = g_count.load(std::memory_order_relaxed);
+    s.bytes = g_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+} // namespace AllocCount
+
+#else
+
+namespace AllocCount {
+bool available() { return false; }
+Snapshot now() { return Snapshot(); }
+} // namespace AllocCount
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <QtGlobal>
+
+//堆分配计数（回放报告用）：
+//  需要在 .pro 里打开 CONFIG += alloc_count（定义 EM_ALLOC_COUNT），默认不编进去
+//  glibc 下直接接管 malloc/calloc/realloc，Qt 容器内部的分配也能数到；其它平台只数 operator new
+namespace AllocCount {
+
+struct Snapshot {
+    quint64 count = 0; //累计分配次数
+    quint64 bytes = 0; //累计申请字节
+};
+
+//是否编译进了计数
+bool available();
+Snapshot now();
+
+} // namespace AllocCount
+
+#endif
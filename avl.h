@@ -2,59 +2,361 @@
 #include <QString>
 #include <QVector>
 #include <algorithm>
+#include <functional>
 
+#include "memusage.h"
+#include "namearena.h"
+
+//姓名存成全局 NameArena 里的句柄（驻留），拷贝员工不再分配/计数字符串；显示、导出、写库时才转成 QString
 struct Emp {
     int no;
-    QString name;
+    NameRef name;
     int depno;
     double salary;
+
+    QString nameString() const { return NameArena::global().toString(name); }
+    void setName(const QString& s) { name = NameArena::global().add(s); }
 };
 
-class AvlTree {
-public:
-    AvlTree() = default;
-    ~AvlTree() { clear(); }
+//增强信息策略：每个节点继承 Augment::Data，旋转/回溯时调用 Augment::update(n)
+//  NoAugment 是空基类，经空基类优化后不占空间、update 内联为空
+struct NoAugment {
+    struct Data {};
+    template <class Node>
+    static void update(Node*) {}
+};
 
-    AvlTree(const AvlTree&) = delete;
-    AvlTree& operator=(const AvlTree&) = delete;
+//子树大小：用于第 k 小 / 排名等顺序统计
+struct SubtreeSize {
+    struct Data { int cnt = 1; };
+    template <class Node>
+    static void update(Node* n) {
+        n->cnt = 1 + (n->l ? n->l->cnt : 0) + (n->r ? n->r->cnt : 0);
+    }
+};
 
-    bool insert(const Emp& e);
-    bool remove(int no);
-    Emp* find(int no);
+//子树求和：ValueOf 从元素中取出要累加的量（例如工资）
+template <class ValueOf>
+struct SubtreeSum {
+    struct Data { double sum = 0; };
+    template <class Node>
+    static void update(Node* n) {
+        n->sum = ValueOf()(n->v) + (n->l ? n->l->sum : 0) + (n->r ? n->r->sum : 0);
+    }
+};
 
-    QVector<Emp> inorder() const;
-    void clear();
+//多个增强信息叠加
+template <class A, class B>
+struct AugmentBoth {
+    struct Data : A::Data, B::Data {};
+    template <class Node>
+    static void update(Node* n) {
+        A::update(n);
+        B::update(n);
+    }
+};
 
-    int size() const { return m_size; }
+//通用 AVL 索引（header-only）：
+//  Value   存储的元素
+//  KeyOf   从元素取 key 的函数对象（编译期策略，无状态）
+//  Compare key 的严格弱序；若带 is_transparent（如 std::less<>），find/remove/range 支持异构 key
+//  Augment 子树增强信息（见上）
+template <class Value, class KeyOf, class Compare = std::less<>, class Augment = NoAugment>
+class AvlIndex {
+public:
+    using value_type = Value;
 
-private:
-    struct Node {
-        Emp e;
+    struct Node : Augment::Data {
+        Value v;
         Node* l = nullptr;
         Node* r = nullptr;
         int h = 1;
-        Node(const Emp& x): e(x) {}
+        explicit Node(const Value& x) : v(x) {}
     };
 
+    AvlIndex() = default;
+    ~AvlIndex() { clear(); }
+
+    AvlIndex(const AvlIndex&) = delete;
+    AvlIndex& operator=(const AvlIndex&) = delete;
+
+    bool insert(const Value& x) {
+        bool ok = false;
+        root = insertRec(root, x, ok);
+        if (ok) m_size++;
+        return ok;
+    }
+
+    template <class K>
+    bool remove(const K& key) {
+        bool ok = false;
+        root = removeRec(root, key, ok);
+        if (ok) m_size--;
+        return ok;
+    }
+
+    template <class K>
+    Value* find(const K& key) {
+        return const_cast<Value*>(static_cast<const AvlIndex*>(this)->find(key));
+    }
+
+    template <class K>
+    const Value* find(const K& key) const {
+        const Node* n = root;
+        while (n) {
+            if (less(key, KeyOf()(n->v))) n = n->l;
+            else if (less(KeyOf()(n->v), key)) n = n->r;
+            else return &n->v;
+        }
+        return nullptr;
+    }
+
+    QVector<Value> inorder() const {
+        QVector<Value> out;
+        out.reserve(m_size);
+        forEachInorder([&out](const Value& x) { out.push_back(x); });
+        return out;
+    }
+
+    //lo <= key <= hi，按 key 升序
+    template <class K>
+    QVector<Value> range(const K& lo, const K& hi) const {
+        QVector<Value> out;
+        forEachRange(lo, hi, [&out](const Value& x) { out.push_back(x); return true; });
+        return out;
+    }
+
+    void clear() {
+        freeRec(root);
+        root = nullptr;
+        m_size = 0;
+    }
+
+    int size() const { return m_size; }
+
+    //按 key 升序逐个访问，不产生拷贝
+    template <class F>
+    void forEachInorder(F&& f) const { forEachRec(root, f); }
+
+    //按 key 升序逐个原地修改；f 不得改动 key
+    template <class F>
+    void forEachMutable(F&& f) { forEachMutRec(root, f); }
+
+    //只访问 [lo, hi] 内的元素，f 返回 false 时提前结束
+    template <class K, class F>
+    void forEachRange(const K& lo, const K& hi, F&& f) const { rangeRec(root, lo, hi, f); }
+
+    //内存占用：元素本体计入 nodes，子指针/树高/增强信息计入 index，元素里的字符串按 seen 去重
+    MemUsage memoryUsage(MemAcct::Seen* seen = nullptr) const {
+        MemUsage u;
+        const qint64 node = qint64(sizeof(Node));
+        const qint64 payload = qint64(sizeof(Value));
+        u.nodes = m_size * payload;
+        u.index = m_size * (node - payload);
+        u.slack = m_size * (MemAcct::heapBlock(node) - node);
+        forEachInorder([&u, seen](const Value& x) { MemAcct::addValueExtra(x, &u, seen); });
+        return u;
+    }
+
+    //供增强查询（顺序统计等）直接从根往下走
+    const Node* rootNode() const { return root; }
+
+    //最小 / 最大元素，空树返回 nullptr
+    const Value* first() const {
+        const Node* n = root;
+        while (n && n->l) n = n->l;
+        return n ? &n->v : nullptr;
+    }
+    const Value* last() const {
+        const Node* n = root;
+        while (n && n->r) n = n->r;
+        return n ? &n->v : nullptr;
+    }
+
+    //key 严格小于 / 大于给定 key 的相邻元素，O(log n)；没有时返回 nullptr
+    template <class K>
+    const Value* lastBefore(const K& key) const {
+        const Value* best = nullptr;
+        for (const Node* n = root; n;) {
+            if (less(KeyOf()(n->v), key)) { best = &n->v; n = n->r; }
+            else n = n->l;
+        }
+        return best;
+    }
+    template <class K>
+    const Value* firstAfter(const K& key) const {
+        const Value* best = nullptr;
+        for (const Node* n = root; n;) {
+            if (less(key, KeyOf()(n->v))) { best = &n->v; n = n->l; }
+            else n = n->r;
+        }
+        return best;
+    }
+
+    //---- 以下需要 Augment 含 SubtreeSize ----
+
+    //第 k 小（0 起），越界返回 nullptr
+    const Value* kth(int k) const {
+        const Node* n = root;
+        while (n) {
+            int lc = n->l ? n->l->cnt : 0;
+            if (k < lc) n = n->l;
+            else if (k == lc) return &n->v;
+            else { k -= lc + 1; n = n->r; }
+        }
+        return nullptr;
+    }
+
+    //严格小于 key 的元素个数
+    template <class K>
+    int rankOf(const K& key) const {
+        int r = 0;
+        const Node* n = root;
+        while (n) {
+            if (less(KeyOf()(n->v), key)) {
+                r += 1 + (n->l ? n->l->cnt : 0);
+                n = n->r;
+            } else {
+                n = n->l;
+            }
+        }
+        return r;
+    }
+
+private:
     Node* root = nullptr;
     int m_size = 0;
 
+    template <class A, class B>
+    static bool less(const A& a, const B& b) { return Compare()(a, b); }
+
     static int height(Node* n) { return n ? n->h : 0; }
     static int balance(Node* n) { return n ? height(n->l) - height(n->r) : 0; }
     static void upd(Node* n) {
         if (!n) return;
         n->h = std::max(height(n->l), height(n->r)) + 1;
+        Augment::update(n);
     }
 
-    static Node* rotateRight(Node* y);
-    static Node* rotateLeft(Node* x);
-    static Node* rebalance(Node* n);
+    static Node* rotateRight(Node* y) {
+        Node* x = y->l;
+        Node* T2 = x->r;
+        x->r = y;
+        y->l = T2;
+        upd(y);
+        upd(x);
+        return x;
+    }
+
+    static Node* rotateLeft(Node* x) {
+        Node* y = x->r;
+        Node* T2 = y->l;
+        y->l = x;
+        x->r = T2;
+        upd(x);
+        upd(y);
+        return y;
+    }
+
+    static Node* rebalance(Node* n) {
+        upd(n);
+        int b = balance(n);
+
+        // LL
+        if (b > 1 && balance(n->l) >= 0) return rotateRight(n);
+        // LR
+        if (b > 1 && balance(n->l) < 0) { n->l = rotateLeft(n->l); return rotateRight(n); }
+        // RR
+        if (b < -1 && balance(n->r) <= 0) return rotateLeft(n);
+        // RL
+        if (b < -1 && balance(n->r) > 0) { n->r = rotateRight(n->r); return rotateLeft(n); }
 
-    static Node* insertRec(Node* n, const Emp& e, bool& ok);
-    static Node* minNode(Node* n);
-    static Node* removeRec(Node* n, int no, bool& ok);
+        return n;
+    }
+
+    static Node* insertRec(Node* n, const Value& x, bool& ok) {
+        if (!n) {
+            ok = true;
+            Node* leaf = new Node(x);
+            upd(leaf);
+            return leaf;
+        }
+        if (less(KeyOf()(x), KeyOf()(n->v))) n->l = insertRec(n->l, x, ok);
+        else if (less(KeyOf()(n->v), KeyOf()(x))) n->r = insertRec(n->r, x, ok);
+        else { ok = false; return n; } // 重复 key
 
-    static Emp* findRec(Node* n, int no);
-    static void inorderRec(Node* n, QVector<Emp>& out);
-    static void freeRec(Node* n);
+        return rebalance(n);
+    }
+
+    static Node* minNode(Node* n) {
+        Node* cur = n;
+        while (cur && cur->l) cur = cur->l;
+        return cur;
+    }
+
+    template <class K>
+    static Node* removeRec(Node* n, const K& key, bool& ok) {
+        if (!n) { ok = false; return nullptr; }
+
+        if (less(key, KeyOf()(n->v))) n->l = removeRec(n->l, key, ok);
+        else if (less(KeyOf()(n->v), key)) n->r = removeRec(n->r, key, ok);
+        else {
+            ok = true;
+            // 0/1 child
+            if (!n->l || !n->r) {
+                Node* child = n->l ? n->l : n->r;
+                delete n;
+                return child;
+            }
+
+            Node* succ = minNode(n->r);
+            n->v = succ->v;
+            bool dummy = false;
+            n->r = removeRec(n->r, KeyOf()(n->v), dummy); //n->v 已是后继的拷贝
+        }
+
+        if (!n) return nullptr;
+        return rebalance(n);
+    }
+
+    static void freeRec(Node* n) {
+        if (!n) return;
+        freeRec(n->l);
+        freeRec(n->r);
+        delete n;
+    }
+
+    template <class F>
+    static void forEachRec(const Node* n, F& f) {
+        if (!n) return;
+        forEachRec(n->l, f);
+        f(n->v);
+        forEachRec(n->r, f);
+    }
+
+    template <class F>
+    static void forEachMutRec(Node* n, F& f) {
+        if (!n) return;
+        forEachMutRec(n->l, f);
+        f(n->v);
+        forEachMutRec(n->r, f);
+    }
+
+    template <class K, class F>
+    static bool rangeRec(const Node* n, const K& lo, const K& hi, F& f) {
+        if (!n) return true;
+        const auto& k = KeyOf()(n->v);
+        if (less(lo, k) && !rangeRec(n->l, lo, hi, f)) return false;
+        if (!less(k, lo) && !less(hi, k) && !f(n->v)) return false;
+        if (less(k, hi)) return rangeRec(n->r, lo, hi, f);
+        return true;
+    }
+};
+
+//员工按工号
+struct EmpNoKey {
+    int operator()(const Emp& e) const { return e.no; }
 };
+
+//员工主索引：与原来手写的 AvlTree 生成相同的代码（int 比较、无增强信息）
+using AvlTree = AvlIndex<Emp, EmpNoKey, std::less<int>>;
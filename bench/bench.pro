@@ -0,0 +1,26 @@
+QT       += core concurrent
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = EmployeeBench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    benchmain.cpp \
+    ../bptree.cpp \
+    ../empstore.cpp \
+    ../memusage.cpp \
+    ../namearena.cpp \
+    ../pavl.cpp
+
+HEADERS += \
+    ../avl.h \
+    ../bptree.h \
+    ../empstore.h \
+    ../memusage.h \
+    ../namearena.h \
+    ../pavl.h \
+    ../shardedstore.h
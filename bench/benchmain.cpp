@@ -0,0 +1,318 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "avl.h"
+#include "bptree.h"
+#include "empstore.h"
+#include "shardedstore.h"
+
+//员工索引基准：同一组随机工号分别喂给 AVL 和 B+ 树，比较各操作耗时
+//  EmployeeBench --index avl|bptree|all -n 1000000 [--shards 1,2,4,8] [--readers 1,2,4,8 --rw-ms 1000]
+//--shards 非空时另测按工号区间分片的存储（ShardedStore）：整体装载、过滤、汇总、导出各分片并行，单点操作走单个分片
+//--readers 非空时另测 ConcurrentEmpStore 的 N 读 1 写：每个读者数跑 --rw-ms 毫秒，报读写吞吐，
+//  并检查读到的数据：该在的工号没读到、字段不对、同一批写入的两条只看到一半都算错，有错时退出码非 0
+
+namespace {
+
+//结果写到这里，防止被编译器当成死代码优化掉
+volatile double g_sink = 0;
+
+QTextStream& out() {
+    static QTextStream s(stdout);
+    return s;
+}
+
+struct Timer {
+    QElapsedTimer t;
+    Timer() { t.start(); }
+    double ms() const { return t.nsecsElapsed() / 1e6; }
+};
+
+void report(const char* index, const char* op, int count, double ms) {
+    out() << QString("%1 %2 %3 ops %4 ms %5 ns/op")
+                 .arg(QString::fromLatin1(index), -8)
+                 .arg(QString::fromLatin1(op), -10)
+                 .arg(count, 9)
+                 .arg(ms, 10, 'f', 2)
+                 .arg(count > 0 ? ms * 1e6 / count : 0.0, 9, 'f', 1)
+          << "\n";
+    out().flush();
+}
+
+Emp makeEmp(int no) {
+    Emp e;
+    e.no = no;
+    e.setName(QStringLiteral("员工"));
+    e.depno = no % 97 + 1;
+    e.salary = 3000 + no % 20000;
+    return e;
+}
+
+template <class Index>
+void runIndex(const char* name, const QVector<int>& keys, const QVector<int>& probes) {
+    Index idx;
+
+    {
+        Timer t;
+        for (int no : keys) idx.insert(makeEmp(no));
+        report(name, "insert", keys.size(), t.ms());
+    }
+
+    {
+        Timer t;
+        qint64 hit = 0;
+        for (int no : probes) hit += idx.find(no) ? 1 : 0;
+        report(name, "find", probes.size(), t.ms());
+        g_sink = double(hit);
+    }
+
+    {
+        Timer t;
+        double sum = 0;
+        idx.forEachInorder([&sum](const Emp& e) { sum += e.salary; });
+        report(name, "scan", idx.size(), t.ms());
+        g_sink = sum;
+    }
+
+    {
+        //分页式区间扫描：每次取 100 条
+        Timer t;
+        qint64 rows = 0;
+        for (int i = 0; i < 10000; ++i) {
+            int lo = probes[i % probes.size()];
+            int got = 0;
+            idx.forEachRange(lo, INT_MAX, [&](const Emp&) { ++rows; return ++got < 100; });
+        }
+        report(name, "range100", 10000, t.ms());
+        g_sink = double(rows);
+    }
+
+    {
+        Timer t;
+        const int half = keys.size() / 2;
+        for (int i = 0; i < half; ++i) idx.remove(keys[i]);
+        report(name, "remove", half, t.ms());
+    }
+}
+
+template <class Index>
+void runSharded(const char* base, int shards, const QVector<int>& keys, const QVector<int>& probes) {
+    const QByteArray name = QString("%1/s%2").arg(QString::fromLatin1(base)).arg(shards).toLatin1();
+    const char* nm = name.constData();
+
+    QVector<Emp> emps;
+    emps.reserve(keys.size());
+    for (int no : keys) emps.push_back(makeEmp(no));
+
+    ShardedStore<Index> store(shards);
+    {
+        Timer t;
+        store.bulkLoad(emps);
+        report(nm, "bulkload", emps.size(), t.ms());
+    }
+    emps = QVector<Emp>();
+
+    {
+        Timer t;
+        qint64 hit = 0;
+        for (int no : probes) hit += store.find(no) ? 1 : 0;
+        report(nm, "find", probes.size(), t.ms());
+        g_sink = double(hit);
+    }
+
+    {
+        Timer t;
+        const QVector<Emp> rows = store.filter([](const Emp& e) { return e.salary >= 20000 && e.depno % 3 == 0; });
+        report(nm, "filter", store.size(), t.ms());
+        g_sink = double(rows.size());
+    }
+
+    {
+        Timer t;
+        const auto st = store.salaryStats();
+        report(nm, "aggregate", store.size(), t.ms());
+        g_sink = st.sum;
+    }
+
+    {
+        Timer t;
+        const QVector<Emp> all = store.inorder();
+        report(nm, "export", all.size(), t.ms());
+        g_sink = double(all.size());
+    }
+
+    {
+        Timer t;
+        const int half = keys.size() / 2;
+        for (int i = 0; i < half; ++i) store.remove(keys[i]);
+        report(nm, "remove", half, t.ms());
+    }
+}
+
+//N 读 1 写：
+//  工号 1..n 一直存在，写者每次用 writeBatch 把相邻一对（2k-1, 2k）的工资改成同一个新版本号；
+//  另有 kVolatile 个工号 n+1.. 由写者反复增删
+//  读者取快照查一对工号：缺了算丢失，字段与 makeEmp 对不上或一对工资不同（看到半个批次）算无效；
+//  再按值查一个增删中的工号，查到时同样校验；快照大小与版本号也要在范围内、不倒退
+bool runConcurrent(int readers, int n, int ms, quint32 seed) {
+    const QByteArray name = QString("cstore/r%1").arg(readers).toLatin1();
+    const char* nm = name.constData();
+    const int kVolatile = 1024;
+    const NameRef empName = makeEmp(1).name;
+    auto stressEmp = [](int no, qint64 ver) {
+        Emp e = makeEmp(no);
+        e.salary = 3000 + double(ver);
+        return e;
+    };
+    auto valid = [&](const Emp& e, int no) {
+        return e.no == no && e.depno == no % 97 + 1 && e.salary >= 3000 && e.name == empName;
+    };
+    auto partner = [n](int no) { return no % 2 ? std::min(no + 1, n) : no - 1; };
+
+    ConcurrentEmpStore store;
+    {
+        QVector<Emp> emps;
+        emps.reserve(n);
+        for (int no = 1; no <= n; ++no) emps.push_back(stressEmp(no, 0));
+        store.publish(PersistentAvl::fromSorted(emps));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<qint64> reads{0}, lost{0}, invalid{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(seed + quint32(t) + 1);
+            std::uniform_int_distribution<int> stable(1, n), vol(n + 1, n + kVolatile);
+            qint64 r = 0, l = 0, bad = 0;
+            quint64 lastGen = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const quint64 gen = store.generation();
+                if (gen < lastGen) ++bad;
+                lastGen = gen;
+
+                const ConcurrentEmpStore::Snapshot s = store.snapshot();
+                if (s->size() < n || s->size() > n + kVolatile) ++bad;
+                const int a = stable(rng), b = partner(a);
+                const Emp* ea = s->find(a);
+                const Emp* eb = s->find(b);
+                if (!ea || !eb) ++l;
+                else if (!valid(*ea, a) || !valid(*eb, b) || ea->salary != eb->salary) ++bad;
+
+                const int v = vol(rng);
+                Emp ev;
+                if (store.find(v, &ev) && !valid(ev, v)) ++bad;
+                r += 3;
+            }
+            reads += r;
+            lost += l;
+            invalid += bad;
+        });
+    }
+
+    qint64 writes = 0;
+    Timer t;
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> stable(1, n), vol(n + 1, n + kVolatile);
+        qint64 ver = 0;
+        while (t.ms() < ms) {
+            if (writes % 4 != 3) {
+                const int a = stable(rng), b = partner(a);
+                ++ver;
+                store.writeBatch([&](PersistentAvl& v) {
+                    v = v.update(stressEmp(a, ver));
+                    if (b != a) v = v.update(stressEmp(b, ver));
+                });
+            } else {
+                const int no = vol(rng);
+                store.writeBatch([&](PersistentAvl& v) {
+                    bool removed = false;
+                    v = v.remove(no, &removed);
+                    if (!removed) v = v.insert(stressEmp(no, ver));
+                });
+            }
+            ++writes;
+        }
+    }
+    stop = true;
+    for (auto& th : threads) th.join();
+    const double elapsed = t.ms();
+
+    report(nm, "read", int(std::min<qint64>(reads, INT_MAX)), elapsed * readers);
+    report(nm, "write", int(writes), elapsed);
+    out() << QString("%1 %2 reads/s %3 writes/s lost %4 invalid %5")
+                 .arg(QString::fromLatin1(nm), -8)
+                 .arg(reads * 1000.0 / elapsed, 0, 'f', 0)
+                 .arg(writes * 1000.0 / elapsed, 0, 'f', 0)
+                 .arg(lost.load())
+                 .arg(invalid.load())
+          << "\n";
+    out().flush();
+    return lost == 0 && invalid == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("EmployeeManage index benchmark");
+    parser.addHelpOption();
+    QCommandLineOption optIndex(QStringList() << "index", "avl | bptree | all", "name", "all");
+    QCommandLineOption optN(QStringList() << "n", "number of employees", "count", "1000000");
+    QCommandLineOption optSeed(QStringList() << "seed", "random seed", "seed", "42");
+    QCommandLineOption optShards(QStringList() << "shards", "comma-separated shard counts for ShardedStore (empty to skip)",
+                                 "list", "1,2,4,8");
+    parser.addOption(optIndex);
+    parser.addOption(optN);
+    parser.addOption(optSeed);
+    QCommandLineOption optReaders(QStringList() << "readers",
+                                  "comma-separated reader thread counts for the ConcurrentEmpStore N-readers/1-writer test "
+                                  "(empty to skip)",
+                                  "list", "1,2,4,8");
+    QCommandLineOption optRwMs(QStringList() << "rw-ms", "duration of each N-readers/1-writer run", "ms", "1000");
+    parser.addOption(optShards);
+    parser.addOption(optReaders);
+    parser.addOption(optRwMs);
+    parser.process(app);
+
+    const QString index = parser.value(optIndex);
+    const int n = std::max(1, parser.value(optN).toInt());
+
+    std::mt19937 rng(parser.value(optSeed).toUInt());
+    QVector<int> keys(n);
+    for (int i = 0; i < n; ++i) keys[i] = i + 1;
+    std::shuffle(keys.begin(), keys.end(), rng);
+    QVector<int> probes = keys;
+    std::shuffle(probes.begin(), probes.end(), rng);
+
+    if (index == "avl" || index == "all") runIndex<AvlTree>("avl", keys, probes);
+    if (index == "bptree" || index == "all") runIndex<BPlusTree>("bptree", keys, probes);
+
+    for (const QString& s : parser.value(optShards).split(',', Qt::SkipEmptyParts)) {
+        const int shards = s.trimmed().toInt();
+        if (shards <= 0) continue;
+        if (index == "avl" || index == "all") runSharded<AvlTree>("avl", shards, keys, probes);
+        if (index == "bptree" || index == "all") runSharded<BPlusTree>("bptree", shards, keys, probes);
+    }
+
+    bool ok = true;
+    const int rwMs = std::max(1, parser.value(optRwMs).toInt());
+    for (const QString& s : parser.value(optReaders).split(',', Qt::SkipEmptyParts)) {
+        const int readers = s.trimmed().toInt();
+        if (readers > 0) ok = runConcurrent(readers, n, rwMs, parser.value(optSeed).toUInt()) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+#include "bptree.h"
+
+#include <algorithm>
+
+int BPlusTree::lowerBound(const int* keys, int n, int no) {
+    return int(std::lower_bound(keys, keys + n, no) - keys);
+}
+
+int BPlusTree::childIndex(const Inner* p, int no) {
+    return int(std::upper_bound(p->keys, p->keys + p->n, no) - p->keys);
+}
+
+const BPlusTree::Leaf* BPlusTree::leafFor(int no) const {
+    const Node* n = m_root;
+    if (!n) return nullptr;
+    while (!n->leaf) {
+        const Inner* p = static_cast<const Inner*>(n);
+        n = p->child[childIndex(p, no)];
+    }
+    return static_cast<const Leaf*>(n);
+}
+
+const Emp* BPlusTree::find(int no) const {
+    const Leaf* l = leafFor(no);
+    if (!l) return nullptr;
+    int i = lowerBound(l->keys, l->n, no);
+    if (i < l->n && l->keys[i] == no) return &l->vals[i];
+    return nullptr;
+}
+
+Emp* BPlusTree::find(int no) {
+    return const_cast<Emp*>(static_cast<const BPlusTree*>(this)->find(no));
+}
+
+//插入后若节点超过 kCap，就分裂成两半，把右半的下界和右节点交给上层
+bool BPlusTree::insertRec(Node* n, const Emp& e, int& upKey, Node*& upNode) {
+    upNode = nullptr;
+
+    if (n->leaf) {
+        Leaf* l = static_cast<Leaf*>(n);
+        int pos = lowerBound(l->keys, l->n, e.no);
+        if (pos < l->n && l->keys[pos] == e.no) return false; // 重复 no
+
+        for (int i = l->n; i > pos; --i) {
+            l->keys[i] = l->keys[i - 1];
+            l->vals[i] = l->vals[i - 1];
+        }
+        l->keys[pos] = e.no;
+        l->vals[pos] = e;
+        l->n++;
+
+        if (l->n > kCap) {
+            Leaf* r = new Leaf;
+            int keep = l->n / 2;
+            r->n = l->n - keep;
+            for (int i = 0; i < r->n; ++i) {
+                r->keys[i] = l->keys[keep + i];
+                r->vals[i] = l->vals[keep + i];
+                l->vals[keep + i] = Emp(); //释放被搬走的 name
+            }
+            l->n = keep;
+
+            r->next = l->next;
+            r->prev = l;
+            if (l->next) l->next->prev = r;
+            l->next = r;
+
+            upKey = r->keys[0];
+            upNode = r;
+        }
+        return true;
+    }
+
+    Inner* p = static_cast<Inner*>(n);
+    int ci = childIndex(p, e.no);
+    int childKey = 0;
+    Node* childNew = nullptr;
+    if (!insertRec(p->child[ci], e, childKey, childNew)) return false;
+    if (!childNew) return true;
+
+    for (int i = p->n; i > ci; --i) {
+        p->keys[i] = p->keys[i - 1];
+        p->child[i + 1] = p->child[i];
+    }
+    p->keys[ci] = childKey;
+    p->child[ci + 1] = childNew;
+    p->n++;
+
+    if (p->n > kCap) {
+        Inner* r = new Inner;
+        int mid = p->n / 2;
+        upKey = p->keys[mid];
+        r->n = p->n - mid - 1;
+        for (int i = 0; i < r->n; ++i) r->keys[i] = p->keys[mid + 1 + i];
+        for (int i = 0; i <= r->n; ++i) r->child[i] = p->child[mid + 1 + i];
+        p->n = mid;
+        upNode = r;
+    }
+    return true;
+}
+
+bool BPlusTree::insert(const Emp& e) {
+    if (!m_root) {
+        Leaf* l = new Leaf;
+        m_root = l;
+        m_first = l;
+    }
+
+    int upKey = 0;
+    Node* upNode = nullptr;
+    if (!insertRec(m_root, e, upKey, upNode)) return false;
+
+    if (upNode) { //根分裂：树长高一层
+        Inner* r = new Inner;
+        r->n = 1;
+        r->keys[0] = upKey;
+        r->child[0] = m_root;
+        r->child[1] = upNode;
+        m_root = r;
+    }
+    m_size++;
+    return true;
+}
+
+//p->child[i] 不足 kMin 时：先向左/右兄弟借一个，借不到就与兄弟合并
+void BPlusTree::fixChild(Inner* p, int i) {
+    Node* c = p->child[i];
+    Node* left = (i > 0) ? p->child[i - 1] : nullptr;
+    Node* right = (i < p->n) ? p->child[i + 1] : nullptr;
+
+    if (c->leaf) {
+        Leaf* lc = static_cast<Leaf*>(c);
+        Leaf* ll = static_cast<Leaf*>(left);
+        Leaf* lr = static_cast<Leaf*>(right);
+
+        if (ll && ll->n > kMin) {
+            for (int k = lc->n; k > 0; --k) {
+                lc->keys[k] = lc->keys[k - 1];
+                lc->vals[k] = lc->vals[k - 1];
+            }
+            lc->keys[0] = ll->keys[ll->n - 1];
+            lc->vals[0] = ll->vals[ll->n - 1];
+            ll->vals[ll->n - 1] = Emp();
+            ll->n--;
+            lc->n++;
+            p->keys[i - 1] = lc->keys[0];
+            return;
+        }
+        if (lr && lr->n > kMin) {
+            lc->keys[lc->n] = lr->keys[0];
+            lc->vals[lc->n] = lr->vals[0];
+            lc->n++;
+            for (int k = 0; k + 1 < lr->n; ++k) {
+                lr->keys[k] = lr->keys[k + 1];
+                lr->vals[k] = lr->vals[k + 1];
+            }
+            lr->n--;
+            lr->vals[lr->n] = Emp();
+            p->keys[i] = lr->keys[0];
+            return;
+        }
+
+        //合并：统一成 a <- b，再把 b 从父节点摘掉
+        int sep = ll ? i - 1 : i;
+        Leaf* a = ll ? ll : lc;
+        Leaf* b = ll ? lc : lr;
+        for (int k = 0; k < b->n; ++k) {
+            a->keys[a->n + k] = b->keys[k];
+            a->vals[a->n + k] = b->vals[k];
+        }
+        a->n += b->n;
+        a->next = b->next;
+        if (b->next) b->next->prev = a;
+        delete b;
+
+        for (int k = sep; k + 1 < p->n; ++k) {
+            p->keys[k] = p->keys[k + 1];
+            p->child[k + 1] = p->child[k + 2];
+        }
+        p->n--;
+        return;
+    }
+
+    Inner* ic = static_cast<Inner*>(c);
+    Inner* il = static_cast<Inner*>(left);
+    Inner* ir = static_cast<Inner*>(right);
+
+    if (il && il->n > kMin) {
+        for (int k = ic->n; k > 0; --k) ic->keys[k] = ic->keys[k - 1];
+        for (int k = ic->n + 1; k > 0; --k) ic->child[k] = ic->child[k - 1];
+        ic->keys[0] = p->keys[i - 1];
+        ic->child[0] = il->child[il->n];
+        p->keys[i - 1] = il->keys[il->n - 1];
+        il->n--;
+        ic->n++;
+        return;
+    }
+    if (ir && ir->n > kMin) {
+        ic->keys[ic->n] = p->keys[i];
+        ic->child[ic->n + 1] = ir->child[0];
+        ic->n++;
+        p->keys[i] = ir->keys[0];
+        for (int k = 0; k + 1 < ir->n; ++k) ir->keys[k] = ir->keys[k + 1];
+        for (int k = 0; k < ir->n; ++k) ir->child[k] = ir->child[k + 1];
+        ir->n--;
+        return;
+    }
+
+    int sep = il ? i - 1 : i;
+    Inner* a = il ? il : ic;
+    Inner* b = il ? ic : ir;
+    a->keys[a->n] = p->keys[sep]; //父节点的分隔 key 下沉
+    for (int k = 0; k < b->n; ++k) a->keys[a->n + 1 + k] = b->keys[k];
+    for (int k = 0; k <= b->n; ++k) a->child[a->n + 1 + k] = b->child[k];
+    a->n += 1 + b->n;
+    delete b;
+
+    for (int k = sep; k + 1 < p->n; ++k) {
+        p->keys[k] = p->keys[k + 1];
+        p->child[k + 1] = p->child[k + 2];
+    }
+    p->n--;
+}
+
+bool BPlusTree::removeRec(Node* n, int no) {
+    if (n->leaf) {
+        Leaf* l = static_cast<Leaf*>(n);
+        int pos = lowerBound(l->keys, l->n, no);
+        if (pos >= l->n || l->keys[pos] != no) return false;
+        for (int i = pos; i + 1 < l->n; ++i) {
+            l->keys[i] = l->keys[i + 1];
+            l->vals[i] = l->vals[i + 1];
+        }
+        l->n--;
+        l->vals[l->n] = Emp();
+        return true;
+    }
+
+    Inner* p = static_cast<Inner*>(n);
+    int ci = childIndex(p, no);
+    if (!removeRec(p->child[ci], no)) return false;
+    if (p->child[ci]->n < kMin) fixChild(p, ci);
+    return true;
+}
+
+bool BPlusTree::remove(int no) {
+    if (!m_root) return false;
+    if (!removeRec(m_root, no)) return false;
+    m_size--;
+
+    //根收缩
+    if (!m_root->leaf && m_root->n == 0) {
+        Inner* old = static_cast<Inner*>(m_root);
+        m_root = old->child[0];
+        delete old;
+    } else if (m_root->leaf && m_root->n == 0) {
+        delete static_cast<Leaf*>(m_root);
+        m_root = nullptr;
+        m_first = nullptr;
+    }
+    return true;
+}
+
+QVector<Emp> BPlusTree::inorder() const {
+    QVector<Emp> out;
+    out.reserve(m_size);
+    forEachInorder([&out](const Emp& e) { out.push_back(e); });
+    return out;
+}
+
+QVector<Emp> BPlusTree::range(int lo, int hi) const {
+    QVector<Emp> out;
+    forEachRange(lo, hi, [&out](const Emp& e) { out.push_back(e); return true; });
+    return out;
+}
+
+void BPlusTree::freeRec(Node* n) {
+    if (!n) return;
+    if (n->leaf) {
+        delete static_cast<Leaf*>(n);
+        return;
+    }
+    Inner* p = static_cast<Inner*>(n);
+    for (int i = 0; i <= p->n; ++i) freeRec(p->child[i]);
+    delete p;
+}
+
+void BPlusTree::clear() {
+    freeRec(m_root);
+    m_root = nullptr;
+    m_first = nullptr;
+    m_size = 0;
+}
+
+int BPlusTree::height() const {
+    int h = 0;
+    for (const Node* n = m_root; n; ++h) {
+        n = n->leaf ? nullptr : static_cast<const Inner*>(n)->child[0];
+    }
+    return h;
+}
+
+MemUsage BPlusTree::memoryUsage(MemAcct::Seen* seen) const {
+    MemUsage u;
+    const qint64 leafBytes = qint64(sizeof(Leaf));
+    const qint64 innerBytes = qint64(sizeof(Inner));
+
+    for (const Leaf* l = m_first; l; l = l->next) {
+        const qint64 used = qint64(l->n) * qint64(sizeof(Emp));
+        const qint64 empty = qint64(kCap + 1 - l->n) * qint64(sizeof(Emp) + sizeof(int));
+        u.nodes += used;
+        u.index += leafBytes - used - empty;
+        u.slack += empty + MemAcct::heapBlock(leafBytes) - leafBytes;
+        for (int i = 0; i < l->n; ++i) MemAcct::addValueExtra(l->vals[i], &u, seen);
+    }
+
+    //内部节点整块都是索引开销
+    QVector<const Node*> stack;
+    if (m_root && !m_root->leaf) stack.push_back(m_root);
+    while (!stack.isEmpty()) {
+        const Inner* p = static_cast<const Inner*>(stack.takeLast());
+        u.index += innerBytes;
+        u.slack += MemAcct::heapBlock(innerBytes) - innerBytes;
+        for (int i = 0; i <= p->n; ++i) {
+            if (!p->child[i]->leaf) stack.push_back(p->child[i]);
+        }
+    }
+    return u;
+}
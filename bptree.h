@@ -0,0 +1,107 @@
+#ifndef BPTREE_H
+#define BPTREE_H
+
+#include <QVector>
+
+#include "avl.h"
+#include "memusage.h"
+
+//B+ 树员工索引（按 no）：
+//  宽节点（每个节点最多 kCap 个 key），key 连续存放，查找一次只碰 O(log_64 n) 个节点
+//  员工数据只存在叶子里，叶子之间双向链接，区间扫描/分页/导出顺序走叶子链
+//  接口与 AvlTree 保持一致，可以直接替换（见 empindex.h）
+class BPlusTree {
+public:
+    static const int kCap = 64;
+
+    BPlusTree() = default;
+    ~BPlusTree() { clear(); }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    bool insert(const Emp& e);
+    bool remove(int no);
+    Emp* find(int no);
+    const Emp* find(int no) const;
+
+    QVector<Emp> inorder() const;
+    //lo <= no <= hi，按 no 升序
+    QVector<Emp> range(int lo, int hi) const;
+    void clear();
+
+    int size() const { return m_size; }
+
+    template <class F>
+    void forEachInorder(F&& f) const {
+        for (const Leaf* l = m_first; l; l = l->next) {
+            for (int i = 0; i < l->n; ++i) f(l->vals[i]);
+        }
+    }
+
+    //顺序原地修改；f 不得改动 no
+    template <class F>
+    void forEachMutable(F&& f) {
+        for (Leaf* l = m_first; l; l = l->next) {
+            for (int i = 0; i < l->n; ++i) f(l->vals[i]);
+        }
+    }
+
+    //从 lo 所在叶子开始顺序扫描，f 返回 false 时提前结束
+    template <class F>
+    void forEachRange(int lo, int hi, F&& f) const {
+        const Leaf* l = leafFor(lo);
+        if (!l) return;
+        int i = lowerBound(l->keys, l->n, lo);
+        for (; l; l = l->next, i = 0) {
+            for (; i < l->n; ++i) {
+                if (l->keys[i] > hi) return;
+                if (!f(l->vals[i])) return;
+            }
+        }
+    }
+
+    int height() const;
+
+    //内存占用：叶子空槽计入 slack，key 数组/孩子指针/叶子链计入 index
+    MemUsage memoryUsage(MemAcct::Seen* seen = nullptr) const;
+
+private:
+    //key/孩子数组多留一个位置：先插入再分裂，逻辑简单
+    struct Node {
+        bool leaf;
+        int n = 0;
+        int keys[kCap + 1];
+        explicit Node(bool isLeaf) : leaf(isLeaf) {}
+    };
+
+    struct Leaf : Node {
+        Emp vals[kCap + 1];
+        Leaf* prev = nullptr;
+        Leaf* next = nullptr;
+        Leaf() : Node(true) {}
+    };
+
+    //keys[i] 是 child[i+1] 子树的最小下界：child[i] 中的 key < keys[i] <= child[i+1] 中的 key
+    struct Inner : Node {
+        Node* child[kCap + 2];
+        Inner() : Node(false) {}
+    };
+
+    static const int kMin = kCap / 2;
+
+    Node* m_root = nullptr;
+    Leaf* m_first = nullptr;
+    int m_size = 0;
+
+    static int lowerBound(const int* keys, int n, int no);
+    static int childIndex(const Inner* p, int no);
+    const Leaf* leafFor(int no) const;
+
+    bool insertRec(Node* n, const Emp& e, int& upKey, Node*& upNode);
+    bool removeRec(Node* n, int no);
+    void fixChild(Inner* p, int i);
+    static void freeRec(Node* n);
+};
+
+#endif
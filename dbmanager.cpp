@@ -1,11 +1,17 @@
 #include "dbmanager.h"
 
+#include <QDateTime>
+#include <QHash>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QUuid>
+#include <QStringList>
+#include <algorithm>
 
-DbManager::DbManager() {
-    m_connName = "conn_sqlist";
+#include "trace.h"
+
+DbManager::DbManager(const QString& connName) {
+    m_connName = connName;
 }
 
 DbManager::~DbManager() {
@@ -13,8 +19,10 @@ DbManager::~DbManager() {
 }
 
 bool DbManager::open(const QString& path) {
+    TRACE_SCOPE("db.open");
     m_db = QSqlDatabase::addDatabase("QSQLITE",m_connName);
     m_db.setDatabaseName(path);
+    m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000"); //后台 compaction 与界面写入可能短暂争锁
     return m_db.open();
 }
 
@@ -64,11 +72,127 @@ bool DbManager::ensureTables(QString* err) {
         if (err) *err = q.lastError().text();
         return false;
     }
+    return migrate(err);
+}
+
+int DbManager::schemaVersion(QString* err) const {
+    QSqlQuery q(m_db);
+    if (!q.exec("PRAGMA user_version;") || !q.next()) {
+        if (err) *err = q.lastError().text();
+        return -1;
+    }
+    return q.value(0).toInt();
+}
+
+//按 user_version 逐级升级，每一级在一个事务里完成
+bool DbManager::migrate(QString* err) {
+    TRACE_SCOPE("db.migrate");
+    int ver = schemaVersion(err);
+    if (ver < 0) return false;
+    const QString now = "CAST((julianday('now') - 2440587.5) * 86400000.0 AS INTEGER)"; //Unix 毫秒
+
+    while (ver < kSchemaVersion) {
+        QStringList steps;
+        switch (ver) {
+        case 0: //v1：部门子树查询、按部门过滤、按工资排序分页用到的索引
+            steps << "CREATE INDEX IF NOT EXISTS idx_departments_parent ON departments(parent_id);"
+                  << "CREATE INDEX IF NOT EXISTS idx_employees_depno ON employees(depno);"
+                  << "CREATE INDEX IF NOT EXISTS idx_employees_salary_no ON employees(salary, no);";
+            break;
+        case 1: //v2：全局变更序号 + 每行 rowver + 删除墓碑，由触发器维护，外部进程写库也能被增量发现
+            steps << "CREATE TABLE IF NOT EXISTS change_seq(id INTEGER PRIMARY KEY CHECK(id = 1), seq INTEGER NOT NULL);"
+                  << "INSERT OR IGNORE INTO change_seq(id, seq) VALUES(1, 0);"
+                  << "CREATE TABLE IF NOT EXISTS tombstones("
+                     "tbl TEXT NOT NULL, key INTEGER NOT NULL, rowver INTEGER NOT NULL, PRIMARY KEY(tbl, key));"
+                  << "CREATE INDEX IF NOT EXISTS idx_tombstones_rowver ON tombstones(rowver);";
+            for (const char* t : { "employees", "departments" }) {
+                const QString tbl = QString::fromLatin1(t);
+                const QString key = tbl == "employees" ? "no" : "id";
+                const QString cols = tbl == "employees" ? "no, name, depno, salary" : "depno, name, parent_id";
+                const QString bump = "UPDATE change_seq SET seq = seq + 1 WHERE id = 1;";
+                const QString cur = "(SELECT seq FROM change_seq WHERE id = 1)";
+                steps << QString("ALTER TABLE %1 ADD COLUMN rowver INTEGER NOT NULL DEFAULT 0;").arg(tbl)
+                      << QString("CREATE INDEX IF NOT EXISTS idx_%1_rowver ON %1(rowver);").arg(tbl)
+                      << QString("CREATE TRIGGER IF NOT EXISTS trg_%1_ins AFTER INSERT ON %1 BEGIN %2"
+                                 " UPDATE %1 SET rowver = %3 WHERE %4 = NEW.%4;"
+                                 " DELETE FROM tombstones WHERE tbl = '%1' AND key = NEW.%4; END;")
+                             .arg(tbl).arg(bump).arg(cur).arg(key)
+                      //只监听业务列，触发器自己改 rowver 不会再触发
+                      << QString("CREATE TRIGGER IF NOT EXISTS trg_%1_upd AFTER UPDATE OF %2 ON %1 BEGIN %3"
+                                 " UPDATE %1 SET rowver = %4 WHERE %5 = NEW.%5; END;")
+                             .arg(tbl).arg(cols).arg(bump).arg(cur).arg(key)
+                      << QString("CREATE TRIGGER IF NOT EXISTS trg_%1_del AFTER DELETE ON %1 BEGIN %2"
+                                 " INSERT OR REPLACE INTO tombstones(tbl, key, rowver) VALUES('%1', OLD.%3, %4); END;")
+                             .arg(tbl).arg(bump).arg(key).arg(cur);
+            }
+            break;
+        case 2: //v3：工资/部门历史，只追加；库里已有的员工记一条基线，之后由触发器在每次真正变化时追加
+            steps << "CREATE TABLE IF NOT EXISTS emp_history("
+                     "id INTEGER PRIMARY KEY AUTOINCREMENT, no INTEGER NOT NULL, ts INTEGER NOT NULL,"
+                     "depno INTEGER NOT NULL, salary REAL NOT NULL, removed INTEGER NOT NULL DEFAULT 0);"
+                  << "CREATE INDEX IF NOT EXISTS idx_emp_history_no ON emp_history(no, id);"
+                  << QString("INSERT INTO emp_history(no, ts, depno, salary) SELECT no, %1, depno, salary FROM employees;")
+                         .arg(now)
+                  //INSERT OR REPLACE 覆盖同一行也走这里：与该工号最近一条历史相同（只改了姓名等）时不记
+                  << QString("CREATE TRIGGER IF NOT EXISTS trg_emp_history_ins AFTER INSERT ON employees"
+                             " WHEN NOT EXISTS (SELECT 1 FROM emp_history h WHERE h.id ="
+                             " (SELECT MAX(id) FROM emp_history WHERE no = NEW.no)"
+                             " AND h.removed = 0 AND h.depno = NEW.depno AND h.salary = NEW.salary)"
+                             " BEGIN INSERT INTO emp_history(no, ts, depno, salary)"
+                             " VALUES(NEW.no, %1, NEW.depno, NEW.salary); END;").arg(now)
+                  << QString("CREATE TRIGGER IF NOT EXISTS trg_emp_history_upd AFTER UPDATE OF depno, salary ON employees"
+                             " WHEN OLD.depno IS NOT NEW.depno OR OLD.salary IS NOT NEW.salary"
+                             " BEGIN INSERT INTO emp_history(no, ts, depno, salary)"
+                             " VALUES(NEW.no, %1, NEW.depno, NEW.salary); END;").arg(now)
+                  << QString("CREATE TRIGGER IF NOT EXISTS trg_emp_history_del AFTER DELETE ON employees"
+                             " BEGIN INSERT INTO emp_history(no, ts, depno, salary, removed)"
+                             " VALUES(OLD.no, %1, OLD.depno, OLD.salary, 1); END;").arg(now);
+            break;
+        case 3: //v4：合并变更日志时按每条记录的编辑时间先写历史（appendHistory），触发器再看到同样的状态就不重复记
+                //改/删触发器也改成与该工号最近一条历史比较；其它途径写库仍由触发器按写入时刻记
+            steps << "DROP TRIGGER IF EXISTS trg_emp_history_upd;"
+                  << "DROP TRIGGER IF EXISTS trg_emp_history_del;"
+                  << QString("CREATE TRIGGER trg_emp_history_upd AFTER UPDATE OF depno, salary ON employees"
+                             " WHEN NOT EXISTS (SELECT 1 FROM emp_history h WHERE h.id ="
+                             " (SELECT MAX(id) FROM emp_history WHERE no = NEW.no)"
+                             " AND h.removed = 0 AND h.depno = NEW.depno AND h.salary = NEW.salary)"
+                             " BEGIN INSERT INTO emp_history(no, ts, depno, salary)"
+                             " VALUES(NEW.no, %1, NEW.depno, NEW.salary); END;").arg(now)
+                  << QString("CREATE TRIGGER trg_emp_history_del AFTER DELETE ON employees"
+                             " WHEN NOT EXISTS (SELECT 1 FROM emp_history h WHERE h.id ="
+                             " (SELECT MAX(id) FROM emp_history WHERE no = OLD.no) AND h.removed = 1)"
+                             " BEGIN INSERT INTO emp_history(no, ts, depno, salary, removed)"
+                             " VALUES(OLD.no, %1, OLD.depno, OLD.salary, 1); END;").arg(now);
+            break;
+        default:
+            break;
+        }
+        steps << QString("PRAGMA user_version = %1;").arg(ver + 1);
+
+        if (!m_db.transaction()) {
+            if (err) *err = m_db.lastError().text();
+            return false;
+        }
+        QSqlQuery q(m_db);
+        for (const auto& sql : steps) {
+            if (!q.exec(sql)) {
+                m_db.rollback();
+                if (err) *err = QString("迁移到 v%1 失败：%2").arg(ver + 1).arg(q.lastError().text());
+                return false;
+            }
+        }
+        if (!m_db.commit()) {
+            if (err) *err = m_db.lastError().text();
+            return false;
+        }
+        ++ver;
+    }
     return true;
 }
 
 
 QVector<DeptRow> DbManager::fetchDepartments(QString* err) const {
+    TRACE_SCOPE("db.fetchDepartments");
     QVector<DeptRow> out;
     QSqlQuery q(m_db);
     if (!q.exec("SELECT id, depno, name, parent_id FROM departments ORDER BY id ASC;")) {
@@ -115,6 +239,154 @@ bool DbManager::insertDepartment(int depno, const QString& name, const QVariant&
     return true;
 }
 
+//QVariant 为空时绑定 NULL
+static void bindParentId(QSqlQuery& q, const QVariant& parentId) {
+    if (parentId.isValid() && !parentId.isNull()) q.addBindValue(parentId);
+    else q.addBindValue(QVariant(QVariant::Int));
+}
+
+bool DbManager::updateDepartmentParent(int id, const QVariant& parentId, QString* err) {
+    TRACE_SCOPE("db.updateDepartmentParent");
+    QSqlQuery q(m_db);
+    q.prepare("UPDATE departments SET parent_id=? WHERE id=?;");
+    bindParentId(q, parentId);
+    q.addBindValue(id);
+    if (!q.exec()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DbManager::renameDepartment(int id, const QString& name, QString* err) {
+    QSqlQuery q(m_db);
+    q.prepare("UPDATE departments SET name=? WHERE id=?;");
+    q.addBindValue(name);
+    q.addBindValue(id);
+    if (!q.exec()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DbManager::deleteDepartment(int id, const QVariant& parentId, QString* err) {
+    TRACE_SCOPE("db.deleteDepartment");
+    if (!m_db.transaction()) {
+        if (err) *err = m_db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery q(m_db);
+    q.prepare("UPDATE departments SET parent_id=? WHERE parent_id=?;");
+    bindParentId(q, parentId);
+    q.addBindValue(id);
+    if (!q.exec()) {
+        m_db.rollback();
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+
+    q.prepare("DELETE FROM departments WHERE id=?;");
+    q.addBindValue(id);
+    if (!q.exec()) {
+        m_db.rollback();
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        if (err) *err = m_db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DbManager::importDepartments(const QVector<DeptImportRow>& rows, const DeptTree& existing,
+                                  QVector<DeptRow>* out, QString* err) {
+    TRACE_SCOPE("db.importDepartments");
+    if (!out) return false;
+    out->clear();
+    if (rows.isEmpty()) return true;
+
+    //BEGIN IMMEDIATE：开始时就拿写锁，下面读出的最大 id 到提交前不会被其它连接插入的部门占用
+    //（默认的 BEGIN 要到第一次写时才加锁，中间别的连接可以插进来，导致主键冲突）
+    QSqlQuery q(m_db);
+    if (!q.exec("BEGIN IMMEDIATE;")) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    auto fail = [&](const QString& msg) {
+        if (err) *err = msg;
+        QSqlQuery(m_db).exec("ROLLBACK;");
+        return false;
+    };
+
+    //AUTOINCREMENT 不复用删掉的 id：从表里与 sqlite_sequence 里较大的那个往后分配
+    if (!q.exec("SELECT MAX(COALESCE((SELECT MAX(id) FROM departments), 0),"
+                " COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'departments'), 0));") ||
+        !q.next())
+        return fail(q.lastError().text());
+    int nextId = q.value(0).toInt() + 1;
+
+    QVector<DeptRow> done;
+    done.reserve(rows.size());
+    QHash<int, int> newIdOfDepno;
+    newIdOfDepno.reserve(rows.size());
+    for (const auto& r : rows) {
+        DeptRow d;
+        d.id = nextId++;
+        d.depno = r.depno;
+        d.name = r.name;
+        if (r.parentDepno != 0) {
+            int pid = newIdOfDepno.value(r.parentDepno, -1);
+            if (pid < 0) pid = existing.idOfDepno(r.parentDepno);
+            if (pid <= 0) return fail(QString("部门 %1 的上级部门 %2 不存在或排在它后面").arg(r.depno).arg(r.parentDepno));
+            d.parentId = pid;
+        }
+        newIdOfDepno.insert(r.depno, d.id);
+        done.push_back(d);
+    }
+
+    //整批用同一条预编译语句，只有最后不足一批时重新 prepare 一次
+    //部门号是否已存在按内存里的部门树查过，但其它连接可能在那之后写入：拿到写锁后按批在库里再查一遍
+    QSqlQuery ins(m_db), chk(m_db);
+    int preparedRows = 0;
+    for (int at = 0; at < done.size(); at += kImportBatchRows) {
+        const int n = std::min(int(kImportBatchRows), done.size() - at);
+        if (n != preparedRows) {
+            QString sql = "INSERT INTO departments(id, depno, name, parent_id) VALUES";
+            QString chkSql = "SELECT depno FROM departments WHERE depno IN (";
+            for (int i = 0; i < n; ++i) {
+                sql += i == 0 ? "(?,?,?,?)" : ",(?,?,?,?)";
+                chkSql += i == 0 ? "?" : ",?";
+            }
+            chkSql += ") LIMIT 1;";
+            if (!ins.prepare(sql)) return fail(ins.lastError().text());
+            if (!chk.prepare(chkSql)) return fail(chk.lastError().text());
+            preparedRows = n;
+        }
+        for (int i = at; i < at + n; ++i) chk.addBindValue(done[i].depno);
+        if (!chk.exec()) return fail(chk.lastError().text());
+        if (chk.next()) return fail(QString("部门号 %1 已存在（其它连接刚写入），导入已取消").arg(chk.value(0).toInt()));
+
+        for (int i = at; i < at + n; ++i) {
+            ins.addBindValue(done[i].id);
+            ins.addBindValue(done[i].depno);
+            ins.addBindValue(done[i].name);
+            bindParentId(ins, done[i].parentId);
+        }
+        if (!ins.exec()) return fail(ins.lastError().text());
+    }
+
+    ins.finish();
+    chk.finish();
+    q.finish();
+    if (!q.exec("COMMIT;")) return fail(q.lastError().text());
+    *out = done;
+    return true;
+}
+
 QVector<Emp> DbManager::fetchEmployeesByDept(int depno, QString* err) const {
     QVector<Emp> out;
     QSqlQuery q(m_db);
@@ -127,7 +399,7 @@ QVector<Emp> DbManager::fetchEmployeesByDept(int depno, QString* err) const {
     while (q.next()) {
         Emp e;
         e.no = q.value(0).toInt();
-        e.name = q.value(1).toString();
+        e.setName(q.value(1).toString());
         e.depno = q.value(2).toInt();
         e.salary = q.value(3).toDouble();
         out.push_back(e);
@@ -136,6 +408,7 @@ QVector<Emp> DbManager::fetchEmployeesByDept(int depno, QString* err) const {
 }
 
 QVector<Emp> DbManager::fetchAllEmployees(QString* err) const {
+    TRACE_SCOPE("db.fetchAllEmployees");
     QVector<Emp> out;
     QSqlQuery q(m_db);
     if (!q.exec("SELECT no, name, depno, salary FROM employees;")) {
@@ -145,7 +418,7 @@ QVector<Emp> DbManager::fetchAllEmployees(QString* err) const {
     while (q.next()) {
         Emp e;
         e.no = q.value(0).toInt();
-        e.name = q.value(1).toString();
+        e.setName(q.value(1).toString());
         e.depno = q.value(2).toInt();
         e.salary = q.value(3).toDouble();
         out.push_back(e);
@@ -155,6 +428,7 @@ QVector<Emp> DbManager::fetchAllEmployees(QString* err) const {
 
 //从AVL树提取所有Employees，保存到DB
 bool DbManager::replaceAllEmployees(const QVector<Emp>& emps, QString* err) {
+    TRACE_SCOPE("db.replaceAllEmployees");
     if (!m_db.transaction()) {
         if (err) *err = m_db.lastError().text();
         return false;
@@ -170,7 +444,7 @@ bool DbManager::replaceAllEmployees(const QVector<Emp>& emps, QString* err) {
     q.prepare("INSERT INTO employees(no,name,depno,salary) VALUES(?,?,?,?);");
     for (const auto& e : emps) {
         q.addBindValue(e.no);
-        q.addBindValue(e.name);
+        q.addBindValue(e.nameString());
         q.addBindValue(e.depno);
         q.addBindValue(e.salary);
         if (!q.exec()) {
@@ -195,3 +469,306 @@ bool DbManager::clearEmployees(QString* err) {
     }
     return true;
 }
+
+//逐条编辑按时间写进历史：以该工号最近一条历史为当前状态，没有真正变化的不记
+//在调用方的事务里执行
+bool DbManager::appendHistory(const QVector<EmpEdit>& edits, QString* err) {
+    TRACE_SCOPE("db.appendHistory");
+    QSqlQuery up(m_db), rm(m_db), clr(m_db);
+    up.prepare("INSERT INTO emp_history(no, ts, depno, salary) SELECT ?, ?, ?, ?"
+               " WHERE NOT EXISTS (SELECT 1 FROM emp_history h WHERE h.id ="
+               " (SELECT MAX(id) FROM emp_history WHERE no = ?)"
+               " AND h.removed = 0 AND h.depno = ? AND h.salary = ?);");
+    rm.prepare("INSERT INTO emp_history(no, ts, depno, salary, removed) SELECT no, ?, depno, salary, 1"
+               " FROM emp_history WHERE id = (SELECT MAX(id) FROM emp_history WHERE no = ?) AND removed = 0;");
+    clr.prepare("INSERT INTO emp_history(no, ts, depno, salary, removed) SELECT h.no, ?, h.depno, h.salary, 1"
+                " FROM emp_history h JOIN (SELECT MAX(id) AS id FROM emp_history GROUP BY no) m ON h.id = m.id"
+                " WHERE h.removed = 0;");
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const auto& e : edits) {
+        const qint64 ts = e.ts > 0 ? e.ts : now;
+        QSqlQuery* q = nullptr;
+        switch (e.kind) {
+        case EmpEdit::Upsert:
+            q = &up;
+            q->addBindValue(e.no);
+            q->addBindValue(ts);
+            q->addBindValue(e.depno);
+            q->addBindValue(e.salary);
+            q->addBindValue(e.no);
+            q->addBindValue(e.depno);
+            q->addBindValue(e.salary);
+            break;
+        case EmpEdit::Remove:
+            q = &rm;
+            q->addBindValue(ts);
+            q->addBindValue(e.no);
+            break;
+        case EmpEdit::Clear:
+            q = &clr;
+            q->addBindValue(ts);
+            break;
+        }
+        if (!q->exec()) {
+            if (err) *err = q->lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DbManager::applyEmployeeChanges(const QVector<Emp>& upserts, const QVector<int>& deletes, QString* err,
+                                     bool clearFirst, const QVector<EmpEdit>* edits, ChangeSeqSpan* span) {
+    TRACE_SCOPE("db.applyEmployeeChanges");
+    if (!m_db.transaction()) {
+        if (err) *err = m_db.lastError().text();
+        return false;
+    }
+
+    qint64 seqBefore = -1;
+    if (span && !changeSeq(&seqBefore, err)) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (edits && !appendHistory(*edits, err)) {
+        m_db.rollback();
+        return false;
+    }
+
+    //清空时只删之后不再写入的工号：要写入的行直接覆盖，不经过“删除”，历史触发器不会在合并时刻多记一次删除
+    if (clearFirst) {
+        QSqlQuery clr(m_db), keep(m_db);
+        bool ok = clr.exec("CREATE TEMP TABLE IF NOT EXISTS keep_emp(no INTEGER PRIMARY KEY);") &&
+                  clr.exec("DELETE FROM temp.keep_emp;") &&
+                  keep.prepare("INSERT OR IGNORE INTO temp.keep_emp(no) VALUES(?);");
+        for (int i = 0; ok && i < upserts.size(); ++i) {
+            keep.addBindValue(upserts[i].no);
+            ok = keep.exec();
+        }
+        ok = ok && clr.exec("DELETE FROM employees WHERE no NOT IN (SELECT no FROM temp.keep_emp);");
+        if (!ok) {
+            m_db.rollback();
+            if (err) *err = clr.lastError().isValid() ? clr.lastError().text() : keep.lastError().text();
+            return false;
+        }
+    }
+
+    QSqlQuery up(m_db);
+    up.prepare("INSERT OR REPLACE INTO employees(no,name,depno,salary) VALUES(?,?,?,?);");
+    for (const auto& e : upserts) {
+        up.addBindValue(e.no);
+        up.addBindValue(e.nameString());
+        up.addBindValue(e.depno);
+        up.addBindValue(e.salary);
+        if (!up.exec()) {
+            m_db.rollback();
+            if (err) *err = up.lastError().text();
+            return false;
+        }
+    }
+
+    QSqlQuery del(m_db);
+    del.prepare("DELETE FROM employees WHERE no=?;");
+    for (int no : deletes) {
+        del.addBindValue(no);
+        if (!del.exec()) {
+            m_db.rollback();
+            if (err) *err = del.lastError().text();
+            return false;
+        }
+    }
+
+    qint64 seqAfter = -1;
+    if (span && !changeSeq(&seqAfter, err)) {
+        m_db.rollback();
+        return false;
+    }
+    if (!m_db.commit()) {
+        if (err) *err = m_db.lastError().text();
+        return false;
+    }
+    if (span) {
+        span->before = seqBefore;
+        span->after = seqAfter;
+    }
+    return true;
+}
+
+//部门子树：UNION 去重，数据里即使有环也会终止
+static const char* kSubtreeCte =
+    "WITH RECURSIVE sub(id, depno) AS ("
+    " SELECT id, depno FROM departments WHERE id=?"
+    " UNION"
+    " SELECT d.id, d.depno FROM departments d JOIN sub ON d.parent_id = sub.id"
+    ") ";
+
+static const char* kSubtreeFilter = "e.depno IN (SELECT depno FROM sub)";
+
+QVector<Emp> DbManager::fetchEmployeePage(int rootDeptId, EmpOrder order, const EmpCursor& after, int limit,
+                                          QString* err) const {
+    TRACE_SCOPE("db.fetchEmployeePage");
+    QVector<Emp> out;
+
+    QStringList where;
+    if (rootDeptId != 0) where << kSubtreeFilter;
+    //keyset：从上一页最后一行之后接着取，走 (salary, no) / no 索引，不用 OFFSET
+    //按工资时用行值比较：SQLite 直接在 (salary, no) 索引上定位到起点（SEARCH ... (salary>?)），
+    //写成 salary > ? OR (salary = ? AND no > ?) 时规划器只会从索引头开始扫（SCAN ... USING INDEX）
+    if (after.valid) {
+        if (order == EmpOrder::BySalary) where << "(e.salary, e.no) > (?, ?)";
+        else where << "e.no > ?";
+    }
+
+    QString sql = rootDeptId != 0 ? QString::fromLatin1(kSubtreeCte) : QString();
+    sql += "SELECT e.no, e.name, e.depno, e.salary FROM employees e";
+    if (!where.isEmpty()) sql += " WHERE " + where.join(" AND ");
+    sql += order == EmpOrder::BySalary ? " ORDER BY e.salary, e.no" : " ORDER BY e.no";
+    sql += " LIMIT ?;";
+
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    if (rootDeptId != 0) q.addBindValue(rootDeptId);
+    if (after.valid) {
+        if (order == EmpOrder::BySalary) q.addBindValue(after.salary);
+        q.addBindValue(after.no);
+    }
+    q.addBindValue(limit);
+
+    if (!q.exec()) {
+        if (err) *err = q.lastError().text();
+        return out;
+    }
+    out.reserve(limit);
+    while (q.next()) {
+        Emp e;
+        e.no = q.value(0).toInt();
+        e.setName(q.value(1).toString());
+        e.depno = q.value(2).toInt();
+        e.salary = q.value(3).toDouble();
+        out.push_back(e);
+    }
+    return out;
+}
+
+bool DbManager::aggregateEmployees(int rootDeptId, EmpAggregate* out, QString* err) const {
+    TRACE_SCOPE("db.aggregateEmployees");
+    if (!out) return false;
+
+    QString sql = rootDeptId != 0 ? QString::fromLatin1(kSubtreeCte) : QString();
+    sql += "SELECT COUNT(*), TOTAL(e.salary), MIN(e.salary), MAX(e.salary) FROM employees e";
+    if (rootDeptId != 0) sql += QString(" WHERE ") + kSubtreeFilter;
+
+    QSqlQuery q(m_db);
+    q.prepare(sql);
+    if (rootDeptId != 0) q.addBindValue(rootDeptId);
+    if (!q.exec() || !q.next()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    out->count = q.value(0).toLongLong();
+    out->sum = q.value(1).toDouble();
+    out->min = q.value(2).toDouble();
+    out->max = q.value(3).toDouble();
+    return true;
+}
+
+bool DbManager::dataVersion(qint64* out, QString* err) const {
+    QSqlQuery q(m_db);
+    if (!q.exec("PRAGMA data_version;") || !q.next()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    if (out) *out = q.value(0).toLongLong();
+    return true;
+}
+
+bool DbManager::changeSeq(qint64* out, QString* err) const {
+    QSqlQuery q(m_db);
+    if (!q.exec("SELECT seq FROM change_seq WHERE id = 1;") || !q.next()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    if (out) *out = q.value(0).toLongLong();
+    return true;
+}
+
+bool DbManager::fetchChangesSince(qint64 since, DbChangeSet* out, QString* err) {
+    TRACE_SCOPE("db.fetchChangesSince");
+    if (!out) return false;
+    *out = DbChangeSet();
+
+    if (!m_db.transaction()) {
+        if (err) *err = m_db.lastError().text();
+        return false;
+    }
+    auto fail = [&](const QSqlQuery& q) {
+        if (err) *err = q.lastError().text();
+        m_db.rollback();
+        return false;
+    };
+
+    QSqlQuery q(m_db);
+    if (!q.exec("SELECT seq FROM change_seq WHERE id = 1;") || !q.next()) return fail(q);
+    out->seq = q.value(0).toLongLong();
+
+    q.prepare("SELECT no, name, depno, salary FROM employees WHERE rowver > ? ORDER BY no;");
+    q.addBindValue(since);
+    if (!q.exec()) return fail(q);
+    while (q.next()) {
+        Emp e;
+        e.no = q.value(0).toInt();
+        e.setName(q.value(1).toString());
+        e.depno = q.value(2).toInt();
+        e.salary = q.value(3).toDouble();
+        out->emps.push_back(e);
+    }
+
+    q.prepare("SELECT id, depno, name, parent_id FROM departments WHERE rowver > ? ORDER BY rowver;");
+    q.addBindValue(since);
+    if (!q.exec()) return fail(q);
+    while (q.next()) {
+        DeptRow r;
+        r.id = q.value(0).toInt();
+        r.depno = q.value(1).toInt();
+        r.name = q.value(2).toString();
+        r.parentId = q.value(3);
+        out->depts.push_back(r);
+    }
+
+    q.prepare("SELECT tbl, key FROM tombstones WHERE rowver > ?;");
+    q.addBindValue(since);
+    if (!q.exec()) return fail(q);
+    while (q.next()) {
+        if (q.value(0).toString() == "employees") out->empRemoved.push_back(q.value(1).toInt());
+        else out->deptRemoved.push_back(q.value(1).toInt());
+    }
+
+    m_db.commit();
+    return true;
+}
+
+bool DbManager::fetchHistorySince(qint64 afterId, QVector<EmpHistoryRow>* out, QString* err) const {
+    TRACE_SCOPE("db.fetchHistorySince");
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT id, ts, no, depno, salary, removed FROM emp_history WHERE id > ? ORDER BY id;");
+    q.addBindValue(afterId);
+    if (!q.exec()) {
+        if (err) *err = q.lastError().text();
+        return false;
+    }
+    while (q.next()) {
+        EmpHistoryRow r;
+        r.id = q.value(0).toLongLong();
+        r.ts = q.value(1).toLongLong();
+        r.no = q.value(2).toInt();
+        r.depno = q.value(3).toInt();
+        r.salary = q.value(4).toDouble();
+        r.removed = q.value(5).toInt() != 0;
+        out->push_back(r);
+    }
+    return true;
+}
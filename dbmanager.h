@@ -9,9 +9,76 @@
 #include "avl.h"
 #include "depttree.h"
 
+//一页员工的起点（keyset 分页）：上一页最后一行的排序键，valid=false 表示从头开始
+struct EmpCursor {
+    bool valid = false;
+    int no = 0;
+    double salary = 0;
+};
+
+//工资汇总
+struct EmpAggregate {
+    qint64 count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+};
+
+//某个版本号之后的增量变更（v2 起由触发器维护 rowver 与删除墓碑）
+struct DbChangeSet {
+    qint64 seq = 0;              //读取时的全局变更序号，下次从这里接着读
+    QVector<Emp> emps;           //新增或修改的员工
+    QVector<int> empRemoved;     //删除的工号
+    QVector<DeptRow> depts;      //新增或修改的部门
+    QVector<int> deptRemoved;    //删除的部门 id
+    bool isEmpty() const { return emps.isEmpty() && empRemoved.isEmpty() && depts.isEmpty() && deptRemoved.isEmpty(); }
+};
+
+//本连接一次写事务前后的全局变更序号（都在该事务里读，中间不会夹进别的提交）；-1 表示没有写
+struct ChangeSeqSpan {
+    qint64 before = -1;
+    qint64 after = -1;
+};
+
+//员工工资/部门历史中的一条（v3 起）：id 递增，ts 为 Unix 毫秒；合并变更日志时按编辑时间写，其它途径写库由触发器按写入时刻记
+//removed 为 true 表示此刻被删除，depno/salary 是删除前的值
+struct EmpHistoryRow {
+    qint64 id = 0;
+    qint64 ts = 0;
+    int no = 0;
+    int depno = 0;
+    double salary = 0;
+    bool removed = false;
+};
+
+//一次员工编辑及其发生时间（来自变更日志），合并进库时按它逐条写历史
+struct EmpEdit {
+    enum Kind { Upsert, Remove, Clear };
+    Kind kind = Upsert;
+    qint64 ts = 0;      //Unix 毫秒；0 表示不知道（旧格式日志），按写库时刻记
+    int no = 0;
+    int depno = 0;      //Remove / Clear 不用
+    double salary = 0;
+};
+
+//部门批量导入的一行：parentDepno 为 0 表示顶级
+struct DeptImportRow {
+    int depno = 0;
+    QString name;
+    int parentDepno = 0;
+};
+
 class DbManager {
 public:
-    DbManager();
+    //当前库结构版本（PRAGMA user_version），ensureTables 会把旧库迁移上来
+    static const int kSchemaVersion = 4;
+    //多值 INSERT 每条的行数：每行 4 个参数，不超过旧版 SQLite 999 个参数的上限
+    static const int kImportBatchRows = 200;
+
+    enum class EmpOrder { ByNo, BySalary };
+
+    //connName：QSqlDatabase 连接名，后台线程要用自己的连接
+    explicit DbManager(const QString& connName = QStringLiteral("conn_sqlist"));
     ~DbManager();
 
     bool open(const QString& path);
@@ -19,13 +86,25 @@ public:
     bool isOpen() const;
     QSqlDatabase db() const;
 
-    //建表
+    //建表 + 结构迁移
     bool ensureTables(QString* err = nullptr);
+    int schemaVersion(QString* err = nullptr) const;
 
     //部门
     QVector<DeptRow> fetchDepartments(QString* err = nullptr) const;
     bool insertDepartment(int depno, const QString& name, const QVariant& parentId, int* outNewId, QString* err = nullptr);
     bool countDepartments(int* outCount, QString* err = nullptr) const;
+    //移动部门：只改这一行的 parent_id（parentId 为空表示顶级）
+    bool updateDepartmentParent(int id, const QVariant& parentId, QString* err = nullptr);
+    bool renameDepartment(int id, const QString& name, QString* err = nullptr);
+    //删除部门，并把它的子部门挂到 parentId 下（一个事务）
+    bool deleteDepartment(int id, const QVariant& parentId, QString* err = nullptr);
+    //批量新增部门（一个 BEGIN IMMEDIATE 事务）：rows 须上级在前（见 DeptImport::orderByParent），
+    //上级要么在 rows 里更靠前，要么是 existing 里已有的部门。id 与 parent_id 在内存里分配好，
+    //再每 kImportBatchRows 行一条预编译的多值 INSERT；每批写入前在事务里再查一遍部门号是否已被其它连接占用，
+    //有则整体回滚并在 err 里给出冲突的部门号；成功时 out 为写入的行（顺序同 rows）
+    bool importDepartments(const QVector<DeptImportRow>& rows, const DeptTree& existing, QVector<DeptRow>* out,
+                           QString* err = nullptr);
 
     //员工（旧接口保留不用也行）
     QVector<Emp> fetchEmployeesByDept(int depno, QString* err = nullptr) const;
@@ -38,7 +117,37 @@ public:
 
     bool clearEmployees(QString* err = nullptr);
 
+    //按行写回变更：upserts 整行覆盖，deletes 按 no 删除，全部在一个事务里
+    //clearFirst 为 true 时先清空员工表（同一事务）
+    //edits 为这些净变化之前的逐条编辑（按时间顺序），给出时先在同一事务里按各自的编辑时间写历史
+    //span 给出时返回这次写入前后的变更序号
+    bool applyEmployeeChanges(const QVector<Emp>& upserts, const QVector<int>& deletes, QString* err = nullptr,
+                              bool clearFirst = false, const QVector<EmpEdit>* edits = nullptr,
+                              ChangeSeqSpan* span = nullptr);
+
+    //---- SQL 直查（数据不全量进内存）----
+    //rootDeptId 为 0 表示全部部门，否则为该部门及其全部下级（递归 CTE）
+    //after 之后按 order 取至多 limit 条
+    QVector<Emp> fetchEmployeePage(int rootDeptId, EmpOrder order, const EmpCursor& after, int limit,
+                                   QString* err = nullptr) const;
+    bool aggregateEmployees(int rootDeptId, EmpAggregate* out, QString* err = nullptr) const;
+
+    //---- 变更检测 ----
+    //PRAGMA data_version：其它连接/进程提交后才会变化，本连接自己的提交不影响
+    bool dataVersion(qint64* out, QString* err = nullptr) const;
+    //当前全局变更序号（change_seq）
+    bool changeSeq(qint64* out, QString* err = nullptr) const;
+    //rowver > since 的行与墓碑，在一个读事务里取，保证前后一致
+    bool fetchChangesSince(qint64 since, DbChangeSet* out, QString* err = nullptr);
+
+    //---- 工资/部门历史 ----
+    //id > afterId 的历史记录，按 id 升序追加到 out
+    bool fetchHistorySince(qint64 afterId, QVector<EmpHistoryRow>* out, QString* err = nullptr) const;
+
 private:
+    bool migrate(QString* err);
+    bool appendHistory(const QVector<EmpEdit>& edits, QString* err);
+
     QSqlDatabase m_db;
     QString m_connName;
 };
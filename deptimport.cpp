@@ -0,0 +1,147 @@
+#include "deptimport.h"
+
+#include <QHash>
+#include <QStringList>
+
+#include "depttree.h"
+#include "trace.h"
+
+namespace {
+
+//按 CSV 规则切一行：字段可用双引号括起，"" 表示引号本身
+bool splitCsvLine(const QString& line, QStringList* fields) {
+    fields->clear();
+    QString cur;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line[i];
+        if (quoted) {
+            if (c != '"') cur += c;
+            else if (i + 1 < line.size() && line[i + 1] == '"') {
+                cur += '"';
+                ++i;
+            } else quoted = false;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields->push_back(cur);
+            cur.clear();
+        } else {
+            cur += c;
+        }
+    }
+    if (quoted) return false;
+    fields->push_back(cur);
+    return true;
+}
+
+} // namespace
+
+namespace DeptImport {
+
+bool parseCsv(const QString& text, QVector<DeptImportRow>* out, QString* err) {
+    TRACE_SCOPE("deptImport.parse");
+    QVector<DeptImportRow> rows;
+    const QStringList lines = text.split('\n');
+    QStringList f;
+    bool first = true;
+    for (int ln = 0; ln < lines.size(); ++ln) {
+        const QString line = lines[ln].trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        const bool header = first;
+        first = false;
+
+        if (!splitCsvLine(line, &f)) {
+            if (err) *err = QString("第 %1 行：引号不成对").arg(ln + 1);
+            return false;
+        }
+        if (f.size() < 2 || f.size() > 3) {
+            if (err) *err = QString("第 %1 行：应为 depno,name,parent_depno 三列").arg(ln + 1);
+            return false;
+        }
+
+        bool ok = false;
+        DeptImportRow r;
+        r.depno = f[0].trimmed().toInt(&ok);
+        if (!ok && header) continue; //表头
+        if (!ok || r.depno <= 0) {
+            if (err) *err = QString("第 %1 行：部门号必须是 >0 的整数").arg(ln + 1);
+            return false;
+        }
+        r.name = f[1].trimmed();
+        if (r.name.isEmpty()) {
+            if (err) *err = QString("第 %1 行：部门名不能为空").arg(ln + 1);
+            return false;
+        }
+        const QString p = f.size() == 3 ? f[2].trimmed() : QString();
+        r.parentDepno = p.isEmpty() ? 0 : p.toInt(&ok);
+        if (!p.isEmpty() && (!ok || r.parentDepno < 0)) {
+            if (err) *err = QString("第 %1 行：上级部门号必须是 >=0 的整数（0 或留空为顶级）").arg(ln + 1);
+            return false;
+        }
+        rows.push_back(r);
+    }
+    *out = rows;
+    return true;
+}
+
+bool orderByParent(const QVector<DeptImportRow>& rows, const DeptTree& existing, QVector<DeptImportRow>* out,
+                   QString* err) {
+    TRACE_SCOPE("deptImport.order");
+    const int n = rows.size();
+    QHash<int, int> rowOfDepno; //文件里的部门号 -> 行下标
+    rowOfDepno.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        const int depno = rows[i].depno;
+        if (rowOfDepno.contains(depno)) {
+            if (err) *err = QString("部门号 %1 在文件里出现了不止一次").arg(depno);
+            return false;
+        }
+        if (existing.containsDepno(depno)) {
+            if (err) *err = QString("部门号 %1 已存在").arg(depno);
+            return false;
+        }
+        rowOfDepno.insert(depno, i);
+    }
+
+    //每行挂到文件内上级的孩子链表上（链表按文件顺序）；上级为顶级或已有部门的行直接入队
+    QVector<int> firstChild(n, -1), lastChild(n, -1), nextSibling(n, -1);
+    QVector<int> order;
+    order.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        const int pdep = rows[i].parentDepno;
+        if (pdep == 0 || existing.containsDepno(pdep)) {
+            order.push_back(i);
+            continue;
+        }
+        const int p = rowOfDepno.value(pdep, -1);
+        if (p < 0) {
+            if (err) *err = QString("部门 %1 的上级部门 %2 不存在").arg(rows[i].depno).arg(pdep);
+            return false;
+        }
+        if (lastChild[p] < 0) firstChild[p] = i;
+        else nextSibling[lastChild[p]] = i;
+        lastChild[p] = i;
+    }
+
+    //order 本身当队列：逐个取出，把它的下级接到末尾
+    for (int head = 0; head < order.size(); ++head) {
+        for (int c = firstChild[order[head]]; c >= 0; c = nextSibling[c]) order.push_back(c);
+    }
+    if (order.size() < n) { //剩下的行都在环上或挂在环下面
+        QVector<bool> placed(n, false);
+        for (int i : order) placed[i] = true;
+        for (int i = 0; i < n; ++i) {
+            if (placed[i]) continue;
+            if (err) *err = QString("部门 %1 的上级链成环（或挂在环上）").arg(rows[i].depno);
+            return false;
+        }
+    }
+
+    out->clear();
+    out->reserve(n);
+    for (int i : order) out->push_back(rows[i]);
+    return true;
+}
+
+} // namespace DeptImport
@@ -0,0 +1,29 @@
+#ifndef DEPTIMPORT_H
+#define DEPTIMPORT_H
+
+#include <QString>
+#include <QVector>
+
+#include "dbmanager.h"
+
+class DeptTree;
+
+//部门批量导入（组织架构表，一次几千个部门）：
+//  1. parseCsv：每行 depno,name,parent_depno，上级为空或 0 表示顶级
+//  2. orderByParent：在内存里检查并按上级在前排好（拓扑序），上级可以是文件里的部门，也可以是已有部门
+//  3. DbManager::importDepartments：一个事务、多值 INSERT 一次写入
+//  调用方最后把结果并入部门主数据，部门树与树控件只重建一次
+namespace DeptImport {
+
+//空行与 # 开头的行跳过；第一行的部门号不是数字时当表头跳过；部门名可以按 CSV 规则加引号
+//格式错误返回 false 并写 err（带行号）
+bool parseCsv(const QString& text, QVector<DeptImportRow>* out, QString* err = nullptr);
+
+//Kahn 拓扑排序：先放上级为顶级或已有部门的行，再逐层放它们的下级，同一层保持文件里的顺序
+//文件内部门号重复、与已有部门重复、上级不存在、上级链成环时返回 false 并写 err
+bool orderByParent(const QVector<DeptImportRow>& rows, const DeptTree& existing, QVector<DeptImportRow>* out,
+                   QString* err = nullptr);
+
+} // namespace DeptImport
+
+#endif
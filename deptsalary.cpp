@@ -0,0 +1,234 @@
+#include "deptsalary.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+void DeptSalaryIndex::clear() {
+    m_all.clear();
+    m_byDept.clear();
+    m_pos.clear();
+}
+
+void DeptSalaryIndex::sync(int no, const Emp* cur) {
+    if (cur) upsert(*cur);
+    else remove(no);
+}
+
+void DeptSalaryIndex::upsert(const Emp& e) {
+    auto it = m_pos.find(e.no);
+    if (it != m_pos.end()) {
+        if (it->depno == e.depno && it->salary == e.salary) return; //只改了姓名
+        remove(e.no);
+    }
+    m_all.insert(SalaryKey{e.salary, e.no});
+    m_byDept[e.depno].insert(SalaryKey{e.salary, e.no}); //不存在时原地默认构造
+    m_pos.insert(e.no, Pos{e.depno, e.salary});
+}
+
+void DeptSalaryIndex::remove(int no) {
+    auto it = m_pos.find(no);
+    if (it == m_pos.end()) return;
+    m_all.remove(SalaryKey{it->salary, no});
+    auto t = m_byDept.find(it->depno);
+    if (t != m_byDept.end()) {
+        t->second.remove(SalaryKey{it->salary, no});
+        if (t->second.size() == 0) m_byDept.erase(t); //空部门不留树，免得拖慢全部门的合并
+    }
+    m_pos.erase(it);
+}
+
+const DeptSalaryIndex::Tree* DeptSalaryIndex::tree(int depno) const {
+    auto it = m_byDept.find(depno);
+    return it == m_byDept.end() ? nullptr : &it->second;
+}
+
+QVector<SalaryKey> DeptSalaryIndex::topK(const QSet<int>& depnos, int k, bool highest) const {
+    QVector<SalaryKey> out;
+    if (k <= 0) return out;
+
+    //堆里每棵树一个游标：当前还没输出的最大（最小）元素
+    struct Cursor {
+        SalaryKey key;
+        const Tree* t;
+    };
+    std::vector<Cursor> heap;
+    for (const Tree* t : treesOf(depnos)) { //全部部门时只有一棵全体员工的树，退化为 O(K log n)
+        const SalaryKey* end = highest ? t->last() : t->first();
+        if (end) heap.push_back(Cursor{*end, t});
+    }
+
+    //堆顶是下一个要输出的：最高时为最大堆，最低时为最小堆
+    auto after = [highest](const Cursor& a, const Cursor& b) {
+        return highest ? a.key < b.key : b.key < a.key;
+    };
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    out.reserve(std::min(k, size()));
+    while (!heap.empty() && out.size() < k) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        const Cursor c = heap.back();
+        heap.pop_back();
+        out.push_back(c.key);
+        const SalaryKey* next = highest ? c.t->lastBefore(c.key) : c.t->firstAfter(c.key);
+        if (next) {
+            heap.push_back(Cursor{*next, c.t});
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+    }
+    return out;
+}
+
+QVector<const DeptSalaryIndex::Tree*> DeptSalaryIndex::treesOf(const QSet<int>& depnos) const {
+    QVector<const Tree*> ts;
+    if (depnos.isEmpty()) {
+        if (m_all.size() > 0) ts.push_back(&m_all);
+        return ts;
+    }
+    ts.reserve(depnos.size());
+    for (int d : depnos)
+        if (const Tree* t = tree(d)) ts.push_back(t);
+    return ts;
+}
+
+int DeptSalaryIndex::count(const QSet<int>& depnos) const {
+    if (depnos.isEmpty()) return m_all.size();
+    int n = 0;
+    for (const Tree* t : treesOf(depnos)) n += t->size();
+    return n;
+}
+
+int DeptSalaryIndex::countBelow(const QSet<int>& depnos, double salary) const {
+    //(salary, INT_MIN) 排在同工资的所有人前面
+    const SalaryKey key{salary, INT_MIN};
+    int n = 0;
+    for (const Tree* t : treesOf(depnos)) n += t->rankOf(key);
+    return n;
+}
+
+bool DeptSalaryIndex::kth(const QSet<int>& depnos, int k, SalaryKey* out) const {
+    const QVector<const Tree*> ts = treesOf(depnos);
+    if (k < 0) return false;
+    if (ts.size() == 1) {
+        const SalaryKey* v = ts[0]->kth(k);
+        if (v) *out = *v;
+        return v != nullptr;
+    }
+
+    //多棵树的第 k 小：每棵树保留一个下标区间 [lo, hi)，答案一定在这些区间的并里
+    //  每轮取各区间的中间元素，按区间长度加权选出中位数作主元，用 rankOf 在各树上把区间切成
+    //  “小于主元”与“大于主元”两半；加权中位数保证每轮至少丢掉约 1/4 的候选，O(log n) 轮
+    struct Range {
+        const Tree* t;
+        int lo, hi;
+    };
+    QVector<Range> rs;
+    rs.reserve(ts.size());
+    int total = 0;
+    for (const Tree* t : ts) {
+        rs.push_back(Range{t, 0, t->size()});
+        total += t->size();
+    }
+    if (k >= total) return false;
+
+    struct Cand {
+        SalaryKey key;
+        int weight;
+        int owner; //主元所在的区间
+    };
+    QVector<Cand> cands;
+    cands.reserve(rs.size());
+    for (;;) {
+        cands.clear();
+        int live = 0;
+        for (int i = 0; i < rs.size(); ++i) {
+            const int w = rs[i].hi - rs[i].lo;
+            if (w <= 0) continue;
+            cands.push_back(Cand{*rs[i].t->kth(rs[i].lo + w / 2), w, i});
+            live += w;
+        }
+        std::sort(cands.begin(), cands.end(), [](const Cand& a, const Cand& b) { return a.key < b.key; });
+        int acc = 0;
+        const Cand* pivot = &cands.last();
+        for (const Cand& c : cands) {
+            acc += c.weight;
+            if (2 * acc >= live) { pivot = &c; break; }
+        }
+
+        int less = 0;
+        QVector<int> cut(rs.size());
+        for (int i = 0; i < rs.size(); ++i) {
+            const int r = rs[i].t->rankOf(pivot->key);
+            cut[i] = std::min(std::max(r, rs[i].lo), rs[i].hi);
+            less += cut[i] - rs[i].lo;
+        }
+        if (k == less) {
+            *out = pivot->key;
+            return true;
+        }
+        for (int i = 0; i < rs.size(); ++i) {
+            if (k < less) {
+                rs[i].hi = cut[i];
+            } else {
+                //key 唯一：主元只在它自己的树里，跳过它本身
+                rs[i].lo = cut[i] + (i == pivot->owner ? 1 : 0);
+            }
+        }
+        if (k > less) k -= less + 1;
+    }
+}
+
+bool DeptSalaryIndex::percentile(const QSet<int>& depnos, double p, double* out) const {
+    const int n = count(depnos);
+    if (n == 0) return false;
+    const double pos = std::min(std::max(p, 0.0), 1.0) * (n - 1);
+    const int lo = int(std::floor(pos));
+    SalaryKey a, b;
+    if (!kth(depnos, lo, &a)) return false;
+    if (pos == lo) {
+        *out = a.salary;
+        return true;
+    }
+    if (!kth(depnos, lo + 1, &b)) return false;
+    *out = a.salary + (b.salary - a.salary) * (pos - lo);
+    return true;
+}
+
+QVector<int> DeptSalaryIndex::histogram(const QSet<int>& depnos, const QVector<double>& edges) const {
+    QVector<int> counts;
+    if (edges.size() < 2) return counts;
+    //每条边界一次 countBelow；最后一段含右端点，用“低于右端点的下一个可表示值”
+    QVector<int> below(edges.size());
+    for (int i = 0; i < edges.size(); ++i) {
+        const bool last = i + 1 == edges.size();
+        below[i] = countBelow(depnos, last ? std::nextafter(edges[i], HUGE_VAL) : edges[i]);
+    }
+    counts.reserve(edges.size() - 1);
+    for (int i = 0; i + 1 < edges.size(); ++i) counts.push_back(below[i + 1] - below[i]);
+    return counts;
+}
+
+QVector<double> DeptSalaryIndex::evenEdges(double lo, double hi, int buckets) {
+    QVector<double> edges;
+    if (buckets <= 0 || !(hi >= lo)) return edges;
+    edges.reserve(buckets + 1);
+    const double w = (hi - lo) / buckets;
+    for (int i = 0; i < buckets; ++i) edges.push_back(lo + w * i);
+    edges.push_back(hi);
+    return edges;
+}
+
+MemUsage DeptSalaryIndex::memoryUsage() const {
+    MemUsage u = m_all.memoryUsage();
+    for (const auto& kv : m_byDept) {
+        u += kv.second.memoryUsage();
+        //unordered_map 节点：next 指针 + key + 树对象
+        const qint64 node = qint64(sizeof(void*) + sizeof(kv));
+        u.index += node;
+        u.slack += MemAcct::heapBlock(node) - node;
+    }
+    u.index += qint64(m_byDept.bucket_count()) * qint64(sizeof(void*));
+    MemAcct::addHash(m_pos, &u);
+    return u;
+}
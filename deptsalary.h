@@ -0,0 +1,94 @@
+#ifndef DEPTSALARY_H
+#define DEPTSALARY_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <unordered_map>
+
+#include "avl.h"
+#include "memusage.h"
+
+//工资索引的 key：工资相同按工号区分，保证唯一
+struct SalaryKey {
+    double salary;
+    int no;
+    bool operator<(const SalaryKey& o) const {
+        return salary < o.salary || (salary == o.salary && no < o.no);
+    }
+};
+
+struct SalaryKeyOf {
+    const SalaryKey& operator()(const SalaryKey& k) const { return k; }
+};
+
+//按部门分组的工资有序索引：每个 depno 一棵以 (salary, no) 为 key 的 AVL（带子树大小），另有一棵全体员工的
+//  部门子树的前 K 高 / 前 K 低：各部门树的最大（最小）元素进堆，每弹出一个再补上同一棵树里的下一个，
+//  O((部门数 + K) log n)，不用过滤、排序全部员工
+//  顺序统计（第 k 小、分位数、直方图）：全部门或单个部门直接在一棵树上按子树大小走，O(log n)；
+//  多个部门时在各树上做加权中位数划分，O(部门数 · log² n)
+//  员工增删改按工号增量维护（记着每个工号当前在哪棵树、哪个 key 下）
+class DeptSalaryIndex {
+public:
+    using Tree = AvlIndex<SalaryKey, SalaryKeyOf, std::less<>, SubtreeSize>;
+
+    DeptSalaryIndex() = default;
+    DeptSalaryIndex(const DeptSalaryIndex&) = delete;
+    DeptSalaryIndex& operator=(const DeptSalaryIndex&) = delete;
+
+    void clear();
+
+    //全量重建；Index 为 AvlTree / BPlusTree 等带 forEachInorder 的员工索引
+    template <class Index>
+    void rebuild(const Index& emps) {
+        clear();
+        m_pos.reserve(emps.size());
+        emps.forEachInorder([this](const Emp& e) { upsert(e); });
+    }
+
+    //工号 no 的当前状态：cur 为 nullptr 表示已删除
+    void sync(int no, const Emp* cur);
+    void upsert(const Emp& e);
+    void remove(int no);
+
+    int size() const { return m_pos.size(); }
+
+    //depnos 里各部门（为空表示全部部门）工资最高（highest）或最低的 k 个，按工资从高到低 / 从低到高
+    //工资相同时工号大的排在前面（最高）或工号小的排在前面（最低）
+    QVector<SalaryKey> topK(const QSet<int>& depnos, int k, bool highest) const;
+
+    //---- 顺序统计：depnos 为空表示全部部门 ----
+
+    int count(const QSet<int>& depnos) const;
+    //工资第 k 小（0 起），越界返回 false
+    bool kth(const QSet<int>& depnos, int k, SalaryKey* out) const;
+    //分位数 p ∈ [0, 1]，相邻两名之间线性插值（p = 0.5 即中位数）；没有员工时返回 false
+    bool percentile(const QSet<int>& depnos, double p, double* out) const;
+    //工资严格低于 salary 的人数
+    int countBelow(const QSet<int>& depnos, double salary) const;
+
+    //定宽分段：edges 升序，第 i 段为 [edges[i], edges[i+1])，最后一段含右端点；段外的不计
+    QVector<int> histogram(const QSet<int>& depnos, const QVector<double>& edges) const;
+    //把 [lo, hi] 等分成 buckets 段的边界
+    static QVector<double> evenEdges(double lo, double hi, int buckets);
+
+    //单个部门的树，没有员工时返回 nullptr
+    const Tree* tree(int depno) const;
+    const Tree& allTree() const { return m_all; }
+
+    MemUsage memoryUsage() const;
+
+private:
+    struct Pos {
+        int depno;
+        double salary;
+    };
+    //参与统计的树：全部部门时只有 m_all
+    QVector<const Tree*> treesOf(const QSet<int>& depnos) const;
+
+    Tree m_all;
+    std::unordered_map<int, Tree> m_byDept; //AvlIndex 不可拷贝/移动，节点式容器原地构造
+    QHash<int, Pos> m_pos;                  //工号 -> 当前所在的部门与工资
+};
+
+#endif
@@ -1,13 +1,18 @@
 #include "depttree.h"
 
+#include "trace.h"
+
 DeptTree::DeptTree() {
     clear();
 }
 
 void DeptTree::clear() {
+    m_gen++;
     m_nodes.clear();
     m_firstChild.clear();
     m_nextSibling.clear();
+    m_parent.clear();
+    m_idByDepno.clear();
 
     //id=0，全部呀部门
     DeptRow root;
@@ -20,9 +25,11 @@ void DeptTree::clear() {
     //根节点默认没有孩子、没有兄弟
     m_firstChild[0] = 0;
     m_nextSibling[0] = 0;
+    m_parent[0] = 0;
 }
 
 void DeptTree::buildFromRows(const QVector<DeptRow>& rows) {
+    TRACE_SCOPE("deptTree.build");
     clear();
 
     for (const auto& r : rows) {
@@ -30,6 +37,7 @@ void DeptTree::buildFromRows(const QVector<DeptRow>& rows) {
         m_nodes[r.id] = r;
         m_firstChild[r.id] = 0;
         m_nextSibling[r.id] = 0;
+        m_idByDepno[r.depno] = r.id;
     }
 
     for (const auto& r : rows) {
@@ -42,18 +50,7 @@ void DeptTree::buildFromRows(const QVector<DeptRow>& rows) {
             if (!m_nodes.contains(pid)) pid = 0; //父不存在则挂到根
         }
 
-        int childId = r.id;
-
-        if (!m_firstChild.contains(pid) || m_firstChild.value(pid, 0) == 0) {
-            m_firstChild[pid] = childId;
-        } else {
-            int cur = m_firstChild.value(pid);
-            while (cur != 0 && m_nextSibling.value(cur, 0) != 0) {
-                cur = m_nextSibling.value(cur);
-            }
-            m_nextSibling[cur] = childId;
-        }
-
+        linkChild(pid, r.id);
     }
 
     if (!m_firstChild.contains(0)) m_firstChild[0] = 0;
@@ -73,11 +70,16 @@ QString DeptTree::nameOf(int id) const {
 
 bool DeptTree::containsDepno(int depno) const {
     if (depno <= 0) return false;
-    for (auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
-        if (it.key() == 0) continue; //跳过全部部门
-        if (it.value().depno == depno) return true;
-    }
-    return false;
+    return m_idByDepno.contains(depno);
+}
+
+QString DeptTree::labelOf(int id) const {
+    return QString("%1 - %2").arg(depnoOf(id)).arg(nameOf(id));
+}
+
+int DeptTree::idOfDepno(int depno) const {
+    if (depno <= 0) return -1;
+    return m_idByDepno.value(depno, -1);
 }
 
 QList<int> DeptTree::childrenOf(int id) const {
@@ -99,3 +101,172 @@ QList<int> DeptTree::childrenOf(int id) const {
 QList<int> DeptTree::allIds() const {
     return m_nodes.keys();
 }
+
+int DeptTree::parentOf(int id) const {
+    return m_parent.value(id, 0);
+}
+
+bool DeptTree::isInSubtree(int id, int anc) const {
+    if (anc == 0) return m_nodes.contains(id);
+    int cur = id;
+    int guard = m_nodes.size(); //数据异常成环时也能结束
+    while (cur != 0 && guard-- > 0) {
+        if (cur == anc) return true;
+        cur = m_parent.value(cur, 0);
+    }
+    return false;
+}
+
+void DeptTree::linkChild(int pid, int id) {
+    m_parent[id] = pid;
+    m_nextSibling[id] = 0;
+
+    int cur = m_firstChild.value(pid, 0);
+    if (cur == 0) {
+        m_firstChild[pid] = id;
+        return;
+    }
+    while (m_nextSibling.value(cur, 0) != 0) cur = m_nextSibling.value(cur);
+    m_nextSibling[cur] = id;
+}
+
+void DeptTree::unlinkChild(int pid, int id) {
+    int cur = m_firstChild.value(pid, 0);
+    if (cur == id) {
+        m_firstChild[pid] = m_nextSibling.value(id, 0);
+    } else {
+        while (cur != 0 && m_nextSibling.value(cur, 0) != id) cur = m_nextSibling.value(cur, 0);
+        if (cur != 0) m_nextSibling[cur] = m_nextSibling.value(id, 0);
+    }
+    m_nextSibling[id] = 0;
+}
+
+bool DeptTree::addDept(const DeptRow& r, QString* err) {
+    if (r.id <= 0 || m_nodes.contains(r.id)) {
+        if (err) *err = QString("部门 id %1 无效或已存在").arg(r.id);
+        return false;
+    }
+    if (containsDepno(r.depno)) {
+        if (err) *err = QString("部门号 %1 已存在").arg(r.depno);
+        return false;
+    }
+    int pid = 0;
+    if (r.parentId.isValid() && !r.parentId.isNull()) {
+        pid = r.parentId.toInt();
+        if (!m_nodes.contains(pid)) pid = 0;
+    }
+
+    m_nodes[r.id] = r;
+    m_firstChild[r.id] = 0;
+    m_idByDepno[r.depno] = r.id;
+    linkChild(pid, r.id);
+    m_gen++;
+    return true;
+}
+
+bool DeptTree::moveDept(int id, int newParentId, QString* err) {
+    if (id == 0 || !m_nodes.contains(id)) {
+        if (err) *err = "要移动的部门不存在";
+        return false;
+    }
+    if (!m_nodes.contains(newParentId)) {
+        if (err) *err = "目标上级部门不存在";
+        return false;
+    }
+    //新父节点在被移动的子树里就会成环
+    if (isInSubtree(newParentId, id)) {
+        if (err) *err = "不能把部门移动到它自己或它的下级部门下面";
+        return false;
+    }
+
+    const int oldParent = parentOf(id);
+    if (oldParent == newParentId) return true;
+
+    unlinkChild(oldParent, id);
+    linkChild(newParentId, id);
+    m_nodes[id].parentId = newParentId == 0 ? QVariant() : QVariant(newParentId);
+    m_gen++;
+    return true;
+}
+
+bool DeptTree::renameDept(int id, const QString& name, QString* err) {
+    if (id == 0 || !m_nodes.contains(id)) {
+        if (err) *err = "部门不存在";
+        return false;
+    }
+    m_nodes[id].name = name;
+    m_gen++;
+    return true;
+}
+
+bool DeptTree::setDepno(int id, int depno, QString* err) {
+    if (id == 0 || !m_nodes.contains(id)) {
+        if (err) *err = "部门不存在";
+        return false;
+    }
+    const int old = m_nodes[id].depno;
+    if (old == depno) return true;
+    if (m_idByDepno.value(depno, id) != id) {
+        if (err) *err = QString("部门号 %1 已存在").arg(depno);
+        return false;
+    }
+    m_idByDepno.remove(old);
+    m_idByDepno[depno] = id;
+    m_nodes[id].depno = depno;
+    m_gen++;
+    return true;
+}
+
+bool DeptTree::removeDept(int id, QString* err) {
+    if (id == 0 || !m_nodes.contains(id)) {
+        if (err) *err = "部门不存在";
+        return false;
+    }
+
+    const int pid = parentOf(id);
+    const QList<int> kids = childrenOf(id);
+    unlinkChild(pid, id);
+    for (int c : kids) {
+        linkChild(pid, c);
+        m_nodes[c].parentId = pid == 0 ? QVariant() : QVariant(pid);
+    }
+
+    m_idByDepno.remove(m_nodes[id].depno);
+    m_nodes.remove(id);
+    m_firstChild.remove(id);
+    m_nextSibling.remove(id);
+    m_parent.remove(id);
+    m_gen++;
+    return true;
+}
+
+QSet<int> DeptTree::subtreeDepnos(int id) const {
+    QSet<int> out;
+    if (!m_nodes.contains(id)) return out;
+
+    QVector<int> stack;
+    stack.push_back(id);
+    while (!stack.isEmpty()) {
+        int cur = stack.takeLast();
+        out.insert(depnoOf(cur));
+        for (int c = m_firstChild.value(cur, 0); c != 0; c = m_nextSibling.value(c, 0)) {
+            stack.push_back(c);
+        }
+    }
+    return out;
+}
+
+MemUsage DeptTree::memoryUsage(MemAcct::Seen* seen) const {
+    MemUsage u;
+    MemAcct::addMap(m_nodes, &u, seen);
+
+    //孩子链表与父指针只是结构，整张表都算索引开销
+    MemUsage links;
+    MemAcct::addMap(m_firstChild, &links);
+    MemAcct::addMap(m_nextSibling, &links);
+    MemAcct::addMap(m_parent, &links);
+    MemAcct::addHash(m_idByDepno, &links);
+    u.index += links.nodes + links.index;
+    u.slack += links.slack;
+    return u;
+}
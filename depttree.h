@@ -1,11 +1,15 @@
 #ifndef DEPTTREE_H
 #define DEPTTREE_H
 
+#include <QHash>
 #include <QMap>
 #include <QVector>
 #include <QString>
 #include <QVariant>
 #include <QList>
+#include <QSet>
+
+#include "memusage.h"
 
 struct DeptRow {
     int id = 0;
@@ -29,17 +33,53 @@ public:
     //按depno 判断是否存在部门
     bool containsDepno(int depno) const;
 
+    //树控件上显示的文字："depno - name"
+    QString labelOf(int id) const;
+
+    //depno 对应的部门 id，不存在返回 -1
+    int idOfDepno(int depno) const;
+
     //树结构
     QList<int> childrenOf(int id) const;
+    bool hasChildren(int id) const { return m_firstChild.value(id, 0) != 0; }
+    //id 及其全部下级部门的 depno（迭代 DFS，不依赖界面节点）
+    QSet<int> subtreeDepnos(int id) const;
     QList<int> allIds() const;
+    int parentOf(int id) const;
+
+    //anc 是否为 id 本身或其祖先：沿父指针向上走，O(深度)
+    bool isInSubtree(int id, int anc) const;
+
+    //就地修改（不重建）：失败返回 false 并写 err
+    bool addDept(const DeptRow& r, QString* err = nullptr);
+    bool moveDept(int id, int newParentId, QString* err = nullptr);
+    bool renameDept(int id, const QString& name, QString* err = nullptr);
+    //改部门号（外部同步时用）
+    bool setDepno(int id, int depno, QString* err = nullptr);
+    //删除部门，它的子部门整体上移挂到它的父部门下（排在末尾）
+    bool removeDept(int id, QString* err = nullptr);
+
+    //结构或内容每改一次加一（重建、增删、移动、改名、改部门号），派生结果据此判断是否过期
+    quint64 generation() const { return m_gen; }
+
+    //部门行与三张结构表（QMap）+ depno 反查表（QHash）的内存占用；部门名按 seen 去重
+    MemUsage memoryUsage(MemAcct::Seen* seen = nullptr) const;
 
 private:
+    void linkChild(int pid, int id);   //挂到 pid 孩子链表末尾
+    void unlinkChild(int pid, int id); //从 pid 孩子链表摘下
 
     QMap<int, DeptRow> m_nodes;
 
     QMap<int, int> m_firstChild;
 
     QMap<int, int> m_nextSibling;
+
+    QMap<int, int> m_parent;
+
+    QHash<int, int> m_idByDepno;
+
+    quint64 m_gen = 0;
 };
 
 #endif
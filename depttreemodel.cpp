@@ -0,0 +1,183 @@
+#include "depttreemodel.h"
+
+#include "trace.h"
+
+DeptTreeModel::DeptTreeModel(const DeptTree* tree, QObject* parent)
+    : QAbstractItemModel(parent), m_tree(tree) {
+    reload();
+}
+
+void DeptTreeModel::reload() {
+    TRACE_SCOPE("deptModel.reload");
+    beginResetModel();
+    m_kids.clear();
+    m_row.clear();
+    m_parent.clear();
+
+    m_kids[kTop] = QVector<int>() << 0;
+    m_row[0] = 0;
+    m_parent[0] = kTop;
+    loadChildren(0); //顶级部门总是可见
+    endResetModel();
+}
+
+int DeptTreeModel::idOf(const QModelIndex& idx) {
+    return idx.isValid() ? int(idx.internalId()) : kTop;
+}
+
+QModelIndex DeptTreeModel::indexOfLoaded(int id) const {
+    if (id == kTop || !isLoaded(id)) return QModelIndex();
+    return createIndex(m_row.value(id), 0, quintptr(id));
+}
+
+QModelIndex DeptTreeModel::indexOfId(int id) {
+    if (!m_tree->containsId(id)) return QModelIndex();
+    if (isLoaded(id)) return indexOfLoaded(id);
+
+    //从 id 往上找到第一个已载入的祖先，再从上往下逐层载入
+    QVector<int> path;
+    int cur = id;
+    while (!isLoaded(cur)) {
+        path.push_back(cur);
+        cur = m_tree->parentOf(cur);
+    }
+    for (int i = path.size() - 1; i >= 0; --i) {
+        int pid = m_tree->parentOf(path[i]);
+        if (!isFetched(pid)) fetchMore(indexOfLoaded(pid));
+        if (!isLoaded(path[i])) return QModelIndex();
+    }
+    return indexOfLoaded(id);
+}
+
+QModelIndex DeptTreeModel::index(int row, int column, const QModelIndex& parent) const {
+    if (column != 0) return QModelIndex();
+    const auto it = m_kids.constFind(idOf(parent));
+    if (it == m_kids.constEnd() || row < 0 || row >= it->size()) return QModelIndex();
+    return createIndex(row, 0, quintptr(it->at(row)));
+}
+
+QModelIndex DeptTreeModel::parent(const QModelIndex& child) const {
+    if (!child.isValid()) return QModelIndex();
+    return indexOfLoaded(m_parent.value(int(child.internalId()), kTop));
+}
+
+int DeptTreeModel::rowCount(const QModelIndex& parent) const {
+    if (parent.column() > 0) return 0;
+    const auto it = m_kids.constFind(idOf(parent));
+    return it == m_kids.constEnd() ? 0 : it->size();
+}
+
+int DeptTreeModel::columnCount(const QModelIndex&) const {
+    return 1;
+}
+
+QVariant DeptTreeModel::data(const QModelIndex& idx, int role) const {
+    if (!idx.isValid()) return QVariant();
+    const int id = int(idx.internalId());
+    if (role == Qt::DisplayRole) return m_tree->labelOf(id);
+    if (role == Qt::UserRole) return id;
+    return QVariant();
+}
+
+QVariant DeptTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole) return QStringLiteral("部门");
+    return QVariant();
+}
+
+bool DeptTreeModel::hasChildren(const QModelIndex& parent) const {
+    const int id = idOf(parent);
+    if (isFetched(id)) return !m_kids.value(id).isEmpty();
+    return m_tree->hasChildren(id);
+}
+
+bool DeptTreeModel::canFetchMore(const QModelIndex& parent) const {
+    const int id = idOf(parent);
+    return !isFetched(id) && m_tree->hasChildren(id);
+}
+
+void DeptTreeModel::fetchMore(const QModelIndex& parent) {
+    const int id = idOf(parent);
+    if (isFetched(id)) return;
+    const int n = m_tree->childrenOf(id).size();
+    if (n == 0) {
+        m_kids[id];
+        return;
+    }
+    beginInsertRows(parent, 0, n - 1);
+    loadChildren(id);
+    endInsertRows();
+}
+
+void DeptTreeModel::loadChildren(int id) {
+    QVector<int>& kids = m_kids[id];
+    kids.clear();
+    for (int c : m_tree->childrenOf(id)) {
+        m_row[c] = kids.size();
+        m_parent[c] = id;
+        kids.push_back(c);
+    }
+}
+
+//孩子未载入时不用插行，展开时 fetchMore 会从 DeptTree 读到它
+void DeptTreeModel::appendDeptNode(int pid, int id) {
+    if (!isFetched(pid)) {
+        QModelIndex p = indexOfLoaded(pid);
+        if (p.isValid()) emit dataChanged(p, p); //展开箭头可能需要出现
+        return;
+    }
+    QVector<int>& kids = m_kids[pid];
+    const int n = kids.size();
+    beginInsertRows(indexOfLoaded(pid), n, n);
+    kids.push_back(id);
+    m_row[id] = n;
+    m_parent[id] = pid;
+    endInsertRows();
+}
+
+void DeptTreeModel::removeDeptNode(int id) {
+    if (!isLoaded(id)) return;
+    const int pid = m_parent.value(id);
+    const int r = m_row.value(id);
+
+    beginRemoveRows(indexOfLoaded(pid), r, r);
+    QVector<int>& kids = m_kids[pid];
+    kids.remove(r);
+    for (int i = r; i < kids.size(); ++i) m_row[kids[i]] = i;
+    unloadSubtree(id);
+    endRemoveRows();
+}
+
+void DeptTreeModel::unloadSubtree(int id) {
+    QVector<int> stack;
+    stack.push_back(id);
+    while (!stack.isEmpty()) {
+        int cur = stack.takeLast();
+        m_row.remove(cur);
+        m_parent.remove(cur);
+        const auto it = m_kids.constFind(cur);
+        if (it != m_kids.constEnd()) {
+            for (int c : *it) stack.push_back(c);
+            m_kids.remove(cur);
+        }
+    }
+}
+
+void DeptTreeModel::deptAdded(int id) {
+    appendDeptNode(m_tree->parentOf(id), id);
+}
+
+void DeptTreeModel::deptRenamed(int id) {
+    QModelIndex idx = indexOfLoaded(id);
+    if (idx.isValid()) emit dataChanged(idx, idx);
+}
+
+//先摘下再挂到新父节点末尾（与 DeptTree 的顺序一致）；移走的子树按未展开处理
+void DeptTreeModel::deptMoved(int id) {
+    removeDeptNode(id);
+    appendDeptNode(m_tree->parentOf(id), id);
+}
+
+void DeptTreeModel::deptRemoved(int id, const QList<int>& kids, int newParent) {
+    removeDeptNode(id);
+    for (int c : kids) appendDeptNode(newParent, c);
+}
@@ -0,0 +1,65 @@
+#ifndef DEPTTREEMODEL_H
+#define DEPTTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "depttree.h"
+
+//部门树模型：直接读 DeptTree，不复制部门数据
+//  只有展开过的节点才把孩子载入（canFetchMore/fetchMore），几万个部门也不会一次建完
+//  已载入节点记录 id -> 行号/父 id，id 转 QModelIndex 为 O(1)
+//  部门增删改移后调用对应的 deptXxx()，只发出受影响行的变更信号
+class DeptTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+public:
+    explicit DeptTreeModel(const DeptTree* tree, QObject* parent = nullptr);
+
+    //DeptTree 整体重建后调用
+    void reload();
+
+    //id 对应的 index；未载入时先沿祖先链逐层载入（O(深度)）
+    QModelIndex indexOfId(int id);
+    //无效 index（顶层之上）返回 -1
+    static int idOf(const QModelIndex& idx);
+
+    //DeptTree 已就地修改后调用
+    void deptAdded(int id);
+    void deptRenamed(int id);
+    void deptMoved(int id);
+    //kids：删除前 id 的孩子，它们已挂到 newParent 下
+    void deptRemoved(int id, const QList<int>& kids, int newParent);
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& idx, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+private:
+    //不可见的顶层父节点，唯一的孩子是 id=0（全部部门）
+    static const int kTop = -1;
+
+    const DeptTree* m_tree;
+
+    QHash<int, QVector<int>> m_kids; //已载入的孩子（key 为父 id）
+    QHash<int, int> m_row;           //已载入节点在父节点中的行号
+    QHash<int, int> m_parent;        //已载入节点的父 id（以模型为准，不受 DeptTree 先改影响）
+
+    bool isLoaded(int id) const { return m_row.contains(id); }
+    bool isFetched(int id) const { return m_kids.contains(id); }
+    QModelIndex indexOfLoaded(int id) const;
+
+    void loadChildren(int id);
+    void appendDeptNode(int pid, int id);
+    void removeDeptNode(int id);
+    void unloadSubtree(int id);
+};
+
+#endif
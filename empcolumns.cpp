@@ -0,0 +1,398 @@
+#include "empcolumns.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "trace.h"
+
+//x86 上用函数级 target 属性编译 AVX2 内核，运行时再按 CPU 能力分发，
+//这样整个工程不需要 -mavx2，老 CPU 上也能跑（退回 SSE2 / 标量）
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EMCOL_HAVE_AVX2 1
+#define EMCOL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EMCOL_HAVE_SSE2 1
+#endif
+
+#if defined(EMCOL_HAVE_AVX2) || defined(EMCOL_HAVE_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool cpuHasAvx2() {
+#ifdef EMCOL_HAVE_AVX2
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+#else
+    return false;
+#endif
+}
+
+//把 mask 中为 1 的位对应的行号写到 out[k..]，返回新的 k
+inline int emitBits(unsigned mask, int base, int* out, int k) {
+    while (mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        int b = __builtin_ctz(mask);
+#else
+        int b = 0;
+        while (!(mask & (1u << b))) ++b;
+#endif
+        out[k++] = base + b;
+        mask &= mask - 1;
+    }
+    return k;
+}
+
+//---------------- 工资区间 ----------------
+
+int salaryRangeScalar(const double* s, int from, int n, double lo, double hi, int* out, int k) {
+    for (int i = from; i < n; ++i) {
+        out[k] = i;
+        k += (s[i] >= lo && s[i] <= hi) ? 1 : 0; //无分支压缩
+    }
+    return k;
+}
+
+#ifdef EMCOL_HAVE_SSE2
+int salaryRangeSse2(const double* s, int n, double lo, double hi, int* out) {
+    const __m128d vlo = _mm_set1_pd(lo);
+    const __m128d vhi = _mm_set1_pd(hi);
+    int k = 0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(s + i);
+        __m128d m = _mm_and_pd(_mm_cmpge_pd(v, vlo), _mm_cmple_pd(v, vhi));
+        k = emitBits(unsigned(_mm_movemask_pd(m)), i, out, k);
+    }
+    return salaryRangeScalar(s, i, n, lo, hi, out, k);
+}
+#endif
+
+#ifdef EMCOL_HAVE_AVX2
+EMCOL_TARGET_AVX2
+int salaryRangeAvx2(const double* s, int n, double lo, double hi, int* out) {
+    const __m256d vlo = _mm256_set1_pd(lo);
+    const __m256d vhi = _mm256_set1_pd(hi);
+    int k = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(s + i);
+        __m256d m = _mm256_and_pd(_mm256_cmp_pd(v, vlo, _CMP_GE_OQ),
+                                  _mm256_cmp_pd(v, vhi, _CMP_LE_OQ));
+        k = emitBits(unsigned(_mm256_movemask_pd(m)), i, out, k);
+    }
+    return salaryRangeScalar(s, i, n, lo, hi, out, k);
+}
+#endif
+
+//---------------- 部门集合 ----------------
+//集合先展开成按 depno 下标的查找表（成员为 -1，否则 0），过滤就是一次查表
+
+int deptSetScalar(const int* d, int from, int n, const int* lut, int lutSize, int* out, int k) {
+    for (int i = from; i < n; ++i) {
+        unsigned x = unsigned(d[i]);
+        out[k] = i;
+        k += (x < unsigned(lutSize) && lut[x]) ? 1 : 0;
+    }
+    return k;
+}
+
+#ifdef EMCOL_HAVE_AVX2
+EMCOL_TARGET_AVX2
+int deptSetAvx2(const int* d, int n, const int* lut, int lutSize, int* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vmax = _mm256_set1_epi32(lutSize - 1);
+    int k = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+        //0 <= depno <= lutSize-1 的才去查表，越界的 lane 直接视为不命中
+        __m256i inRange = _mm256_andnot_si256(_mm256_cmpgt_epi32(zero, v),
+                                              _mm256_andnot_si256(_mm256_cmpgt_epi32(v, vmax),
+                                                                  _mm256_set1_epi32(-1)));
+        __m256i hit = _mm256_mask_i32gather_epi32(zero, lut, v, inRange, 4);
+        unsigned m = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+        k = emitBits(m, i, out, k);
+    }
+    return deptSetScalar(d, i, n, lut, lutSize, out, k);
+}
+#endif
+
+//---------------- sum / min / max ----------------
+
+void statsScalar(const double* s, int from, int n, double& sum, double& mn, double& mx) {
+    for (int i = from; i < n; ++i) {
+        sum += s[i];
+        mn = std::min(mn, s[i]);
+        mx = std::max(mx, s[i]);
+    }
+}
+
+#ifdef EMCOL_HAVE_SSE2
+void statsSse2(const double* s, int n, double& sum, double& mn, double& mx) {
+    __m128d vs = _mm_setzero_pd();
+    __m128d vmn = _mm_set1_pd(mn);
+    __m128d vmx = _mm_set1_pd(mx);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(s + i);
+        vs = _mm_add_pd(vs, v);
+        vmn = _mm_min_pd(vmn, v);
+        vmx = _mm_max_pd(vmx, v);
+    }
+    double a[2], b[2], c[2];
+    _mm_storeu_pd(a, vs);
+    _mm_storeu_pd(b, vmn);
+    _mm_storeu_pd(c, vmx);
+    sum += a[0] + a[1];
+    mn = std::min(b[0], b[1]);
+    mx = std::max(c[0], c[1]);
+    statsScalar(s, i, n, sum, mn, mx);
+}
+#endif
+
+#ifdef EMCOL_HAVE_AVX2
+EMCOL_TARGET_AVX2
+void statsAvx2(const double* s, int n, double& sum, double& mn, double& mx) {
+    __m256d vs = _mm256_setzero_pd();
+    __m256d vmn = _mm256_set1_pd(mn);
+    __m256d vmx = _mm256_set1_pd(mx);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(s + i);
+        vs = _mm256_add_pd(vs, v);
+        vmn = _mm256_min_pd(vmn, v);
+        vmx = _mm256_max_pd(vmx, v);
+    }
+    double a[4], b[4], c[4];
+    _mm256_storeu_pd(a, vs);
+    _mm256_storeu_pd(b, vmn);
+    _mm256_storeu_pd(c, vmx);
+    sum += (a[0] + a[1]) + (a[2] + a[3]);
+    mn = std::min(std::min(b[0], b[1]), std::min(b[2], b[3]));
+    mx = std::max(std::max(c[0], c[1]), std::max(c[2], c[3]));
+    statsScalar(s, i, n, sum, mn, mx);
+}
+
+EMCOL_TARGET_AVX2
+void statsRowsAvx2(const double* s, const int* rows, int n, double& sum, double& mn, double& mx) {
+    __m256d vs = _mm256_setzero_pd();
+    __m256d vmn = _mm256_set1_pd(mn);
+    __m256d vmx = _mm256_set1_pd(mx);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + i));
+        __m256d v = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), s, idx, all, 8);
+        vs = _mm256_add_pd(vs, v);
+        vmn = _mm256_min_pd(vmn, v);
+        vmx = _mm256_max_pd(vmx, v);
+    }
+    double a[4], b[4], c[4];
+    _mm256_storeu_pd(a, vs);
+    _mm256_storeu_pd(b, vmn);
+    _mm256_storeu_pd(c, vmx);
+    sum += (a[0] + a[1]) + (a[2] + a[3]);
+    mn = std::min(std::min(b[0], b[1]), std::min(b[2], b[3]));
+    mx = std::max(std::max(c[0], c[1]), std::max(c[2], c[3]));
+    for (; i < n; ++i) {
+        double x = s[rows[i]];
+        sum += x;
+        mn = std::min(mn, x);
+        mx = std::max(mx, x);
+    }
+}
+#endif
+
+} // namespace
+
+void EmpColumns::clear() {
+    m_no.clear();
+    m_depno.clear();
+    m_salary.clear();
+    m_nameRef.clear();
+    m_nameChars = 0;
+}
+
+void EmpColumns::buildFrom(const EmpIndex& tree) {
+    TRACE_SCOPE("columns.build");
+    clear();
+    const int n = tree.size();
+    m_no.reserve(n);
+    m_depno.reserve(n);
+    m_salary.reserve(n);
+    m_nameRef.reserve(n);
+
+    tree.forEachInorder([this](const Emp& e) {
+        m_no.push_back(e.no);
+        m_depno.push_back(e.depno);
+        m_salary.push_back(e.salary);
+        m_nameRef.push_back(e.name);
+        m_nameChars += e.name.len;
+    });
+}
+
+Emp EmpColumns::rowAt(int row) const {
+    Emp e;
+    e.no = m_no[row];
+    e.name = m_nameRef[size_t(row)];
+    e.depno = m_depno[row];
+    e.salary = m_salary[row];
+    return e;
+}
+
+int EmpColumns::rowOfNo(int no) const {
+    auto it = std::lower_bound(m_no.begin(), m_no.end(), no);
+    if (it == m_no.end() || *it != no) return -1;
+    return int(it - m_no.begin());
+}
+
+int EmpColumns::rowLowerBound(int no) const {
+    return int(std::lower_bound(m_no.begin(), m_no.end(), no) - m_no.begin());
+}
+
+QVector<int> EmpColumns::allRows() const {
+    QVector<int> out(size());
+    for (int i = 0; i < out.size(); ++i) out[i] = i;
+    return out;
+}
+
+QVector<int> EmpColumns::filterSalaryRange(double lo, double hi) const {
+    return filterSalaryRange(lo, hi, 0, size());
+}
+
+QVector<int> EmpColumns::filterSalaryRange(double lo, double hi, int from, int to) const {
+    TRACE_SCOPE("columns.filterSalaryRange");
+    const int n = to - from;
+    if (n <= 0) return QVector<int>();
+    const double* s = m_salary.data() + from;
+    QVector<int> out(n);
+    int k = 0;
+#ifdef EMCOL_HAVE_AVX2
+    if (cpuHasAvx2()) k = salaryRangeAvx2(s, n, lo, hi, out.data());
+    else
+#endif
+#ifdef EMCOL_HAVE_SSE2
+    k = salaryRangeSse2(s, n, lo, hi, out.data());
+#else
+    k = salaryRangeScalar(s, 0, n, lo, hi, out.data(), 0);
+#endif
+    out.resize(k);
+    if (from != 0) {
+        for (int& r : out) r += from;
+    }
+    return out;
+}
+
+QVector<int> EmpColumns::filterDeptSet(const QSet<int>& depnos) const {
+    return filterDeptSet(depnos, 0, size());
+}
+
+QVector<int> EmpColumns::filterDeptSet(const QSet<int>& depnos, int from, int to) const {
+    TRACE_SCOPE("columns.filterDeptSet");
+    const int n = to - from;
+    if (n <= 0) return QVector<int>();
+    const int* d = m_depno.data() + from;
+
+    int minDep = 0;
+    int maxDep = -1;
+    for (int x : depnos) {
+        minDep = std::min(minDep, x);
+        maxDep = std::max(maxDep, x);
+    }
+
+    QVector<int> out(n);
+    int k = 0;
+
+    //查表用的 LUT 按最大部门号开：部门号稀疏（如 9 位编码）时它会比要扫的行大得多，
+    //建表本身就比扫描贵，这时也走哈希集合；负 depno 正常数据里不会出现，出现时同样走哈希集合
+    const qint64 kLutSlack = 4096;
+    if (minDep < 0 || qint64(maxDep) > 4 * qint64(n) + kLutSlack) {
+        for (int i = 0; i < n; ++i) {
+            if (depnos.contains(d[i])) out[k++] = i;
+        }
+    } else {
+        if (maxDep < 0) return QVector<int>();
+
+        std::vector<int> lut(size_t(maxDep) + 1, 0);
+        for (int x : depnos) lut[size_t(x)] = -1;
+
+#ifdef EMCOL_HAVE_AVX2
+        if (cpuHasAvx2()) k = deptSetAvx2(d, n, lut.data(), int(lut.size()), out.data());
+        else
+#endif
+        k = deptSetScalar(d, 0, n, lut.data(), int(lut.size()), out.data(), 0);
+    }
+
+    out.resize(k);
+    if (from != 0) {
+        for (int& r : out) r += from;
+    }
+    return out;
+}
+
+EmpColumns::SalaryStats EmpColumns::salaryStats(const QVector<int>* rows) const {
+    TRACE_SCOPE("columns.salaryStats");
+    SalaryStats st;
+    const int n = rows ? rows->size() : size();
+    if (n == 0) return st;
+
+    double sum = 0;
+    double mn = std::numeric_limits<double>::infinity();
+    double mx = -std::numeric_limits<double>::infinity();
+
+    if (!rows) {
+#ifdef EMCOL_HAVE_AVX2
+        if (cpuHasAvx2()) statsAvx2(m_salary.data(), n, sum, mn, mx);
+        else
+#endif
+#ifdef EMCOL_HAVE_SSE2
+        statsSse2(m_salary.data(), n, sum, mn, mx);
+#else
+        statsScalar(m_salary.data(), 0, n, sum, mn, mx);
+#endif
+    } else {
+#ifdef EMCOL_HAVE_AVX2
+        if (cpuHasAvx2()) {
+            statsRowsAvx2(m_salary.data(), rows->constData(), n, sum, mn, mx);
+        } else
+#endif
+        {
+            for (int r : *rows) {
+                double x = m_salary[size_t(r)];
+                sum += x;
+                mn = std::min(mn, x);
+                mx = std::max(mx, x);
+            }
+        }
+    }
+
+    st.count = n;
+    st.sum = sum;
+    st.min = mn;
+    st.max = mx;
+    return st;
+}
+
+const char* EmpColumns::kernelName() {
+#ifdef EMCOL_HAVE_AVX2
+    if (cpuHasAvx2()) return "avx2";
+#endif
+#ifdef EMCOL_HAVE_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+MemUsage EmpColumns::memoryUsage() const {
+    MemUsage u;
+    MemAcct::addStdVector(m_no, &u);
+    MemAcct::addStdVector(m_depno, &u);
+    MemAcct::addStdVector(m_salary, &u);
+    MemAcct::addStdVector(m_nameRef, &u);
+    return u;
+}
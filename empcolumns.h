@@ -0,0 +1,78 @@
+#ifndef EMPCOLUMNS_H
+#define EMPCOLUMNS_H
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <vector>
+
+#include "empindex.h"
+#include "namearena.h"
+
+//列式（struct-of-arrays）员工存储：
+//  no / depno / salary 各自连续存放，name 单独一列（直接拷贝员工的 NameArena::global() 句柄，显示时才转 QString）
+//  行按 no 升序排列（直接来自主索引的有序遍历），按 no 查找用二分
+//  工资区间、部门集合过滤和 sum/min/max 走向量化内核（AVX2/SSE2，否则标量）
+class EmpColumns {
+public:
+    struct SalaryStats {
+        int count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+    };
+
+    EmpColumns() = default;
+
+    void clear();
+    void buildFrom(const EmpIndex& tree);
+
+    int size() const { return int(m_no.size()); }
+    bool isEmpty() const { return m_no.empty(); }
+
+    int noAt(int row) const { return m_no[row]; }
+    int depnoAt(int row) const { return m_depno[row]; }
+    double salaryAt(int row) const { return m_salary[row]; }
+    QString nameAt(int row) const { return names().toString(m_nameRef[size_t(row)]); }
+    NameRef nameRefAt(int row) const { return m_nameRef[size_t(row)]; }
+    const NameArena& names() const { return NameArena::global(); }
+    Emp rowAt(int row) const;
+
+    //按 no 二分查找行号，不存在返回 -1
+    int rowOfNo(int no) const;
+    //第一个 no >= 给定值的行号（没有则为 size()）
+    int rowLowerBound(int no) const;
+
+    //0..size-1
+    QVector<int> allRows() const;
+
+    //lo <= salary <= hi 的行号（升序）
+    QVector<int> filterSalaryRange(double lo, double hi) const;
+    //depno 属于集合的行号（升序）
+    QVector<int> filterDeptSet(const QSet<int>& depnos) const;
+
+    //只扫描 [from, to) 行，供分块并行使用
+    QVector<int> filterSalaryRange(double lo, double hi, int from, int to) const;
+    QVector<int> filterDeptSet(const QSet<int>& depnos, int from, int to) const;
+
+    //rows 为空指针时统计全部行
+    SalaryStats salaryStats(const QVector<int>* rows = nullptr) const;
+
+    //员工姓名的内存统计：全局 arena + 每条记录的句柄，与逐条 QString 对比
+    NameArena::Stats nameStats() const { return names().stats(size(), m_nameChars); }
+
+    //四列数组计入 nodes；姓名数据在全局 arena 里，单独计
+    MemUsage memoryUsage() const;
+
+    //当前使用的内核："avx2" / "sse2" / "scalar"
+    static const char* kernelName();
+
+private:
+    std::vector<int> m_no;
+    std::vector<int> m_depno;
+    std::vector<double> m_salary;
+    std::vector<NameRef> m_nameRef;
+    qint64 m_nameChars = 0; //当前各行姓名的总码元数
+};
+
+#endif
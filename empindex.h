@@ -0,0 +1,16 @@
+#ifndef EMPINDEX_H
+#define EMPINDEX_H
+
+#include "avl.h"
+#include "bptree.h"
+
+//员工主索引的编译期选择：
+//  默认 AVL；在 .pro 中加 DEFINES += EMP_INDEX_BPTREE 改用 B+ 树
+//  两者接口一致：insert / remove / find / inorder / range / forEachInorder / forEachRange
+#ifdef EMP_INDEX_BPTREE
+using EmpIndex = BPlusTree;
+#else
+using EmpIndex = AvlTree;
+#endif
+
+#endif
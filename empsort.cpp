@@ -0,0 +1,207 @@
+#include "empsort.h"
+
+#include <QLocale>
+#include <QStringList>
+#include <algorithm>
+
+#include "parallelview.h"
+#include "trace.h"
+
+namespace {
+
+struct ColName {
+    EmpCol col;
+    const char* key;
+    const char* label;
+};
+
+const ColName kCols[] = {
+    {EmpCol::No, "no", "工号"},
+    {EmpCol::Name, "name", "姓名"},
+    {EmpCol::Depno, "depno", "部门号"},
+    {EmpCol::Salary, "salary", "工资"},
+};
+
+const ColName& colName(EmpCol c) {
+    return kCols[int(c)];
+}
+
+} // namespace
+
+namespace EmpSort {
+
+bool parseSpec(const QString& text, EmpSortSpec* out) {
+    EmpSortSpec spec;
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList w = part.simplified().toLower().split(' ');
+        if (w.isEmpty() || w.size() > 2) return false;
+        bool found = false;
+        EmpSortKey k{EmpCol::No, false};
+        for (const ColName& c : kCols) {
+            if (w[0] == QLatin1String(c.key)) {
+                k.col = c.col;
+                found = true;
+            }
+        }
+        if (!found) return false;
+        if (w.size() == 2) {
+            if (w[1] == "desc") k.desc = true;
+            else if (w[1] != "asc") return false;
+        }
+        for (const EmpSortKey& e : spec)
+            if (e.col == k.col) return false; //同一列出现两次
+        spec.push_back(k);
+    }
+    if (spec.isEmpty()) return false;
+    *out = spec;
+    return true;
+}
+
+QString formatSpec(const EmpSortSpec& spec) {
+    QStringList parts;
+    for (const EmpSortKey& k : spec)
+        parts << QString("%1 %2").arg(QLatin1String(colName(k.col).key)).arg(k.desc ? "desc" : "asc");
+    return parts.join(", ");
+}
+
+QString describeSpec(const EmpSortSpec& spec) {
+    if (spec.isEmpty()) return "工号升序";
+    QStringList parts;
+    for (const EmpSortKey& k : spec)
+        parts << QString::fromUtf8(colName(k.col).label) + (k.desc ? "降序" : "升序");
+    return parts.join(" → ");
+}
+
+bool isNaturalOrder(const EmpSortSpec& spec) {
+    return spec.isEmpty() || (spec.first().col == EmpCol::No && !spec.first().desc);
+}
+
+} // namespace EmpSort
+
+EmpSortCache::EmpSortCache()
+    : m_collator(QLocale(QLocale::Chinese, QLocale::China)) {
+    //中文按拼音；夹杂的英文姓名不区分大小写
+    m_collator.setCaseSensitivity(Qt::CaseInsensitive);
+}
+
+void EmpSortCache::invalidate() {
+    m_nameRankValid = false;
+    m_permValid = false;
+}
+
+void EmpSortCache::ensureNameRanks(const EmpColumns& c) {
+    if (m_nameRankValid) return;
+    TRACE_SCOPE("sort.nameRanks");
+    const NameArena& arena = c.names();
+    const int u = arena.uniqueCount();
+
+    //缓存里的键大多已经用不上时（大批改名/删除后）整体重来，免得只增不减
+    if (m_keys.size() > size_t(2 * u + 1024)) {
+        m_keyOf.clear();
+        m_keys.clear();
+    }
+
+    //每个不同姓名一个排序键；以前见过的姓名直接复用
+    std::vector<int> keyIdx(static_cast<size_t>(u));
+    for (int i = 0; i < u; ++i) {
+        const QString name = arena.toString(arena.uniqueAt(i));
+        int k = m_keyOf.value(name, -1);
+        if (k < 0) {
+            k = int(m_keys.size());
+            m_keyOf.insert(name, k);
+            m_keys.push_back(m_collator.sortKey(name));
+        }
+        keyIdx[size_t(i)] = k;
+    }
+
+    //不同姓名按排序键排好，得到稠密名次（排序键相等的名次相同）
+    std::vector<int> order(static_cast<size_t>(u));
+    for (int i = 0; i < u; ++i) order[size_t(i)] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return m_keys[size_t(keyIdx[size_t(a)])].compare(m_keys[size_t(keyIdx[size_t(b)])]) < 0;
+    });
+    std::vector<int> uniqueRank(static_cast<size_t>(u));
+    int rank = 0;
+    for (int i = 0; i < u; ++i) {
+        if (i > 0 && m_keys[size_t(keyIdx[size_t(order[size_t(i - 1)])])].compare(
+                         m_keys[size_t(keyIdx[size_t(order[size_t(i)])])]) != 0)
+            rank++;
+        uniqueRank[size_t(order[size_t(i)])] = rank;
+    }
+
+    const int n = c.size();
+    m_nameRank.resize(size_t(n));
+    for (int r = 0; r < n; ++r) {
+        const int ui = arena.uniqueIndexOf(c.nameRefAt(r));
+        m_nameRank[size_t(r)] = ui < 0 ? 0 : uniqueRank[size_t(ui)];
+    }
+    m_nameRankValid = true;
+}
+
+bool EmpSortCache::lessRow(const EmpColumns& c, const EmpSortSpec& spec, int a, int b) const {
+    for (const EmpSortKey& k : spec) {
+        int cmp = 0;
+        switch (k.col) {
+        case EmpCol::No:
+            cmp = c.noAt(a) < c.noAt(b) ? -1 : (c.noAt(a) > c.noAt(b) ? 1 : 0);
+            break;
+        case EmpCol::Name: {
+            const int x = m_nameRank[size_t(a)], y = m_nameRank[size_t(b)];
+            cmp = x < y ? -1 : (x > y ? 1 : 0);
+            break;
+        }
+        case EmpCol::Depno:
+            cmp = c.depnoAt(a) < c.depnoAt(b) ? -1 : (c.depnoAt(a) > c.depnoAt(b) ? 1 : 0);
+            break;
+        case EmpCol::Salary:
+            cmp = c.salaryAt(a) < c.salaryAt(b) ? -1 : (c.salaryAt(a) > c.salaryAt(b) ? 1 : 0);
+            break;
+        }
+        if (cmp != 0) return k.desc ? cmp > 0 : cmp < 0;
+    }
+    return a < b; //行序即工号升序，保证严格全序（并行排序要求）
+}
+
+const QVector<int>& EmpSortCache::permutation(const EmpColumns& c, const EmpSortSpec& spec) {
+    if (m_permValid && m_spec == spec && m_perm.size() == c.size()) return m_perm;
+    TRACE_SCOPE("sort.permutation");
+    for (const EmpSortKey& k : spec)
+        if (k.col == EmpCol::Name) ensureNameRanks(c);
+
+    m_perm = c.allRows();
+    if (!EmpSort::isNaturalOrder(spec)) {
+        ParallelView::sortRows(m_perm, [this, &c, &spec](int a, int b) { return lessRow(c, spec, a, b); });
+    }
+    m_rankOfRow.resize(size_t(m_perm.size()));
+    for (int i = 0; i < m_perm.size(); ++i) m_rankOfRow[size_t(m_perm[i])] = i;
+    m_spec = spec;
+    m_permValid = true;
+    return m_perm;
+}
+
+void EmpSortCache::sortRows(const EmpColumns& c, const EmpSortSpec& spec, QVector<int>& rows) {
+    if (EmpSort::isNaturalOrder(spec)) {
+        std::sort(rows.begin(), rows.end());
+        return;
+    }
+    const QVector<int>& perm = permutation(c, spec);
+    if (rows.size() == perm.size()) { //没有过滤
+        rows = perm;
+        return;
+    }
+    TRACE_SCOPE("sort.byRank");
+    const std::vector<int>& rank = m_rankOfRow;
+    ParallelView::sortRows(rows, [&rank](int a, int b) { return rank[size_t(a)] < rank[size_t(b)]; });
+}
+
+MemUsage EmpSortCache::memoryUsage() const {
+    MemUsage u;
+    MemAcct::addVector(m_perm, &u);
+    MemAcct::addStdVector(m_rankOfRow, &u);
+    MemAcct::addStdVector(m_nameRank, &u);
+    MemAcct::addHash(m_keyOf, &u);
+    for (auto it = m_keyOf.cbegin(); it != m_keyOf.cend(); ++it) MemAcct::addString(it.key(), &u);
+    //QCollatorSortKey 是指向私有数据的指针，键本身的字节数拿不到，按每个一块小堆块估
+    u.index += qint64(m_keys.size()) * (qint64(sizeof(QCollatorSortKey)) + MemAcct::heapBlock(48));
+    return u;
+}
@@ -0,0 +1,76 @@
+#ifndef EMPSORT_H
+#define EMPSORT_H
+
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <vector>
+
+#include "empcolumns.h"
+#include "memusage.h"
+
+//员工表的列（与表格列顺序一致）
+enum class EmpCol { No = 0, Name = 1, Depno = 2, Salary = 3 };
+
+struct EmpSortKey {
+    EmpCol col;
+    bool desc;
+    bool operator==(const EmpSortKey& o) const { return col == o.col && desc == o.desc; }
+};
+
+//多列排序：前面的列优先，全部相等时按工号升序（即列式存储的行序），所以结果稳定且唯一
+using EmpSortSpec = QVector<EmpSortKey>;
+
+namespace EmpSort {
+
+//"salary desc, name" 这样的文本（列名 no/name/depno/salary，可带 asc/desc）；空文本或出错返回 false
+bool parseSpec(const QString& text, EmpSortSpec* out);
+QString formatSpec(const EmpSortSpec& spec);
+//"工资降序 → 姓名升序"，状态栏用
+QString describeSpec(const EmpSortSpec& spec);
+//只按工号升序：列式存储本身的顺序，不用排
+bool isNaturalOrder(const EmpSortSpec& spec);
+
+} // namespace EmpSort
+
+//排序缓存（挂在列式副本旁边）：
+//  姓名：每个不同姓名算一次 QCollatorSortKey（中文按拼音，跨数据重建保留），
+//        再把不同姓名按排序键排好，每行只留一个整数名次，比较时不再碰字符串
+//  全表置换：同一 spec 下第一次请求时排一次并缓存，之后部门过滤出来的子集按名次数组排（整数比较），
+//           数据变动（invalidate）或 spec 改变才重排
+class EmpSortCache {
+public:
+    EmpSortCache();
+
+    //列式副本重建后调用
+    void invalidate();
+
+    //全部行按 spec 排好的行号
+    const QVector<int>& permutation(const EmpColumns& c, const EmpSortSpec& spec);
+    //把 rows（列式存储行号的子集，任意顺序）按 spec 排好
+    void sortRows(const EmpColumns& c, const EmpSortSpec& spec, QVector<int>& rows);
+
+    MemUsage memoryUsage() const;
+
+private:
+    void ensureNameRanks(const EmpColumns& c);
+    bool lessRow(const EmpColumns& c, const EmpSortSpec& spec, int a, int b) const;
+
+    QCollator m_collator;
+
+    //姓名 -> 排序键，只增不减；明显多于当前不同姓名时整体清掉
+    QHash<QString, int> m_keyOf;
+    std::vector<QCollatorSortKey> m_keys;
+
+    std::vector<int> m_nameRank; //每行姓名的名次，相同姓名名次相同
+    bool m_nameRankValid = false;
+
+    EmpSortSpec m_spec;
+    bool m_permValid = false;
+    QVector<int> m_perm;          //名次 -> 行号
+    std::vector<int> m_rankOfRow; //行号 -> 名次
+};
+
+#endif
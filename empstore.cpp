@@ -0,0 +1,28 @@
+#include "empstore.h"
+
+ConcurrentEmpStore::ConcurrentEmpStore()
+    : m_cur(std::make_shared<const PersistentAvl>()) {
+}
+
+ConcurrentEmpStore::Snapshot ConcurrentEmpStore::snapshot() const {
+    return std::atomic_load(&m_cur);
+}
+
+bool ConcurrentEmpStore::find(int no, Emp* out) const {
+    Snapshot s = snapshot();
+    const Emp* e = s->find(no);
+    if (!e) return false;
+    if (out) *out = *e;
+    return true;
+}
+
+void ConcurrentEmpStore::publish(const PersistentAvl& v) {
+    QMutexLocker lock(&m_writeMu);
+    publishLocked(v);
+}
+
+void ConcurrentEmpStore::publishLocked(const PersistentAvl& v) {
+    //PersistentAvl 本身只是根指针 + size，拷贝是 O(1)
+    std::atomic_store(&m_cur, Snapshot(std::make_shared<const PersistentAvl>(v)));
+    m_gen.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,49 @@
+#ifndef EMPSTORE_H
+#define EMPSTORE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+#include "pavl.h"
+
+//线程安全的员工只读访问层（RCU 风格）：
+//  写者在互斥锁内基于当前版本做路径复制修改，然后原子地发布新版本
+//  读者原子地取走当前版本的 shared_ptr，之后在这份不可变快照上随便读，
+//  永远不会被写者阻塞，也不会读到被释放的节点（快照持有节点引用计数）
+//  旧版本在最后一个读者放手后由 shared_ptr 自动回收
+class ConcurrentEmpStore {
+public:
+    using Snapshot = std::shared_ptr<const PersistentAvl>;
+
+    ConcurrentEmpStore();
+
+    //读者接口：任意线程
+    Snapshot snapshot() const;
+    bool find(int no, Emp* out) const; //按值返回，不暴露节点指针
+    int size() const { return snapshot()->size(); }
+    quint64 generation() const { return m_gen.load(std::memory_order_acquire); }
+
+    //写者接口：GUI 线程或批量写线程
+    void publish(const PersistentAvl& v);
+
+    //批量写：f(PersistentAvl&) 在写锁内修改一个私有副本，结束后只发布一次
+    template <class F>
+    void writeBatch(F&& f) {
+        QMutexLocker lock(&m_writeMu);
+        PersistentAvl v = *snapshot();
+        f(v);
+        publishLocked(v);
+    }
+
+private:
+    QMutex m_writeMu;
+    Snapshot m_cur;                 //只通过 std::atomic_load/atomic_store 访问
+    std::atomic<quint64> m_gen{0};
+
+    void publishLocked(const PersistentAvl& v);
+};
+
+#endif
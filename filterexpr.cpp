@@ -0,0 +1,726 @@
+#include "filterexpr.h"
+
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "deptsalary.h"
+#include "depttree.h"
+#include "empsort.h"
+#include "trace.h"
+
+//谓词树节点：AND / OR / NOT 与四种叶子
+//  Range   数值列的区间，两端可开可闭、可无界；= < <= > >= BETWEEN 都化成它，!= 化成 NOT(点区间)
+//  InSet   工号 / 部门号的集合（IN 列表、subtree 展开后的部门）
+//  NameEq  姓名相等；name IN (...) 化成若干 NameEq 的 OR
+//  NameLike 姓名通配
+struct EmpFilter::Node {
+    enum Kind { And, Or, Not, Range, InSet, NameEq, NameLike };
+
+    explicit Node(Kind k) : kind(k) {}
+
+    Kind kind;
+    std::vector<std::unique_ptr<Node>> kids;
+    EmpCol col = EmpCol::No;
+    double lo = -HUGE_VAL;
+    double hi = HUGE_VAL;
+    bool loOpen = false;
+    bool hiOpen = false;
+    QSet<int> set;
+    QString text;  //NameEq 的姓名 / NameLike 的模式
+    QString label; //表达式原文，执行计划里显示
+};
+
+namespace {
+
+using Node = EmpFilter::Node;
+
+const int kBatch = 4096;      //每批行数：选择向量放得进 L1/L2
+const int kIndexFactor = 8;   //索引估算命中数不到扫描行数的 1/8 才走索引
+
+//---- 词法 ----
+
+struct Tok {
+    enum Type { End, Ident, Number, String, Sym };
+    Type type = End;
+    QString text;
+    double num = 0;
+    int pos = 0; //在原文中的起止位置
+    int end = 0;
+};
+
+QString errAt(int pos, const QString& msg) {
+    return QString("第 %1 个字符附近：%2").arg(pos + 1).arg(msg);
+}
+
+bool tokenize(const QString& s, QVector<Tok>* out, QString* err) {
+    int i = 0;
+    const int n = s.size();
+    while (i < n) {
+        const QChar c = s[i];
+        if (c.isSpace()) {
+            i++;
+            continue;
+        }
+        Tok t;
+        t.pos = i;
+        if (c.isLetter() || c == '_') {
+            while (i < n && (s[i].isLetterOrNumber() || s[i] == '_')) i++;
+            t.type = Tok::Ident;
+            t.text = s.mid(t.pos, i - t.pos);
+        } else if (c.isDigit() || (c == '.' && i + 1 < n && s[i + 1].isDigit())) {
+            while (i < n && (s[i].isDigit() || s[i] == '.')) i++;
+            bool ok = false;
+            t.type = Tok::Number;
+            t.text = s.mid(t.pos, i - t.pos);
+            t.num = t.text.toDouble(&ok);
+            if (!ok) {
+                if (err) *err = errAt(t.pos, QString("数字 %1 格式不对").arg(t.text));
+                return false;
+            }
+        } else if (c == '\'') {
+            i++;
+            for (;;) {
+                if (i >= n) {
+                    if (err) *err = errAt(t.pos, "字符串缺少结尾的单引号");
+                    return false;
+                }
+                if (s[i] == '\'') {
+                    if (i + 1 < n && s[i + 1] == '\'') { //'' 转义
+                        t.text += '\'';
+                        i += 2;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+                t.text += s[i++];
+            }
+            t.type = Tok::String;
+        } else {
+            static const char* const kSyms[] = {"<=", ">=", "!=", "<>", "=", "<", ">", "(", ")", ",", "-"};
+            for (const char* sym : kSyms) {
+                const QString op = QString::fromLatin1(sym);
+                if (s.midRef(i).startsWith(op)) {
+                    t.type = Tok::Sym;
+                    t.text = op;
+                    i += op.size();
+                    break;
+                }
+            }
+            if (t.type != Tok::Sym) {
+                if (err) *err = errAt(i, QString("无法识别的字符 %1").arg(c));
+                return false;
+            }
+        }
+        t.end = i;
+        out->push_back(t);
+    }
+    Tok end;
+    end.pos = end.end = n;
+    out->push_back(end);
+    return true;
+}
+
+//---- 语法 ----
+
+class Parser {
+public:
+    Parser(const QString& src, const QVector<Tok>& toks, const DeptTree& depts)
+        : m_src(src), m_toks(toks), m_depts(depts) {}
+
+    std::unique_ptr<Node> parse(QString* err) {
+        std::unique_ptr<Node> root = parseOr();
+        if (root && peek().type != Tok::End) fail(peek(), QString("多余的 %1").arg(peek().text));
+        if (!m_err.isEmpty()) {
+            if (err) *err = m_err;
+            return nullptr;
+        }
+        return root;
+    }
+
+private:
+    const Tok& peek() const { return m_toks[m_at]; }
+    const Tok& take() { return m_toks[m_at++]; }
+    int lastEnd() const { return m_at > 0 ? m_toks[m_at - 1].end : 0; }
+
+    bool isKw(const char* kw) const {
+        return peek().type == Tok::Ident && peek().text.compare(QLatin1String(kw), Qt::CaseInsensitive) == 0;
+    }
+    bool acceptKw(const char* kw) {
+        if (!isKw(kw)) return false;
+        m_at++;
+        return true;
+    }
+    bool acceptSym(const char* sym) {
+        if (peek().type != Tok::Sym || peek().text != QLatin1String(sym)) return false;
+        m_at++;
+        return true;
+    }
+
+    std::nullptr_t fail(const Tok& t, const QString& msg) {
+        if (m_err.isEmpty()) m_err = errAt(t.pos, msg);
+        return nullptr;
+    }
+    bool expectSym(const char* sym) {
+        if (acceptSym(sym)) return true;
+        fail(peek(), QString("这里应为 %1").arg(QLatin1String(sym)));
+        return false;
+    }
+    bool number(double* v) {
+        const bool neg = acceptSym("-");
+        if (peek().type != Tok::Number) {
+            fail(peek(), "这里应为数字");
+            return false;
+        }
+        *v = neg ? -take().num : take().num;
+        return true;
+    }
+
+    std::unique_ptr<Node> withLabel(std::unique_ptr<Node> n, int from) {
+        if (n) n->label = m_src.mid(from, lastEnd() - from).simplified();
+        return n;
+    }
+
+    //单个子节点时不包一层
+    std::unique_ptr<Node> parseChain(Node::Kind kind, const char* kw,
+                                     std::unique_ptr<Node> (Parser::*sub)()) {
+        const int from = peek().pos;
+        std::unique_ptr<Node> first = (this->*sub)();
+        if (!first || !isKw(kw)) return first;
+        auto n = std::make_unique<Node>(kind);
+        n->kids.push_back(std::move(first));
+        while (acceptKw(kw)) {
+            std::unique_ptr<Node> k = (this->*sub)();
+            if (!k) return nullptr;
+            if (k->kind == kind) { //a AND (b AND c) 拍平，方便顶层挑索引条件
+                for (auto& g : k->kids) n->kids.push_back(std::move(g));
+            } else {
+                n->kids.push_back(std::move(k));
+            }
+        }
+        return withLabel(std::move(n), from);
+    }
+
+    std::unique_ptr<Node> parseOr() { return parseChain(Node::Or, "OR", &Parser::parseAnd); }
+    std::unique_ptr<Node> parseAnd() { return parseChain(Node::And, "AND", &Parser::parseUnary); }
+
+    std::unique_ptr<Node> parseUnary() {
+        const int from = peek().pos;
+        if (acceptKw("NOT")) {
+            std::unique_ptr<Node> k = parseUnary();
+            if (!k) return nullptr;
+            return withLabel(negate(std::move(k)), from);
+        }
+        if (acceptSym("(")) {
+            std::unique_ptr<Node> e = parseOr();
+            if (!e || !expectSym(")")) return nullptr;
+            return e;
+        }
+        return parsePred();
+    }
+
+    static std::unique_ptr<Node> negate(std::unique_ptr<Node> k) {
+        if (k->kind == Node::Not) return std::move(k->kids[0]); //NOT NOT x
+        auto n = std::make_unique<Node>(Node::Not);
+        n->kids.push_back(std::move(k));
+        return n;
+    }
+
+    static std::unique_ptr<Node> range(EmpCol col, double lo, bool loOpen, double hi, bool hiOpen) {
+        auto n = std::make_unique<Node>(Node::Range);
+        n->col = col;
+        n->lo = lo;
+        n->loOpen = loOpen;
+        n->hi = hi;
+        n->hiOpen = hiOpen;
+        return n;
+    }
+
+    std::unique_ptr<Node> parsePred() {
+        const int from = peek().pos;
+        if (peek().type != Tok::Ident) return fail(peek(), "这里应为字段名（no / name / depno / salary）");
+        const Tok& f = take();
+        const QString field = f.text.toLower();
+        EmpCol col;
+        if (field == "no") col = EmpCol::No;
+        else if (field == "name") col = EmpCol::Name;
+        else if (field == "depno") col = EmpCol::Depno;
+        else if (field == "salary") col = EmpCol::Salary;
+        else return fail(f, QString("未知字段 %1").arg(f.text));
+
+        const bool neg = acceptKw("NOT");
+        std::unique_ptr<Node> n;
+        if (acceptKw("BETWEEN")) {
+            if (col == EmpCol::Name) return fail(f, "name 不能用 BETWEEN");
+            double a, b;
+            if (!number(&a)) return nullptr;
+            if (!acceptKw("AND")) return fail(peek(), "BETWEEN 后面应为 数 AND 数");
+            if (!number(&b)) return nullptr;
+            n = range(col, a, false, b, false);
+        } else if (acceptKw("IN")) {
+            n = parseIn(col, f);
+        } else if (acceptKw("LIKE")) {
+            if (col != EmpCol::Name) return fail(f, "只有 name 能用 LIKE");
+            if (peek().type != Tok::String) return fail(peek(), "LIKE 后面应为单引号括起的模式");
+            n = std::make_unique<Node>(Node::NameLike);
+            n->text = take().text;
+        } else if (neg) {
+            return fail(peek(), "NOT 后面应为 BETWEEN / IN / LIKE");
+        } else {
+            n = parseCompare(col, f);
+        }
+        if (!n) return nullptr;
+        if (neg) n = negate(std::move(n));
+        return withLabel(std::move(n), from);
+    }
+
+    std::unique_ptr<Node> parseCompare(EmpCol col, const Tok& f) {
+        const Tok& op = peek();
+        if (op.type != Tok::Sym) return fail(op, "这里应为比较运算符");
+        const QString o = op.text;
+        m_at++;
+        const bool ne = o == "!=" || o == "<>";
+
+        if (col == EmpCol::Name) {
+            if (o != "=" && !ne) return fail(op, "name 只能用 = / != / LIKE / IN");
+            if (peek().type != Tok::String) return fail(peek(), "姓名应用单引号括起");
+            auto n = std::make_unique<Node>(Node::NameEq);
+            n->text = take().text;
+            if (ne) return negate(std::move(n));
+            return n;
+        }
+
+        double v;
+        if (!number(&v)) return nullptr;
+        if (o == "=") return range(col, v, false, v, false);
+        if (ne) return negate(range(col, v, false, v, false));
+        if (o == "<") return range(col, -HUGE_VAL, false, v, true);
+        if (o == "<=") return range(col, -HUGE_VAL, false, v, false);
+        if (o == ">") return range(col, v, true, HUGE_VAL, false);
+        if (o == ">=") return range(col, v, false, HUGE_VAL, false);
+        return fail(op, QString("%1 后面应为比较运算符").arg(f.text));
+    }
+
+    std::unique_ptr<Node> parseIn(EmpCol col, const Tok& f) {
+        if (isKw("subtree")) {
+            const Tok& kw = take();
+            if (col != EmpCol::Depno) return fail(kw, "只有 depno 能用 IN subtree(...)");
+            double v;
+            if (!expectSym("(") || !number(&v) || !expectSym(")")) return nullptr;
+            const int id = v == std::floor(v) && std::fabs(v) <= INT_MAX ? m_depts.idOfDepno(int(v)) : -1;
+            if (id < 0) return fail(kw, QString("部门号 %1 不存在").arg(v));
+            auto n = std::make_unique<Node>(Node::InSet);
+            n->col = col;
+            n->set = m_depts.subtreeDepnos(id);
+            return n;
+        }
+
+        if (!expectSym("(")) return nullptr;
+        auto n = std::make_unique<Node>(col == EmpCol::Name || col == EmpCol::Salary ? Node::Or : Node::InSet);
+        n->col = col;
+        do {
+            if (col == EmpCol::Name) {
+                if (peek().type != Tok::String) return fail(peek(), "姓名应用单引号括起");
+                auto k = std::make_unique<Node>(Node::NameEq);
+                k->text = take().text;
+                n->kids.push_back(std::move(k));
+                continue;
+            }
+            double v;
+            if (!number(&v)) return nullptr;
+            if (col == EmpCol::Salary) {
+                n->kids.push_back(range(col, v, false, v, false));
+            } else if (v == std::floor(v) && std::fabs(v) <= INT_MAX) {
+                n->set.insert(int(v)); //工号 / 部门号都是整数，带小数的永远不等
+            } else {
+                return fail(f, QString("%1 应为整数").arg(f.text));
+            }
+        } while (acceptSym(","));
+        if (!expectSym(")")) return nullptr;
+        return n;
+    }
+
+    const QString& m_src;
+    const QVector<Tok>& m_toks;
+    const DeptTree& m_depts;
+    int m_at = 0;
+    QString m_err;
+};
+
+//---- 执行 ----
+
+inline bool inRange(const Node& n, double v) {
+    return (n.loOpen ? v > n.lo : v >= n.lo) && (n.hiOpen ? v < n.hi : v <= n.hi);
+}
+
+//% 任意多个字符，_ 任意一个字符；回溯只退到最近的 %，O(n·m) 最坏
+bool likeMatch(const ushort* s, int n, const ushort* p, int m) {
+    int i = 0, j = 0, star = -1, mark = 0;
+    while (i < n) {
+        if (j < m && (p[j] == '_' || p[j] == s[i])) {
+            i++;
+            j++;
+        } else if (j < m && p[j] == '%') {
+            star = j++;
+            mark = i;
+        } else if (star >= 0) {
+            j = star + 1;
+            i = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (j < m && p[j] == '%') j++;
+    return j == m;
+}
+
+//叶子在一批行上的过滤：in 升序，结果也升序
+void filterLeaf(const Node& n, const EmpColumns& c, const int* in, int m, std::vector<int>* out) {
+    out->clear();
+    auto keep = [&](auto pred) {
+        for (int i = 0; i < m; ++i)
+            if (pred(in[i])) out->push_back(in[i]);
+    };
+    switch (n.kind) {
+    case Node::Range:
+        if (n.col == EmpCol::No) keep([&](int r) { return inRange(n, c.noAt(r)); });
+        else if (n.col == EmpCol::Depno) keep([&](int r) { return inRange(n, c.depnoAt(r)); });
+        else keep([&](int r) { return inRange(n, c.salaryAt(r)); });
+        break;
+    case Node::InSet:
+        if (n.col == EmpCol::No) keep([&](int r) { return n.set.contains(c.noAt(r)); });
+        else keep([&](int r) { return n.set.contains(c.depnoAt(r)); });
+        break;
+    case Node::NameEq:
+        keep([&](int r) { return c.names().equals(c.nameRefAt(r), n.text); });
+        break;
+    case Node::NameLike: {
+        const ushort* p = n.text.utf16();
+        const int pm = n.text.size();
+        //只有结尾一个 % 的模式（'张%'）按前缀比较
+        const bool prefix = pm > 0 && n.text.indexOf('%') == pm - 1 && !n.text.contains('_');
+        keep([&](int r) {
+            const NameRef ref = c.nameRefAt(r);
+            const ushort* s = c.names().data(ref);
+            const int len = int(ref.len);
+            if (prefix) return len >= pm - 1 && std::equal(p, p + pm - 1, s);
+            return likeMatch(s, len, p, pm);
+        });
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void evalNode(const Node& n, const EmpColumns& c, const int* in, int m, std::vector<int>* out) {
+    switch (n.kind) {
+    case Node::And: {
+        std::vector<int> cur(in, in + m), next;
+        for (const auto& k : n.kids) {
+            if (cur.empty()) break;
+            evalNode(*k, c, cur.data(), int(cur.size()), &next);
+            cur.swap(next);
+        }
+        out->swap(cur);
+        return;
+    }
+    case Node::Or: {
+        //每个分支只看前面分支都没命中的行
+        std::vector<int> rest(in, in + m), hit, acc, tmp;
+        for (const auto& k : n.kids) {
+            if (rest.empty()) break;
+            evalNode(*k, c, rest.data(), int(rest.size()), &hit);
+            if (hit.empty()) continue;
+            tmp.clear();
+            std::merge(acc.begin(), acc.end(), hit.begin(), hit.end(), std::back_inserter(tmp));
+            acc.swap(tmp);
+            tmp.clear();
+            std::set_difference(rest.begin(), rest.end(), hit.begin(), hit.end(), std::back_inserter(tmp));
+            rest.swap(tmp);
+        }
+        out->swap(acc);
+        return;
+    }
+    case Node::Not: {
+        std::vector<int> hit;
+        evalNode(*n.kids[0], c, in, m, &hit);
+        out->clear();
+        std::set_difference(in, in + m, hit.begin(), hit.end(), std::back_inserter(*out));
+        return;
+    }
+    default:
+        filterLeaf(n, c, in, m, out);
+    }
+}
+
+//粗略代价：数值比较 < 姓名相等 < 通配 < 组合
+int costOf(const Node& n) {
+    switch (n.kind) {
+    case Node::Range:
+    case Node::InSet:
+        return 1;
+    case Node::NameEq:
+        return 2;
+    case Node::NameLike:
+        return 3;
+    default: {
+        int k = 0;
+        for (const auto& kid : n.kids) k = std::max(k, costOf(*kid));
+        return k + 1;
+    }
+    }
+}
+
+//编译时把每层 AND 的子条件按代价排好；OR 保持原顺序（短路语义由 rest 处理，顺序不影响结果）
+void orderByCost(Node* n) {
+    for (auto& k : n->kids) orderByCost(k.get());
+    if (n->kind == Node::And) {
+        std::stable_sort(n->kids.begin(), n->kids.end(),
+                         [](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) {
+                             return costOf(*a) < costOf(*b);
+                         });
+    }
+}
+
+//工号区间 -> 行区间 [from, to)
+int rowsFrom(const EmpColumns& c, const Node& n) {
+    if (n.lo == -HUGE_VAL) return 0;
+    const double v = n.loOpen ? std::floor(n.lo) + 1 : std::ceil(n.lo);
+    if (v > INT_MAX) return c.size();
+    if (v < INT_MIN) return 0;
+    return c.rowLowerBound(int(v));
+}
+
+int rowsTo(const EmpColumns& c, const Node& n) {
+    if (n.hi == HUGE_VAL) return c.size();
+    const double v = n.hiOpen ? std::ceil(n.hi) - 1 : std::floor(n.hi);
+    if (v >= INT_MAX) return c.size();
+    if (v < INT_MIN) return 0;
+    return c.rowLowerBound(int(v) + 1);
+}
+
+//工资区间化成闭区间（SIMD 内核与索引都按闭区间）
+double closedLo(const Node& n) { return n.loOpen ? std::nextafter(n.lo, HUGE_VAL) : n.lo; }
+double closedHi(const Node& n) { return n.hiOpen ? std::nextafter(n.hi, -HUGE_VAL) : n.hi; }
+
+//走索引时的命中数（精确）；不能走索引返回 -1
+qint64 indexEstimate(const Node& n, const DeptSalaryIndex* idx) {
+    if (n.kind == Node::InSet && n.col == EmpCol::No) return n.set.size();
+    if (!idx) return -1;
+    if (n.kind == Node::Range && n.col == EmpCol::Salary) {
+        const double lo = closedLo(n), hi = closedHi(n);
+        if (!(lo <= hi)) return 0;
+        return idx->countBelow(QSet<int>(), std::nextafter(hi, HUGE_VAL)) - idx->countBelow(QSet<int>(), lo);
+    }
+    if (n.kind == Node::InSet && n.col == EmpCol::Depno)
+        return n.set.isEmpty() ? 0 : idx->count(n.set); //count() 的空集合表示全部部门
+    return -1;
+}
+
+//用索引直接产生候选行（落在 [from, to) 内，升序）
+std::vector<int> indexRows(const Node& n, const EmpColumns& c, const DeptSalaryIndex* idx, int from, int to) {
+    std::vector<int> rows;
+    auto add = [&](int no) {
+        const int r = c.rowOfNo(no);
+        if (r >= from && r < to) rows.push_back(r);
+    };
+    if (n.col == EmpCol::No) {
+        for (int no : n.set) add(no);
+    } else if (n.col == EmpCol::Salary) {
+        const double lo = closedLo(n), hi = closedHi(n);
+        if (lo <= hi) {
+            idx->allTree().forEachRange(SalaryKey{lo, INT_MIN}, SalaryKey{hi, INT_MAX}, [&](const SalaryKey& k) {
+                add(k.no);
+                return true;
+            });
+        }
+    } else {
+        for (int d : n.set) {
+            if (const DeptSalaryIndex::Tree* t = idx->tree(d))
+                t->forEachInorder([&](const SalaryKey& k) { add(k.no); });
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+bool hasKernel(const Node& n) {
+    return (n.kind == Node::Range && n.col == EmpCol::Salary) || (n.kind == Node::InSet && n.col == EmpCol::Depno);
+}
+
+} // namespace
+
+EmpFilter::EmpFilter() = default;
+EmpFilter::~EmpFilter() = default;
+
+std::shared_ptr<const EmpFilter> EmpFilter::compile(const QString& text, const DeptTree& depts, QString* err) {
+    TRACE_SCOPE("filter.compile");
+    QVector<Tok> toks;
+    if (!tokenize(text, &toks, err)) return nullptr;
+    if (toks.size() == 1) {
+        if (err) *err = "筛选表达式为空";
+        return nullptr;
+    }
+    Parser p(text, toks, depts);
+    std::unique_ptr<Node> root = p.parse(err);
+    if (!root) return nullptr;
+    orderByCost(root.get());
+
+    std::shared_ptr<EmpFilter> f(new EmpFilter);
+    f->m_root = std::move(root);
+    return f;
+}
+
+QString EmpFilter::toString() const {
+    return m_root->label;
+}
+
+QVector<int> EmpFilter::run(const EmpColumns& c, const DeptSalaryIndex* idx, QString* plan) const {
+    TRACE_SCOPE("filter.run");
+    if (idx && idx->size() != c.size()) idx = nullptr; //索引落后于列式副本时不用
+
+    std::vector<const Node*> conj;
+    if (m_root->kind == Node::And) {
+        for (const auto& k : m_root->kids) conj.push_back(k.get());
+    } else {
+        conj.push_back(m_root.get());
+    }
+
+    //1. 工号区间：列式存储按工号有序，二分得到行区间
+    QStringList steps;
+    int from = 0, to = c.size();
+    std::vector<const Node*> rest;
+    for (const Node* n : conj) {
+        if (n->kind == Node::Range && n->col == EmpCol::No) {
+            from = std::max(from, rowsFrom(c, *n));
+            to = std::min(to, rowsTo(c, *n));
+            steps << QString("工号二分[%1]").arg(n->label);
+        } else {
+            rest.push_back(n);
+        }
+    }
+    to = std::max(from, to);
+
+    //2. 能走索引的条件先估命中数，最少的一个明显少于扫描行数时由它产生候选行
+    std::vector<qint64> est(rest.size());
+    int best = -1;
+    for (size_t i = 0; i < rest.size(); ++i) {
+        est[i] = indexEstimate(*rest[i], idx);
+        if (est[i] >= 0 && est[i] * kIndexFactor < to - from && (best < 0 || est[i] < est[size_t(best)]))
+            best = int(i);
+    }
+    std::vector<int> cand;
+    if (best >= 0) {
+        const Node* b = rest[size_t(best)];
+        cand = indexRows(*b, c, idx, from, to);
+        steps << QString("索引[%1]约 %2 行").arg(b->label).arg(est[size_t(best)]);
+        rest.erase(rest.begin() + best);
+        est.erase(est.begin() + best);
+    } else {
+        steps << QString("扫描 %1 行").arg(to - from);
+    }
+
+    //3. 其余条件：代价低的在前，同代价时估算命中少的在前（估不出的放后面）
+    std::vector<size_t> order(rest.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const int ca = costOf(*rest[a]), cb = costOf(*rest[b]);
+        if (ca != cb) return ca < cb;
+        const qint64 ea = est[a] < 0 ? LLONG_MAX : est[a], eb = est[b] < 0 ? LLONG_MAX : est[b];
+        return ea < eb;
+    });
+    std::vector<const Node*> preds;
+    for (size_t i : order) {
+        preds.push_back(rest[i]);
+        steps << QString("过滤[%1]").arg(rest[i]->label);
+    }
+
+    //4. 分批：每批一个选择向量，逐个条件收窄
+    QVector<int> out;
+    std::vector<int> sel, tmp;
+    auto refine = [&](size_t first) {
+        for (size_t k = first; k < preds.size() && !sel.empty(); ++k) {
+            evalNode(*preds[k], c, sel.data(), int(sel.size()), &tmp);
+            sel.swap(tmp);
+        }
+        for (int r : sel) out.push_back(r);
+    };
+
+    if (best >= 0) {
+        for (size_t b = 0; b < cand.size(); b += kBatch) {
+            sel.assign(cand.begin() + b, cand.begin() + std::min(cand.size(), b + kBatch));
+            refine(0);
+        }
+    } else {
+        const bool kernel = !preds.empty() && hasKernel(*preds[0]);
+        for (int b = from; b < to; b += kBatch) {
+            const int e = std::min(to, b + kBatch);
+            if (kernel) { //连续行区间上的第一个条件走向量化内核
+                const Node& n = *preds[0];
+                const QVector<int> hit = n.kind == Node::Range
+                                             ? c.filterSalaryRange(closedLo(n), closedHi(n), b, e)
+                                             : c.filterDeptSet(n.set, b, e);
+                sel.assign(hit.begin(), hit.end());
+                refine(1);
+            } else {
+                sel.resize(size_t(e - b));
+                std::iota(sel.begin(), sel.end(), b);
+                refine(0);
+            }
+        }
+    }
+
+    if (plan) *plan = steps.join(" → ");
+    return out;
+}
+
+const QVector<int>* EmpFilterCache::rows(const QString& text, const EmpColumns& c, const DeptTree& depts,
+                                         const DeptSalaryIndex* idx, quint64 dataGen, QString* plan,
+                                         QString* err) {
+    const QString key = text.simplified();
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->deptGen != depts.generation()) { //subtree() 展开的部门可能变了
+        m_entries.erase(it);
+        it = m_entries.end();
+    }
+    if (it == m_entries.end()) {
+        std::shared_ptr<const EmpFilter> prog = EmpFilter::compile(key, depts, err);
+        if (!prog) return nullptr;
+        if (m_entries.size() >= kMaxEntries) { //淘汰最久没用的
+            auto victim = m_entries.begin();
+            for (auto e = m_entries.begin(); e != m_entries.end(); ++e)
+                if (e->lastUse < victim->lastUse) victim = e;
+            m_entries.erase(victim);
+        }
+        Entry e;
+        e.prog = prog;
+        e.deptGen = depts.generation();
+        it = m_entries.insert(key, e);
+    }
+    it->lastUse = ++m_tick;
+    if (!it->ran || it->dataGen != dataGen) {
+        it->rows = it->prog->run(c, idx, &it->plan);
+        it->dataGen = dataGen;
+        it->ran = true;
+    }
+    if (plan) *plan = it->plan;
+    return &it->rows;
+}
+
+MemUsage EmpFilterCache::memoryUsage() const {
+    MemUsage u;
+    MemAcct::addHash(m_entries, &u);
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        MemAcct::addString(it.key(), &u);
+        MemAcct::addVector(it->rows, &u);
+        MemAcct::addString(it->plan, &u);
+    }
+    return u;
+}
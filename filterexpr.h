@@ -0,0 +1,84 @@
+#ifndef FILTEREXPR_H
+#define FILTEREXPR_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+#include "empcolumns.h"
+#include "memusage.h"
+
+class DeptTree;
+class DeptSalaryIndex;
+
+//员工筛选表达式，例如 salary > 15000 AND depno IN subtree(3) AND name LIKE '张%'
+//  expr  := and ( OR and )*
+//  and   := unary ( AND unary )*
+//  unary := NOT unary | '(' expr ')' | pred
+//  pred  := field op value
+//         | field [NOT] BETWEEN 数 AND 数
+//         | field [NOT] IN '(' 值, ... ')'
+//         | depno [NOT] IN subtree(部门号)      部门号及其全部下级部门
+//         | name [NOT] LIKE '模式'              % 任意多个字，_ 任意一个字
+//  field := no | name | depno | salary，op := = != <> < <= > >=
+//  关键字不区分大小写；字符串用单引号，'' 表示单引号本身
+//
+//编译：解析一次得到谓词树，subtree() 在编译时按部门树展开成部门号集合
+//执行：
+//  1. 顶层 AND 里的工号区间直接在列式存储（按工号有序）上二分成行区间
+//  2. 其余能走索引的条件（工资区间、部门集合 -> 部门工资索引；工号列表 -> 二分）先估出命中数，
+//     最少的那个明显少于扫描区间时，用它直接产生候选行
+//  3. 剩下的条件按代价排序（数值比较在前、姓名匹配在后），候选行每 4096 行一批，
+//     逐个条件在列上过滤；连续行区间上的工资区间/部门集合走向量化内核
+class EmpFilter {
+public:
+    struct Node;
+
+    ~EmpFilter();
+    EmpFilter(const EmpFilter&) = delete;
+    EmpFilter& operator=(const EmpFilter&) = delete;
+
+    //语法或类型错误时返回空指针并写 err（带出错位置）
+    static std::shared_ptr<const EmpFilter> compile(const QString& text, const DeptTree& depts,
+                                                    QString* err = nullptr);
+
+    //满足条件的行号（升序）；idx 为空或与 c 行数不一致时不走工资索引。plan 非空时写执行计划说明
+    QVector<int> run(const EmpColumns& c, const DeptSalaryIndex* idx, QString* plan = nullptr) const;
+
+    //表达式原文（去掉多余空白）
+    QString toString() const;
+
+private:
+    EmpFilter();
+    std::unique_ptr<Node> m_root;
+};
+
+//筛选结果缓存：表达式 -> 编译结果 + 上次的行号
+//  员工数据版本（dataGen）变了只重跑，部门树版本变了连同编译结果一起作废（subtree 要重新展开）
+class EmpFilterCache {
+public:
+    //出错返回 nullptr 并写 err；返回的指针在下一次调用前有效
+    const QVector<int>* rows(const QString& text, const EmpColumns& c, const DeptTree& depts,
+                             const DeptSalaryIndex* idx, quint64 dataGen,
+                             QString* plan = nullptr, QString* err = nullptr);
+    void clear() { m_entries.clear(); }
+
+    MemUsage memoryUsage() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const EmpFilter> prog;
+        quint64 deptGen = 0;
+        quint64 dataGen = 0;
+        bool ran = false;
+        QVector<int> rows;
+        QString plan;
+        quint64 lastUse = 0;
+    };
+    static const int kMaxEntries = 16;
+    QHash<QString, Entry> m_entries;
+    quint64 m_tick = 0;
+};
+
+#endif
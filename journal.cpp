@@ -0,0 +1,393 @@
+#include "journal.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QMap>
+#include <QtEndian>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "trace.h"
+
+namespace {
+
+const char kMagic[4] = { 'E', 'M', 'J', '2' };
+const char kMagicV1[4] = { 'E', 'M', 'J', '1' };     //没有编辑时间的旧格式，只读
+const int kHeaderBytes = 8;                          //长度 + CRC
+const int kFixedBytes = 1 + 4 + 4 + 8 + 8 + 2;       //类型 + no + depno + salary + 编辑时间 + 姓名长度
+const int kFixedBytesV1 = 1 + 4 + 4 + 8 + 2;
+
+struct CrcTable {
+    quint32 v[256];
+    CrcTable() {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+
+quint32 crc32(const char* p, int n) {
+    //函数内静态对象的初始化是线程安全的：界面线程与 compaction 线程都会用到
+    static const CrcTable crc;
+    const quint32* table = crc.v;
+    quint32 c = 0xFFFFFFFFu;
+    for (int i = 0; i < n; ++i) c = table[(c ^ quint8(p[i])) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+//只刷数据（不强制刷元数据）；macOS 上 fsync 不保证落到介质，用 F_FULLFSYNC
+bool syncData(int fd) {
+#if defined(Q_OS_WIN)
+    return _commit(fd) == 0;
+#elif defined(Q_OS_MACOS)
+    return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+void putU32(char* p, quint32 v) { qToLittleEndian(v, p); }
+
+} // namespace
+
+ChangeJournal::~ChangeJournal() {
+    close();
+}
+
+QString ChangeJournal::segmentPath(int seq) const {
+    return QString("%1.%2").arg(m_base).arg(seq, 6, 10, QChar('0'));
+}
+
+QStringList ChangeJournal::segments(const QString& base) {
+    QFileInfo fi(base);
+    QDir dir = fi.absoluteDir();
+    const QString prefix = fi.fileName() + ".";
+    QStringList names = dir.entryList(QStringList() << prefix + "*", QDir::Files, QDir::Name);
+
+    QStringList out;
+    for (const auto& n : names) {
+        bool ok = false;
+        n.mid(prefix.size()).toInt(&ok);
+        if (ok) out << dir.filePath(n); //序号定宽补零，按名字排序即按序号排序
+    }
+    return out;
+}
+
+bool ChangeJournal::openSegment(int seq, QString* err) {
+    m_file.setFileName(segmentPath(seq));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        if (err) *err = m_file.errorString();
+        return false;
+    }
+    //上次开段时段头没写全（磁盘满等）：从头重写
+    if (m_file.size() < qint64(sizeof(kMagic)) &&
+        (!m_file.resize(0) || m_file.write(kMagic, sizeof(kMagic)) != qint64(sizeof(kMagic)))) {
+        if (err) *err = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    m_seq = seq;
+    m_segBytes = m_file.size();
+    return true;
+}
+
+bool ChangeJournal::open(const QString& base, int groupCommitMs, QString* err) {
+    close();
+    m_base = base;
+    m_groupMs = std::max(1, groupCommitMs);
+
+    int seq = 1;
+    const QStringList segs = segments(base);
+    if (!segs.isEmpty()) seq = QFileInfo(segs.last()).suffix().toInt() + 1;
+    if (!openSegment(seq, err)) return false;
+
+    m_stop = false;
+    m_flusher = std::thread([this]() { flushLoop(); });
+    m_opened = true;
+    return true;
+}
+
+void ChangeJournal::close() {
+    m_opened = false;
+    if (m_flusher.joinable()) {
+        {
+            QMutexLocker lock(&m_mu);
+            m_stop = true;
+            m_wakeFlusher.wakeAll();
+        }
+        m_flusher.join(); //退出前会把缓冲写完
+    }
+    QMutexLocker io(&m_ioMu);
+    if (m_file.isOpen()) m_file.close();
+}
+
+void ChangeJournal::encode(RecordType t, const Emp& e, qint64 ts, QByteArray* out) {
+    const int nameLen = std::min(int(e.name.len), 0xFFFF);
+    const int payload = kFixedBytes + nameLen * 2;
+
+    const int at = out->size();
+    out->resize(at + kHeaderBytes + payload);
+    char* rec = out->data() + at;
+    char* p = rec + kHeaderBytes;
+    p[0] = char(t);
+    qToLittleEndian(qint32(e.no), p + 1);
+    qToLittleEndian(qint32(e.depno), p + 5);
+    quint64 bits;
+    std::memcpy(&bits, &e.salary, sizeof(bits));
+    qToLittleEndian(bits, p + 9);
+    qToLittleEndian(ts, p + 17);
+    qToLittleEndian(quint16(nameLen), p + 25);
+    const ushort* u = NameArena::global().data(e.name);
+    for (int i = 0; i < nameLen; ++i) qToLittleEndian(quint16(u[i]), p + kFixedBytes + i * 2);
+
+    putU32(rec, quint32(payload));
+    putU32(rec + 4, crc32(p, payload));
+}
+
+void ChangeJournal::appendEncoded(const QByteArray& recs) {
+    QMutexLocker lock(&m_mu);
+    if (m_buf.isEmpty()) m_wakeFlusher.wakeOne(); //开启一个提交窗口
+    m_buf += recs;
+    m_appended += quint64(recs.size());
+}
+
+void ChangeJournal::append(RecordType t, const Emp& e) {
+    if (!m_opened) return;
+    QByteArray rec;
+    encode(t, e, QDateTime::currentMSecsSinceEpoch(), &rec);
+    appendEncoded(rec);
+}
+
+//整批编码好后一次放进缓冲：前后加 TxBegin / TxCommit，读段时没有 TxCommit 的批整体丢弃
+void ChangeJournal::appendBatch(const QVector<Emp>& upserts, const QVector<int>& removes) {
+    if (!m_opened || (upserts.isEmpty() && removes.isEmpty())) return;
+    const qint64 ts = QDateTime::currentMSecsSinceEpoch();
+    QByteArray recs;
+    recs.reserve((upserts.size() + removes.size() + 2) * (kHeaderBytes + kFixedBytes + 8));
+    Emp marker{};
+    marker.no = upserts.size() + removes.size();
+    encode(TxBegin, marker, ts, &recs);
+    for (const Emp& e : upserts) encode(EmpUpsert, e, ts, &recs);
+    for (int no : removes) {
+        Emp e{};
+        e.no = no;
+        encode(EmpRemove, e, ts, &recs);
+    }
+    encode(TxCommit, marker, ts, &recs);
+    appendEncoded(recs);
+}
+
+void ChangeJournal::appendUpsert(const Emp& e) { append(EmpUpsert, e); }
+
+void ChangeJournal::appendRemove(int no) {
+    Emp e{};
+    e.no = no;
+    append(EmpRemove, e);
+}
+
+void ChangeJournal::appendClear() { append(EmpClear, Emp{}); }
+
+bool ChangeJournal::commitBatch(const QByteArray& batch, QString* err) {
+    if (!m_file.isOpen() && !openSegment(m_seq + 1, err)) return false;
+    if (m_file.write(batch) != qint64(batch.size())) {
+        if (err) *err = m_file.errorString();
+        m_file.close(); //这一段尾部可能是半条记录，不再往里写
+        return false;
+    }
+    if (!syncData(int(m_file.handle()))) {
+        if (err) *err = QString("fdatasync 失败：%1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        m_file.close();
+        return false;
+    }
+    m_segBytes += batch.size();
+    return true;
+}
+
+//组提交：第一条记录到来后再等 groupCommitMs（sync/close 会提前唤醒），
+//把这段时间攒下的记录一次 write + 一次 fdatasync
+//失败时整批放回缓冲最前面，m_synced 不前进；等一会儿（sync 会提前唤醒）再换新段重试
+void ChangeJournal::flushLoop() {
+    const int kRetryMs = 1000;
+    QMutexLocker lock(&m_mu);
+    for (;;) {
+        while (m_buf.isEmpty() && !m_stop) m_wakeFlusher.wait(&m_mu);
+        if (m_buf.isEmpty()) return; //m_stop 且已写完
+
+        if (!m_syncWanted && !m_stop) m_wakeFlusher.wait(&m_mu, m_groupMs);
+
+        QByteArray batch;
+        batch.swap(m_buf);
+        const quint64 upto = m_appended;
+        m_syncWanted = false;
+        lock.unlock();
+
+        QString err;
+        bool ok;
+        {
+            TRACE_SCOPE("journal.groupCommit");
+            QMutexLocker io(&m_ioMu);
+            ok = commitBatch(batch, &err);
+        }
+
+        lock.relock();
+        if (ok) {
+            m_synced = upto;
+            m_ioError.clear();
+        } else {
+            m_buf.prepend(batch);
+            m_ioError = err;
+            m_failures++;
+        }
+        m_durable.wakeAll();
+        if (!ok) {
+            if (m_stop) return; //关闭时不再重试，未落盘的记录只能丢掉
+            if (!m_syncWanted) m_wakeFlusher.wait(&m_mu, kRetryMs);
+        }
+    }
+}
+
+bool ChangeJournal::sync(QString* err) {
+    QMutexLocker lock(&m_mu);
+    if (!m_flusher.joinable()) return true;
+    const quint64 target = m_appended;
+    const quint64 failures = m_failures;
+    while (m_synced < target) {
+        if (m_failures != failures) {
+            if (err) *err = m_ioError;
+            return false;
+        }
+        m_syncWanted = true;
+        m_wakeFlusher.wakeAll();
+        m_durable.wait(&m_mu);
+    }
+    return true;
+}
+
+QString ChangeJournal::lastError() const {
+    QMutexLocker lock(&m_mu);
+    return m_ioError;
+}
+
+QStringList ChangeJournal::rotate(QString* err) {
+    if (!sync(err)) return QStringList();
+    QMutexLocker io(&m_ioMu);
+    if (m_file.isOpen()) m_file.close();
+    QStringList old = segments(m_base);
+    //开不了新段时当前段保持关闭，下一次组提交会再试着开
+    if (!openSegment(m_seq + 1, err)) return QStringList();
+    old.removeAll(segmentPath(m_seq));
+    return old;
+}
+
+qint64 ChangeJournal::currentSegmentBytes() const {
+    QMutexLocker lock(&m_mu);
+    return m_segBytes.load() + m_buf.size();
+}
+
+bool ChangeJournal::hasRecords() const {
+    QMutexLocker lock(&m_mu);
+    return !m_buf.isEmpty() || m_segBytes.load() > qint64(sizeof(kMagic));
+}
+
+bool ChangeJournal::readSegment(const QString& path, QVector<Record>* out, QString* err) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+    const QByteArray all = f.readAll();
+    if (all.size() < int(sizeof(kMagic))) return true; //段头没写全：刚创建就崩溃（或磁盘满），当作没有记录
+    const bool v1 = std::memcmp(all.constData(), kMagicV1, sizeof(kMagicV1)) == 0;
+    if (!v1 && std::memcmp(all.constData(), kMagic, sizeof(kMagic)) != 0) {
+        if (err) *err = QString("%1 不是变更日志段").arg(path);
+        return false;
+    }
+    const int fixed = v1 ? kFixedBytesV1 : kFixedBytes;
+
+    const char* p = all.constData();
+    int pos = sizeof(kMagic);
+    QVector<Record> tx; //未遇到 TxCommit 的批
+    bool inTx = false;
+    while (pos + kHeaderBytes <= all.size()) {
+        const quint32 payload = qFromLittleEndian<quint32>(p + pos);
+        const quint32 crc = qFromLittleEndian<quint32>(p + pos + 4);
+        if (payload < quint32(fixed) || pos + kHeaderBytes + qint64(payload) > all.size()) break; //写了一半
+        const char* r = p + pos + kHeaderBytes;
+        if (crc32(r, int(payload)) != crc) break;
+
+        Record rec;
+        rec.type = RecordType(quint8(r[0]));
+        rec.emp.no = qFromLittleEndian<qint32>(r + 1);
+        rec.emp.depno = qFromLittleEndian<qint32>(r + 5);
+        const quint64 bits = qFromLittleEndian<quint64>(r + 9);
+        std::memcpy(&rec.emp.salary, &bits, sizeof(bits));
+        if (!v1) rec.ts = qFromLittleEndian<qint64>(r + 17);
+        const int nameLen = qFromLittleEndian<quint16>(r + fixed - 2);
+        if (fixed + nameLen * 2 != int(payload)) break;
+        QVector<ushort> name(nameLen);
+        for (int i = 0; i < nameLen; ++i) name[i] = qFromLittleEndian<quint16>(r + fixed + i * 2);
+        rec.emp.name = NameArena::global().add(name.constData(), nameLen);
+        pos += kHeaderBytes + int(payload);
+
+        if (rec.type == TxBegin) {
+            tx.clear(); //上一批没有提交（写到一半换了段）：丢掉
+            inTx = true;
+        } else if (rec.type == TxCommit) {
+            if (inTx && out) *out += tx;
+            tx.clear();
+            inTx = false;
+        } else if (inTx) {
+            tx.push_back(rec);
+        } else if (out) {
+            out->push_back(rec);
+        }
+    }
+    return true;
+}
+
+ChangeJournal::Delta ChangeJournal::collapse(const QVector<Record>& recs) {
+    Delta d;
+    QMap<int, int> last; //no -> recs 下标（-1 表示已删除）
+    for (int i = 0; i < recs.size(); ++i) {
+        switch (recs[i].type) {
+        case EmpClear:
+            d.clear = true;
+            last.clear();
+            break;
+        case EmpUpsert:
+            last[recs[i].emp.no] = i;
+            break;
+        case EmpRemove:
+            last[recs[i].emp.no] = -1;
+            break;
+        case TxBegin:
+        case TxCommit:
+            break;
+        }
+    }
+    for (auto it = last.cbegin(); it != last.cend(); ++it) {
+        if (it.value() >= 0) d.upserts.push_back(recs[it.value()].emp);
+        else d.removes.push_back(it.key());
+    }
+    return d;
+}
+
+MemUsage ChangeJournal::memoryUsage() const {
+    QMutexLocker lock(&m_mu);
+    MemUsage u;
+    u.nodes = m_buf.size();
+    u.slack = m_buf.capacity() - m_buf.size();
+    return u;
+}
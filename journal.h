@@ -0,0 +1,116 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <thread>
+
+#include "avl.h"
+#include "memusage.h"
+
+//员工变更日志（追加写、二进制、分段）：
+//  每次增删改在内存里追加一条记录（微秒级），后台线程每隔 groupCommitMs 把攒下的记录
+//  一次性写入当前段文件并 fdatasync（组提交），崩溃最多丢最后一个提交窗口
+//  记录格式：[u32 长度][u32 CRC32][u8 类型][i32 no][i32 depno][f64 salary][i64 编辑时间][u16 姓名长度][UTF-16 姓名]
+//  编辑时间是追加时的 Unix 毫秒，合并进库时按它逐条写工资/部门历史（段头 EMJ1 的旧格式没有这一项）
+//  批量修改夹在 TxBegin / TxCommit 两条标记之间，作为一个事务重放
+//  段文件 <base>.<序号>，启动时按序号重放进 SQLite；compaction 时切换到新段，旧段写进 SQLite 后删除
+//  写盘或 fdatasync 失败时这一批留在缓冲里不算落盘，关掉当前段，下一次提交换新段重写整批
+//  （旧段里可能留下这批的前一部分，重放是按 no 覆盖/删除的，重复一遍不影响结果）
+class ChangeJournal {
+public:
+    //TxBegin / TxCommit 只在段里出现（no 为批内记录数），readSegment 不返回它们
+    enum RecordType : quint8 { EmpUpsert = 1, EmpRemove = 2, EmpClear = 3, TxBegin = 4, TxCommit = 5 };
+
+    struct Record {
+        RecordType type = EmpUpsert;
+        Emp emp{};  //EmpRemove 只用 no
+        qint64 ts = 0; //编辑时间（Unix 毫秒），旧格式的段为 0
+    };
+
+    //若干条记录合并后的净效果：先 clear（若有），再 upserts / removes
+    struct Delta {
+        bool clear = false;
+        QVector<Emp> upserts;
+        QVector<int> removes;
+        bool isEmpty() const { return !clear && upserts.isEmpty() && removes.isEmpty(); }
+    };
+
+    ChangeJournal() = default;
+    ~ChangeJournal();
+
+    ChangeJournal(const ChangeJournal&) = delete;
+    ChangeJournal& operator=(const ChangeJournal&) = delete;
+
+    //base 为段文件前缀；总是新开一个段，已有的段保留给调用方重放/compaction
+    bool open(const QString& base, int groupCommitMs, QString* err = nullptr);
+    void close(); //先把未落盘的记录提交掉
+    bool isOpen() const { return m_opened; }
+
+    void appendUpsert(const Emp& e);
+    void appendRemove(int no);
+    void appendClear();
+    //一批修改作为一个事务：重放时要么整批生效，要么（提交标记没写到盘上）整批不算
+    void appendBatch(const QVector<Emp>& upserts, const QVector<int>& removes);
+
+    //阻塞到目前为止追加的记录都已落盘；这期间提交失败时返回 false 并写 err（记录仍在缓冲里，稍后重试）
+    bool sync(QString* err = nullptr);
+
+    //sync 后切换到新段，返回此前的全部段（可交给 compaction）；失败时返回空并写 err
+    QStringList rotate(QString* err = nullptr);
+
+    //最近一次组提交的错误，成功提交后清空
+    QString lastError() const;
+
+    //按序号排好的段文件
+    static QStringList segments(const QString& base);
+    //读一个段；尾部被截断/校验失败的记录视为未提交，丢弃；没有提交标记的批整体丢弃
+    static bool readSegment(const QString& path, QVector<Record>* out, QString* err = nullptr);
+    static Delta collapse(const QVector<Record>& recs);
+
+    qint64 currentSegmentBytes() const;
+    //当前段（含还没落盘的缓冲）里有没有记录
+    bool hasRecords() const;
+
+    //待落盘缓冲区
+    MemUsage memoryUsage() const;
+
+private:
+    QString m_base;
+    int m_groupMs = 10;
+    int m_seq = 0;
+    QFile m_file;
+    bool m_opened = false; //只由所有者线程读写
+
+    mutable QMutex m_mu;
+    QWaitCondition m_wakeFlusher;
+    QWaitCondition m_durable;
+    QByteArray m_buf;           //已追加、未写盘
+    quint64 m_appended = 0;     //追加的字节序号
+    quint64 m_synced = 0;       //已落盘的字节序号
+    quint64 m_failures = 0;     //组提交失败次数，sync 据此判断等待期间是否出错
+    QString m_ioError;
+    bool m_stop = false;
+    bool m_syncWanted = false;
+
+    QMutex m_ioMu;              //保护 m_file 的写入/切换
+    std::atomic<qint64> m_segBytes{0}; //当前段已落盘的字节数；写在 m_ioMu 内，读不加锁
+    std::thread m_flusher;
+
+    void append(RecordType t, const Emp& e);
+    void appendEncoded(const QByteArray& recs);
+    static void encode(RecordType t, const Emp& e, qint64 ts, QByteArray* out);
+    void flushLoop();
+    //在 m_ioMu 内调用：把 batch 写进当前段并落盘，当前段已关闭（上次失败）时先开新段
+    bool commitBatch(const QByteArray& batch, QString* err);
+    bool openSegment(int seq, QString* err);
+    QString segmentPath(int seq) const;
+};
+
+#endif
@@ -1,9 +1,170 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cstring>
+
+#include "alloccount.h"
+#include "journal.h"
 #include "mainwindow.h"
+#include "sessionrec.h"
+
+//EmployeeManage [--db path] [--record session.jsonl]
+//EmployeeManage --replay session.jsonl [--db path] [--repeat N] [--report r.json] [--baseline old.json]
+//EmployeeManage --make-synthetic N --db path [--depts M] [--seed S]
+//  回放在数据库的临时副本上进行（每次起点相同），默认不显示窗口（offscreen）
+
+//把库连同还没合并进库的变更日志段（<db>.journal.N）一起复制：窗口打开副本时会先重放这些段
+static bool copyDbWithJournal(const QString& src, const QString& dst, QString* err) {
+    if (src.isEmpty()) return true; //没给库：在空库上回放
+    if (!QFile::copy(src, dst)) {
+        *err = "cannot copy database: " + src;
+        return false;
+    }
+    for (const QString& seg : ChangeJournal::segments(src + ".journal")) {
+        const QString to = dst + ".journal." + QFileInfo(seg).suffix();
+        if (!QFile::copy(seg, to)) {
+            *err = "cannot copy journal segment: " + seg;
+            return false;
+        }
+    }
+    return true;
+}
+
+//回放 repeat 遍：每遍都在一份新的库副本上新建窗口，库、日志和内存状态都回到同一起点；
+//按操作输出耗时分布与分配次数（只计操作本身，不含建窗口与加载），reportPath 非空时另存 JSON 报告，
+//baselinePath 为上一次的 JSON 报告时附上比值。返回进程退出码
+static int replaySession(const QString& dbFile, const QString& path, int repeat, const QString& reportPath,
+                         const QString& baselinePath) {
+    QTextStream out(stdout);
+    QString err;
+    int bad = 0;
+    const QVector<QJsonObject> ops = readSession(path, &bad, &err);
+    if (!err.isEmpty()) {
+        out << "cannot read session: " << err << "\n";
+        return 1;
+    }
+
+    QJsonObject baseline;
+    if (!baselinePath.isEmpty()) {
+        QFile bf(baselinePath);
+        if (bf.open(QIODevice::ReadOnly)) baseline = QJsonDocument::fromJson(bf.readAll()).object();
+        else out << "cannot read baseline: " << bf.errorString() << "\n";
+    }
+
+    //提示/警告框自动关掉
+    DialogDismisser dismisser;
+    qApp->installEventFilter(&dismisser);
+
+    repeat = std::max(1, repeat);
+    OpStats stats;
+    int skipped = 0;
+    qint64 wallMs = 0;
+    for (int pass = 0; pass < repeat; ++pass) {
+        QTemporaryDir tmp;
+        const QString copy = tmp.filePath("replay.db");
+        if (!copyDbWithJournal(dbFile, copy, &err)) {
+            out << err << "\n";
+            return 1;
+        }
+        MainWindow w(nullptr, copy);
+        w.show();
+        QElapsedTimer wall;
+        wall.start();
+        skipped += w.replayPass(ops, &stats);
+        wallMs += wall.elapsed();
+    }
+    qApp->removeEventFilter(&dismisser);
+
+    out << QString("replayed %1 ops x %2 in %3 ms (%4 unknown ops skipped, %5 bad lines, %6 dialogs dismissed)\n")
+               .arg(ops.size()).arg(repeat).arg(wallMs)
+               .arg(skipped).arg(bad).arg(dismisser.dismissed());
+    out << stats.table(baseline) << "\n";
+    if (AllocCount::available()) {
+        out << QString("total allocations: %1 (%2 MB requested)\n")
+                   .arg(stats.totalAllocs())
+                   .arg(stats.totalAllocBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+    } else {
+        out << "total allocations: n/a (build with CONFIG+=alloc_count)\n";
+    }
+    out.flush();
+
+    if (!reportPath.isEmpty()) {
+        QJsonObject rep = stats.toJson();
+        rep.insert("session", path);
+        rep.insert("repeat", repeat);
+        rep.insert("allocCounted", AllocCount::available());
+        QFile rf(reportPath);
+        if (!rf.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out << "cannot write report: " << rf.errorString() << "\n";
+            return 1;
+        }
+        rf.write(QJsonDocument(rep).toJson());
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
+    //回放不需要真正显示窗口：平台插件要在 QApplication 构造前选好
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0 && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
     QApplication a(argc, argv);
-    MainWindow w;
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption optDb(QStringList() << "db", "SQLite database file", "path");
+    QCommandLineOption optRecord(QStringList() << "record", "record UI operations to file", "file");
+    QCommandLineOption optReplay(QStringList() << "replay", "replay recorded operations headlessly", "file");
+    QCommandLineOption optRepeat(QStringList() << "repeat", "replay passes", "n", "1");
+    QCommandLineOption optReport(QStringList() << "report", "write replay report as JSON", "file");
+    QCommandLineOption optBaseline(QStringList() << "baseline", "earlier JSON report to compare with", "file");
+    QCommandLineOption optSynthetic(QStringList() << "make-synthetic", "create a synthetic database with N employees", "n");
+    QCommandLineOption optDepts(QStringList() << "depts", "departments in the synthetic database", "m", "200");
+    QCommandLineOption optSeed(QStringList() << "seed", "random seed for the synthetic database", "seed", "42");
+    for (const auto* o : {&optDb, &optRecord, &optReplay, &optRepeat, &optReport, &optBaseline, &optSynthetic,
+                          &optDepts, &optSeed}) {
+        parser.addOption(*o);
+    }
+    parser.process(a);
+
+    QTextStream err(stderr);
+    QString dbFile = parser.value(optDb);
+
+    if (parser.isSet(optSynthetic)) {
+        if (dbFile.isEmpty()) {
+            err << "--make-synthetic needs --db\n";
+            return 1;
+        }
+        QString msg;
+        if (!makeSyntheticDb(dbFile, parser.value(optSynthetic).toInt(), parser.value(optDepts).toInt(),
+                             parser.value(optSeed).toUInt(), &msg)) {
+            err << "make-synthetic failed: " << msg << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet(optReplay)) {
+        //在副本上回放，原库不被改动
+        return replaySession(dbFile, parser.value(optReplay), parser.value(optRepeat).toInt(),
+                             parser.value(optReport), parser.value(optBaseline));
+    }
+
+    MainWindow w(nullptr, dbFile);
+    if (parser.isSet(optRecord)) {
+        QString msg;
+        if (!w.startRecording(parser.value(optRecord), &msg)) err << "cannot record: " << msg << "\n";
+    }
     w.show();
     return a.exec();
 }
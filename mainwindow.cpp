@@ -1,7 +1,6 @@
 #include "mainwindow.h"
 
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
 #include <QTableWidget>
 #include <QHeaderView>
 #include <QLineEdit>
@@ -19,22 +18,54 @@
 #include <QSqlQuery>
 #include <functional>
 #include <QCoreApplication>
-static bool cmpSalaryAsc(const Emp& a, const Emp& b) {
-    if (a.salary < b.salary) return true;
-    if (a.salary > b.salary) return false;
-    return a.no < b.no;
+#include <QCheckBox>
+#include <QListWidget>
+#include <QTimer>
+#include <QFileDialog>
+#include <QKeySequence>
+#include <QFutureWatcher>
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <QSignalBlocker>
+#include <QStatusBar>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QDateTime>
+#include <cmath>
+#include <algorithm>
+
+#include "alloccount.h"
+#include "deptimport.h"
+#include "depttreemodel.h"
+#include "parallelview.h"
+#include "trace.h"
+//员工姓名内存报告：全局 arena（含已不再使用的姓名）加每条 8 字节句柄，与每条一个 QString 的估算对比，
+//并折算到每百万条记录；姓名只存在 arena 里，差值就是实际省下（或多用）的内存
+static QString nameMemoryReport(const NameArena::Stats& st) {
+    if (st.names == 0) return QString();
+    const double diffPerMillion = double(st.qstringBytes - st.arenaBytes) / st.names * 1e6;
+    return QString("姓名存储：%1 条 / arena 里 %2 个不同姓名，arena + 句柄 %3 KB，逐条 QString 约 %4 KB，每百万条%5约 %6 MB")
+        .arg(st.names).arg(st.unique)
+        .arg(st.arenaBytes / 1024).arg(st.qstringBytes / 1024)
+        .arg(diffPerMillion >= 0 ? "节省" : "多用")
+        .arg(std::abs(diffPerMillion) / (1024.0 * 1024.0), 0, 'f', 1);
 }
 
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
+MainWindow::MainWindow(QWidget *parent, const QString& dbFileArg)
+    : QMainWindow(parent), dbFile(dbFileArg)
 {
 
+    //EM_SQL_MODE=1：启动即进入 SQL 直查模式，不把员工表整体载入内存
+    sqlMode = qEnvironmentVariableIntValue("EM_SQL_MODE") != 0;
+
     buildUi();
-    qDebug() << "buid";
     initDbAndLoad();
 }
 
 MainWindow::~MainWindow() {
+    journal.close(); //未落盘的记录先提交；残留的段下次启动时重放
+    compactFuture.waitForFinished();
     dbm.close();
 }
 
@@ -72,9 +103,10 @@ QString MainWindow::dbPath() const
 
 
 void MainWindow::initDbAndLoad() {
-    qDebug() << "1";
+    TRACE_SCOPE("initDbAndLoad");
     //打开数据库
-    if (!dbm.open(dbPath())) {
+    if (dbFile.isEmpty()) dbFile = dbPath();
+    if (!dbm.open(dbFile)) {
         QMessageBox::warning(this, "DB错误", "无法打开SQLite数据库:\n" + dbm.db().lastError().text());
         exit(1);
     }
@@ -85,10 +117,19 @@ void MainWindow::initDbAndLoad() {
         QMessageBox::warning(this, "DB错误", "建表失败:\n" + err);
         exit(1);
     }
-    qDebug() << "1";
+
+    //上次退出/崩溃前只写进日志的修改先合并进 SQLite，再开新日志
+    if (!replayJournalIntoDb()) exit(1);
+    if (!journal.open(dbFile + ".journal", kJournalGroupCommitMs, &err)) {
+        QMessageBox::warning(this, "提示", "无法打开变更日志，本次修改只能靠“保存”写回:\n" + err);
+    }
 
     seedDefaultDepartmentsIfEmpty();
 
+    //增量同步的起点：之后 rowver 更大的行才需要再读
+    dbm.changeSeq(&dbChangeSeq);
+    dbm.dataVersion(&dbDataVersion);
+
     deptRowsCache = dbm.fetchDepartments(&err);
     if (!err.isEmpty()) {
         QMessageBox::warning(this, "提示", "读取部门失败:\n" + err);
@@ -100,17 +141,15 @@ void MainWindow::initDbAndLoad() {
     loadDeptsToTree(0);
 
 
-    //启动时：DB -> AVL
-    loadEmployeesFromDbToAvl();
+    //启动时：DB -> AVL（SQL 直查模式下跳过）
+    if (!sqlMode) loadEmployeesFromDbToAvl();
     refreshEmployeesByDeptSelection();
 }
 
 void MainWindow::buildUi() {
-    qDebug() << "1";
+    TRACE_SCOPE("buildUi");
     setWindowTitle("EmployeeManage");
-    qDebug() << "2";
     resize(1300, 780);
-    qDebug() << "3";
 
     auto* central = new QWidget(this);
     setCentralWidget(central);
@@ -124,8 +163,10 @@ void MainWindow::buildUi() {
     auto* leftBox = new QGroupBox("部门树", central);
     auto* leftLay = new QVBoxLayout(leftBox);
 
-    treeDepts = new QTreeWidget(leftBox);
-    treeDepts->setHeaderLabels(QStringList() << "部门");
+    treeDepts = new QTreeView(leftBox);
+    deptModel = new DeptTreeModel(&deptTree, this);
+    treeDepts->setModel(deptModel);
+    treeDepts->setUniformRowHeights(true);
     leftLay->addWidget(treeDepts, 1);
 
     auto* addDeptBox = new QGroupBox("新增部门", leftBox);
@@ -154,15 +195,60 @@ void MainWindow::buildUi() {
 
     addDeptLay->addLayout(rowBtn);
 
+    btnImportDepts = new QPushButton("从 CSV 批量导入（depno,name,parent_depno）", addDeptBox);
+    addDeptLay->addWidget(btnImportDepts);
+
 
     leftLay->addWidget(addDeptBox, 0);
 
+    auto* editDeptBox = new QGroupBox("调整选中部门", leftBox);
+    auto* editDeptForm = new QFormLayout(editDeptBox);
+    editDeptNewName = new QLineEdit(editDeptBox);
+    editDeptNewName->setPlaceholderText("新部门名");
+    btnRenameDept = new QPushButton("重命名", editDeptBox);
+    auto* renameRow = new QHBoxLayout();
+    renameRow->addWidget(editDeptNewName, 1);
+    renameRow->addWidget(btnRenameDept);
+    editDeptForm->addRow("名称:", renameRow);
+
+    editDeptMoveTo = new QLineEdit(editDeptBox);
+    editDeptMoveTo->setPlaceholderText("新上级部门号，0 为顶级");
+    btnMoveDept = new QPushButton("移动", editDeptBox);
+    auto* moveRow = new QHBoxLayout();
+    moveRow->addWidget(editDeptMoveTo, 1);
+    moveRow->addWidget(btnMoveDept);
+    editDeptForm->addRow("上级:", moveRow);
+
+    btnDeleteDept = new QPushButton("删除选中部门（子部门上移一级）", editDeptBox);
+    editDeptForm->addRow(btnDeleteDept);
+    leftLay->addWidget(editDeptBox, 0);
+
+    //性能追踪面板：最近若干次操作耗时
+    auto* traceBox = new QGroupBox("性能追踪", leftBox);
+    auto* traceLay = new QVBoxLayout(traceBox);
+
+    chkTrace = new QCheckBox("启用追踪", traceBox);
+    chkTrace->setChecked(Trace::enabled());
+    listTrace = new QListWidget(traceBox);
+    listTrace->setMaximumHeight(160);
+    btnExportTrace = new QPushButton("导出Trace(JSON)", traceBox);
+
+    traceLay->addWidget(chkTrace);
+    traceLay->addWidget(listTrace);
+    traceLay->addWidget(btnExportTrace);
+    leftLay->addWidget(traceBox, 0);
+
     root->addWidget(leftBox, 0);
 
     //右侧：员工列表 + 增删改
     auto* rightBox = new QGroupBox("员工列表", central);
     auto* rightLay = new QVBoxLayout(rightBox);
 
+    editFilter = new QLineEdit(rightBox);
+    editFilter->setPlaceholderText("筛选，如 salary > 15000 AND depno IN subtree(3) AND name LIKE '张%'（回车生效，清空取消）");
+    editFilter->setClearButtonEnabled(true);
+    rightLay->addWidget(editFilter);
+
     tableEmps = new QTableWidget(rightBox);
     tableEmps->setColumnCount(4);
     tableEmps->setHorizontalHeaderLabels(QStringList() << "no" << "name" << "depno" << "salary");
@@ -171,6 +257,9 @@ void MainWindow::buildUi() {
     tableEmps->setSelectionMode(QAbstractItemView::SingleSelection);
     tableEmps->horizontalHeader()->setStretchLastSection(true);
     tableEmps->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    tableEmps->horizontalHeader()->setSectionsClickable(true);
+    tableEmps->horizontalHeader()->setSortIndicatorShown(true);
+    tableEmps->horizontalHeader()->setToolTip("点击按该列排序，再点反向；Shift+点击追加为次要排序列");
     rightLay->addWidget(tableEmps, 1);
 
     auto* editBox = new QGroupBox("新增 / 修改", rightBox);
@@ -200,6 +289,15 @@ void MainWindow::buildUi() {
 
     btnSaveAll = new QPushButton("保存",editBox);
 
+    btnUndo = new QPushButton("撤销", editBox);
+    btnRedo = new QPushButton("重做", editBox);
+    btnUndo->setShortcut(QKeySequence::Undo);
+    btnRedo->setShortcut(QKeySequence::Redo);
+    btnUndo->setEnabled(false);
+    btnRedo->setEnabled(false);
+
+    btnExportCsv = new QPushButton("导出CSV", editBox);
+
     btnRow->addWidget(btnAddEmp);
     btnRow->addWidget(btnUpdateEmp);
     btnRow->addWidget(btnDeleteEmp);
@@ -208,18 +306,81 @@ void MainWindow::buildUi() {
     btnRow->addWidget(btnOrderBySalary);
     btnRow->addWidget(btnOrderByNo);
     btnRow->addWidget(btnSaveAll);
+    btnRow->addWidget(btnUndo);
+    btnRow->addWidget(btnRedo);
+    btnRow->addWidget(btnExportCsv);
     editLay->addLayout(btnRow);
 
     rightLay->addWidget(editBox, 0);
 
+    auto* batchBox = new QGroupBox("部门批量操作（选中部门及其子部门）", rightBox);
+    auto* batchLay = new QHBoxLayout(batchBox);
+    editBatchValue = new QLineEdit(batchBox);
+    editBatchValue->setPlaceholderText("调薪：百分比或金额，可为负");
+    btnBatchRaisePct = new QPushButton("按百分比调薪", batchBox);
+    btnBatchRaiseAmt = new QPushButton("按金额调薪", batchBox);
+    editBatchTargetDep = new QLineEdit(batchBox);
+    editBatchTargetDep->setPlaceholderText("目标部门号");
+    btnBatchMove = new QPushButton("批量转部门", batchBox);
+    btnBatchDelete = new QPushButton("批量删除", batchBox);
+
+    batchLay->addWidget(editBatchValue);
+    batchLay->addWidget(btnBatchRaisePct);
+    batchLay->addWidget(btnBatchRaiseAmt);
+    batchLay->addWidget(editBatchTargetDep);
+    batchLay->addWidget(btnBatchMove);
+    batchLay->addWidget(btnBatchDelete);
+    rightLay->addWidget(batchBox, 0);
+
+    auto* topBox = new QGroupBox("部门工资排行（选中部门及其子部门）", rightBox);
+    auto* topLay = new QHBoxLayout(topBox);
+    editTopK = new QLineEdit(topBox);
+    editTopK->setPlaceholderText("人数 K，例如 50");
+    btnTopPaid = new QPushButton("工资最高 K 人", topBox);
+    btnLowestPaid = new QPushButton("工资最低 K 人", topBox);
+    btnSalaryStats = new QPushButton("工资分布（分位数/分段）", topBox);
+    topLay->addWidget(editTopK);
+    topLay->addWidget(btnTopPaid);
+    topLay->addWidget(btnLowestPaid);
+    topLay->addWidget(btnSalaryStats);
+    rightLay->addWidget(topBox, 0);
+
+    auto* histBox = new QGroupBox("按日期回看（工资 / 部门历史）", rightBox);
+    auto* histLay = new QHBoxLayout(histBox);
+    editAsOf = new QLineEdit(histBox);
+    editAsOf->setPlaceholderText("yyyy-MM-dd [HH:mm]，空为现在");
+    btnPayrollAsOf = new QPushButton("当时工资总况", histBox);
+    btnEmpAsOf = new QPushButton("员工当时状态（工号取上方输入框）", histBox);
+    histLay->addWidget(editAsOf);
+    histLay->addWidget(btnPayrollAsOf);
+    histLay->addWidget(btnEmpAsOf);
+    rightLay->addWidget(histBox, 0);
+
+    auto* pageRow = new QHBoxLayout();
+    chkSqlMode = new QCheckBox("SQL 直查模式（大数据量，只读分页）", rightBox);
+    chkSqlMode->setChecked(sqlMode);
+    btnPrevPage = new QPushButton("上一页", rightBox);
+    btnNextPage = new QPushButton("下一页", rightBox);
+    labelPage = new QLabel(rightBox);
+    pageRow->addWidget(chkSqlMode);
+    pageRow->addStretch(1);
+    pageRow->addWidget(btnPrevPage);
+    pageRow->addWidget(labelPage);
+    pageRow->addWidget(btnNextPage);
+    rightLay->addLayout(pageRow);
+
     statusLabel = new QLabel("就绪", rightBox);
     rightLay->addWidget(statusLabel, 0);
 
     root->addWidget(rightBox, 1);
 
-    connect(treeDepts, &QTreeWidget::itemSelectionChanged, this, &MainWindow::onDeptSelectionChanged);
+    connect(treeDepts->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onDeptSelectionChanged);
     connect(btnAddDeptTop, &QPushButton::clicked, this, &MainWindow::addDeptAsTop);
     connect(btnAddDeptChild, &QPushButton::clicked, this, &MainWindow::addDeptAsChild);
+    connect(btnImportDepts, &QPushButton::clicked, this, &MainWindow::importDepartments);
+    connect(btnRenameDept, &QPushButton::clicked, this, &MainWindow::renameSelectedDept);
+    connect(btnMoveDept, &QPushButton::clicked, this, &MainWindow::moveSelectedDept);
+    connect(btnDeleteDept, &QPushButton::clicked, this, &MainWindow::deleteSelectedDept);
 
     connect(btnAddEmp, &QPushButton::clicked, this, &MainWindow::addEmployee);
     connect(btnUpdateEmp, &QPushButton::clicked, this, &MainWindow::updateEmployee);
@@ -228,7 +389,62 @@ void MainWindow::buildUi() {
     connect(btnClearDb, &QPushButton::clicked, this, &MainWindow::clearAllInMemoryAndDb);
     connect(btnOrderByNo, &QPushButton::clicked, this, &MainWindow::sortByNo);
     connect(btnOrderBySalary, &QPushButton::clicked, this, &MainWindow::sortBySalary);
+    connect(tableEmps->horizontalHeader(), &QHeaderView::sectionClicked, this, &MainWindow::onEmpHeaderClicked);
+    connect(editFilter, &QLineEdit::returnPressed, this, [this]() { applyFilter(editFilter->text()); });
+    updateSortIndicator();
     connect(btnSaveAll, &QPushButton::clicked, this, &MainWindow::saveAll);
+    connect(btnUndo, &QPushButton::clicked, this, &MainWindow::undoEmp);
+    connect(btnRedo, &QPushButton::clicked, this, &MainWindow::redoEmp);
+    connect(btnExportCsv, &QPushButton::clicked, this, &MainWindow::exportCsv);
+    connect(btnBatchRaisePct, &QPushButton::clicked, this, &MainWindow::batchRaisePercent);
+    connect(btnBatchRaiseAmt, &QPushButton::clicked, this, &MainWindow::batchRaiseAmount);
+    connect(btnBatchMove, &QPushButton::clicked, this, &MainWindow::batchMoveDept);
+    connect(btnBatchDelete, &QPushButton::clicked, this, &MainWindow::batchDelete);
+    connect(btnTopPaid, &QPushButton::clicked, this, &MainWindow::showTopPaid);
+    connect(btnLowestPaid, &QPushButton::clicked, this, &MainWindow::showLowestPaid);
+    connect(btnSalaryStats, &QPushButton::clicked, this, &MainWindow::showSalaryStats);
+    connect(btnPayrollAsOf, &QPushButton::clicked, this, &MainWindow::showPayrollAsOf);
+    connect(btnEmpAsOf, &QPushButton::clicked, this, &MainWindow::showEmployeeAsOf);
+
+    connect(chkSqlMode, &QCheckBox::toggled, this, &MainWindow::onSqlModeToggled);
+    connect(btnPrevPage, &QPushButton::clicked, this, &MainWindow::prevSqlPage);
+    connect(btnNextPage, &QPushButton::clicked, this, &MainWindow::nextSqlPage);
+    setEmpEditingEnabled(!sqlMode);
+
+    connect(chkTrace, &QCheckBox::toggled, this, &MainWindow::onTraceToggled);
+    connect(btnExportTrace, &QPushButton::clicked, this, &MainWindow::exportTrace);
+
+    //轮询外部写库：data_version 没变时只是一条 PRAGMA
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(3000);
+    connect(pollTimer, &QTimer::timeout, this, [this]() { syncChangesFromDb(false); });
+    pollTimer->start();
+
+    //当前日志段够大时切段并在后台合并，避免日志无限增长
+    compactTimer = new QTimer(this);
+    compactTimer->setInterval(2000);
+    connect(compactTimer, &QTimer::timeout, this, [this]() {
+        const QString ioErr = journal.lastError();
+        if (!ioErr.isEmpty()) {
+            setStatus("变更日志写盘失败（修改仍在内存里，正在重试）：" + ioErr);
+            return;
+        }
+        if (journal.currentSegmentBytes() > kJournalCompactBytes) compactJournal(false);
+    });
+    compactTimer->start();
+
+    labelMem = new QLabel(this);
+    statusBar()->addPermanentWidget(labelMem);
+    memTimer = new QTimer(this);
+    memTimer->setInterval(5000);
+    connect(memTimer, &QTimer::timeout, this, &MainWindow::refreshMemoryStatus);
+    memTimer->start();
+    refreshMemoryStatus();
+
+    traceTimer = new QTimer(this);
+    traceTimer->setInterval(500);
+    connect(traceTimer, &QTimer::timeout, this, &MainWindow::refreshTracePanel);
+    if (Trace::enabled()) traceTimer->start();
 
 }
 
@@ -243,9 +459,9 @@ void MainWindow::seedDefaultDepartmentsIfEmpty() {
 }
 
 QVariant MainWindow::selectedDeptId() const {
-    auto items = treeDepts->selectedItems();
-    if (items.isEmpty()) return 0;
-    return items.first()->data(0, Qt::UserRole);
+    QModelIndex cur = treeDepts->currentIndex();
+    if (!cur.isValid()) return 0;
+    return cur.data(Qt::UserRole);
 }
 
 int MainWindow::selectedDeptNoForFilter() const {
@@ -254,50 +470,130 @@ int MainWindow::selectedDeptNoForFilter() const {
     return deptTree.depnoOf(id);
 }
 
-//加载部门到左侧的部门树
+//加载部门到左侧的部门树：模型重置后只载入顶级部门，其余在展开时按需载入
 void MainWindow::loadDeptsToTree(int selectDeptId) {
+    TRACE_SCOPE("loadDeptsToTree");
+    deptModel->reload();
+    treeDepts->expand(deptModel->indexOfId(0));
+    selectDept(selectDeptId);
+}
+
+void MainWindow::selectDept(int id) {
+    QModelIndex idx = deptModel->indexOfId(id);
+    if (!idx.isValid()) idx = deptModel->indexOfId(0);
+
+    for (QModelIndex p = idx.parent(); p.isValid(); p = p.parent()) {
+        treeDepts->expand(p);
+    }
+    treeDepts->setCurrentIndex(idx);
+    treeDepts->scrollTo(idx);
+}
+
+//部门主数据缓存里按 id 找行
+static DeptRow* findDeptRow(QVector<DeptRow>& rows, int id) {
+    for (auto& r : rows) {
+        if (r.id == id) return &r;
+    }
+    return nullptr;
+}
+
+void MainWindow::renameSelectedDept() {
+    auto rec = recordOp("renameSelectedDept");
+    int id = selectedDeptId().toInt();
+    QString name = editDeptNewName->text().trimmed();
+    if (id == 0) { QMessageBox::information(this,"提示","请先选中一个部门（根节点不能修改）"); return; }
+    if (name.isEmpty()) { QMessageBox::information(this,"提示","部门名不能为空"); return; }
+
     QString err;
+    if (!dbm.renameDepartment(id, name, &err)) {
+        QMessageBox::warning(this, "重命名失败", err);
+        return;
+    }
+    noteOwnDbWrite();
+    if (!deptTree.renameDept(id, name, &err)) {
+        QMessageBox::warning(this, "重命名失败", err);
+        return;
+    }
+    if (DeptRow* r = findDeptRow(deptRowsCache, id)) r->name = name;
 
-    //绘制TreeWidget
-    treeDepts->clear();
+    //只刷新这一行的文字
+    deptModel->deptRenamed(id);
+    setStatus(QString("部门 %1 已重命名为 %2").arg(deptTree.depnoOf(id)).arg(name));
+}
 
-    auto makeItem = [&](int id, QTreeWidgetItem* parent) -> QTreeWidgetItem* {
-        QString text = QString("%1 - %2").arg(deptTree.depnoOf(id)).arg(deptTree.nameOf(id));
-        auto* it = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(treeDepts);
-        it->setText(0, text);
-        it->setData(0, Qt::UserRole, id);
-        return it;
-    };
+void MainWindow::moveSelectedDept() {
+    auto rec = recordOp("moveSelectedDept");
+    TRACE_SCOPE("moveSelectedDept");
+    int id = selectedDeptId().toInt();
+    if (id == 0) { QMessageBox::information(this,"提示","请先选中一个部门（根节点不能移动）"); return; }
 
-    //根
-    auto* rootItem = makeItem(0, nullptr);
+    bool ok = false;
+    int toDepno = editDeptMoveTo->text().trimmed().toInt(&ok);
+    if (!ok || toDepno < 0) { QMessageBox::information(this,"提示","上级部门号必须是 >=0 的整数（0 为顶级）"); return; }
 
-    // 递归构建
-    std::function<void(int, QTreeWidgetItem*)> buildRec = [&](int pid, QTreeWidgetItem* parentItem) {
-        auto children = deptTree.childrenOf(pid);
-        for (int cid : children) {
-            auto* it = makeItem(cid, parentItem);
-            buildRec(cid, it);
-        }
-    };
-    buildRec(0, rootItem);
-    treeDepts->expandAll();
+    int newPid = toDepno == 0 ? 0 : deptTree.idOfDepno(toDepno);
+    if (newPid < 0) {
+        QMessageBox::information(this,"提示", QString("部门 %1 不存在").arg(toDepno));
+        return;
+    }
+    if (deptTree.isInSubtree(newPid, id)) { //O(深度)
+        QMessageBox::information(this,"提示","不能把部门移动到它自己或它的下级部门下面");
+        return;
+    }
+    if (deptTree.parentOf(id) == newPid) return;
 
-    //选中
+    QVariant parentId = newPid == 0 ? QVariant() : QVariant(newPid);
+    QString err;
+    if (!dbm.updateDepartmentParent(id, parentId, &err)) {
+        QMessageBox::warning(this, "移动失败", err);
+        return;
+    }
+    noteOwnDbWrite();
+    deptTree.moveDept(id, newPid, &err);
+    if (DeptRow* r = findDeptRow(deptRowsCache, id)) r->parentId = parentId;
+
+    //模型里只摘下/挂上这一行，其它节点不动
+    deptModel->deptMoved(id);
+    selectDept(id); //选中行变化时会刷新员工表
+    setStatus(QString("部门 %1 已移动到 %2 下").arg(deptTree.depnoOf(id)).arg(deptTree.labelOf(newPid)));
+}
 
-    std::function<QTreeWidgetItem*(QTreeWidgetItem*)> selectById;
-    selectById = [&](QTreeWidgetItem* it) -> QTreeWidgetItem* {
-        if (!it) return nullptr;
-        if (it->data(0, Qt::UserRole).toInt() == selectDeptId) return it;
-        for (int i = 0; i < it->childCount(); ++i) {
-            if (auto* got = selectById(it->child(i))) return got;
-        }
-        return nullptr;
-    };
+void MainWindow::deleteSelectedDept() {
+    auto rec = recordOp("deleteSelectedDept");
+    TRACE_SCOPE("deleteSelectedDept");
+    int id = selectedDeptId().toInt();
+    if (id == 0) { QMessageBox::information(this,"提示","请先选中一个部门（根节点不能删除）"); return; }
+
+    const int depno = deptTree.depnoOf(id);
+    int headcount = 0;
+    empAvl.forEachInorder([&](const Emp& e) { if (e.depno == depno) ++headcount; });
+    if (headcount > 0) {
+        QMessageBox::information(this,"提示",
+            QString("部门 %1 还有 %2 名员工，请先用批量操作转走或删除。").arg(depno).arg(headcount));
+        return;
+    }
+    if (!confirm(QString("确定删除部门 %1 吗？它的子部门会上移一级。").arg(deptTree.labelOf(id))))
+        return;
+
+    const int pid = deptTree.parentOf(id);
+    QVariant parentId = pid == 0 ? QVariant() : QVariant(pid);
+    QString err;
+    if (!dbm.deleteDepartment(id, parentId, &err)) {
+        QMessageBox::warning(this, "删除失败", err);
+        return;
+    }
+    noteOwnDbWrite();
+    const QList<int> kids = deptTree.childrenOf(id);
+    deptTree.removeDept(id, &err);
+    for (int i = deptRowsCache.size() - 1; i >= 0; --i) {
+        if (deptRowsCache[i].id == id) deptRowsCache.remove(i);
+        else if (deptRowsCache[i].parentId.toInt() == id) deptRowsCache[i].parentId = parentId;
+    }
 
-    QTreeWidgetItem* toSel = selectById(rootItem);
-    if (!toSel) toSel = rootItem;
-    treeDepts->setCurrentItem(toSel);
+    //子部门接到父部门末尾（与 DeptTree 的顺序一致）
+    deptModel->deptRemoved(id, kids, pid);
+    selectDept(pid);
+    setStatus(QString("已删除部门 %1").arg(depno));
 }
 
 bool MainWindow::addDeptToDb(int depno, const QString& name, const QVariant& parentId, int* outNewId) {
@@ -306,10 +602,12 @@ bool MainWindow::addDeptToDb(int depno, const QString& name, const QVariant& par
         QMessageBox::warning(this, "添加部门失败", err);
         return false;
     }
+    noteOwnDbWrite();
     return true;
 }
 
 void MainWindow::addDeptAsTop() {
+    auto rec = recordOp("addDeptAsTop");
     bool ok=false;
     int depno = editDeptNo->text().trimmed().toInt(&ok);
     QString name = editDeptName->text().trimmed();
@@ -327,6 +625,7 @@ void MainWindow::addDeptAsTop() {
 
 
 void MainWindow::addDeptAsChild() {
+    auto rec = recordOp("addDeptAsChild");
     bool ok=false;
     int depno = editDeptNo->text().trimmed().toInt(&ok);
     QString name = editDeptName->text().trimmed();
@@ -350,18 +649,54 @@ void MainWindow::addDeptAsChild() {
     setStatus(QString("已添加子部门 %1-%2").arg(depno).arg(name));
 }
 
+//整份组织架构表：解析、排序、解析上级都在内存里做，数据库一个事务，最后整体重建部门树与树控件一次
+//（逐个 addDeptAsChild 时每个部门一次隐式事务和一次界面刷新）
+void MainWindow::importDepartments() {
+    QString path = QFileDialog::getOpenFileName(this, "批量导入部门", QString(), "CSV (*.csv);;所有文件 (*)");
+    if (path.isEmpty()) return;
+    importDepartmentsFrom(path);
+}
+
+//选好文件之后的部分单独作为一个操作录制（带文件路径），回放时不用再弹文件对话框
+void MainWindow::importDepartmentsFrom(const QString& path) {
+    auto rec = recordOp("importDepartmentsFrom", path);
+    TRACE_SCOPE("importDepartments");
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        QMessageBox::warning(this, "导入失败", f.errorString());
+        return;
+    }
+    QVector<DeptImportRow> rows, ordered;
+    QVector<DeptRow> added;
+    QString err;
+    if (!DeptImport::parseCsv(QString::fromUtf8(f.readAll()), &rows, &err) ||
+        !DeptImport::orderByParent(rows, deptTree, &ordered, &err) ||
+        !dbm.importDepartments(ordered, deptTree, &added, &err)) {
+        QMessageBox::warning(this, "导入失败", err);
+        return;
+    }
+    noteOwnDbWrite();
+    if (added.isEmpty()) {
+        QMessageBox::information(this, "提示", "文件里没有部门");
+        return;
+    }
+
+    const int keepSel = selectedDeptId().toInt();
+    deptRowsCache += added;
+    deptTree.buildFromRows(deptRowsCache);
+    loadDeptsToTree(keepSel);
+    setStatus(QString("已导入 %1 个部门").arg(added.size()));
+}
+
 
 
 void MainWindow::onDeptSelectionChanged() {
+    auto rec = recordOp("onDeptSelectionChanged");
     //按当前部门展示员工
     refreshEmployeesByDeptSelection();
 
     //在编辑框中添加对应部门编号
-    auto *it = treeDepts->currentItem();
-    if (!it) return;
-
-    int depno = deptTree.depnoOf(it->data(0, Qt::UserRole).toInt());
-
+    int depno = deptTree.depnoOf(selectedDeptId().toInt());
 
     if (depno == 0) {
         editDepno->clear();
@@ -374,8 +709,8 @@ void MainWindow::onDeptSelectionChanged() {
 //员工：DB<->AVL
 
 void MainWindow::loadEmployeesFromDbToAvl() {
-    empAvl.clear();
-
+    TRACE_SCOPE("loadEmployeesFromDbToAvl");
+    //先读库，读失败时保留原数据；建好后只发布一次，后台读者不会看到中间的空表
     QString err;
     auto emps = dbm.fetchAllEmployees(&err);
     if (!err.isEmpty()) {
@@ -383,70 +718,382 @@ void MainWindow::loadEmployeesFromDbToAvl() {
         return;
     }
 
-    for (const auto& e : emps) {
-        empAvl.insert(e);
+    {
+        TRACE_SCOPE("avl.buildFromDb");
+        empAvl.clear();
+        for (const auto& e : emps) {
+            empAvl.insert(e);
+        }
+        empVersion = PersistentAvl::fromSorted(empAvl.inorder());
     }
+    invalidateEmpViews();
+    undoStack.clear();
+    redoStack.clear();
+    updateUndoButtons();
     setStatus(QString("已加载 %1 条员工记录（DB -> AVL）").arg(emps.size()));
 }
 
-void MainWindow::saveEmployeesFromAvlToDb() {
-    QString err;
-    QVector<Emp> emps = empAvl.inorder(); // 按 no 排序输出（AVL 遍历）
-    if (!dbm.replaceAllEmployees(emps, &err)) {
-        QMessageBox::warning(this, "保存失败", err);
+void MainWindow::refreshEmployeesByDeptSelection() {
+    if (!tableEmps) return;
+    if (sqlMode) {
+        refreshEmployeesFromSql();
         return;
     }
+    TRACE_SCOPE("refreshEmployeesByDeptSelection");
+
+    //AVL 有改动时重建列式副本（按 no 升序）
+    if (empColsDirty) {
+        empCols.buildFrom(empAvl);
+        empColsDirty = false;
+        empSort.invalidate();
+        if (statusLabel) statusLabel->setToolTip(nameMemoryReport(empCols.nameStats()));
+    }
+
+    //同一部门/排序/筛选且数据与部门树都没变过时，直接用上次的结果
+    const QString viewKey = QString("%1|%2|%3")
+                                .arg(selectedDeptId().toInt())
+                                .arg(EmpSort::formatSpec(sortSpec))
+                                .arg(filterText);
+    const quint64 dataGen = empShared.generation();
+    const quint64 deptGen = deptTree.generation();
+    const EmpViewCache::View* view = viewCache.find(viewKey, dataGen, deptGen);
+    const bool cached = view != nullptr;
+    if (!view) view = viewCache.insert(viewKey, dataGen, deptGen, buildEmpView());
+    const QVector<int>& rows = view->rows;
+
+    //表格里已经是这个视图（例如轮询同步后刷新、重复点同一部门）：不重建表项，选中行也保留
+    const QString shownKey = QString("%1|%2|%3").arg(viewKey).arg(dataGen).arg(deptGen);
+    if (shownKey != shownViewKey) {
+        //填表：depno 在集合里就显示
+        TRACE_SCOPE("populateTable");
+        tableEmps->setRowCount(0);
+        tableEmps->setRowCount(rows.size());
+
+        for (int r = 0; r < rows.size(); ++r) {
+            const int i = rows[r];
+            tableEmps->setItem(r, 0, new QTableWidgetItem(QString::number(empCols.noAt(i))));
+            tableEmps->setItem(r, 1, new QTableWidgetItem(empCols.nameAt(i)));
+            tableEmps->setItem(r, 2, new QTableWidgetItem(QString::number(empCols.depnoAt(i))));
+            tableEmps->setItem(r, 3, new QTableWidgetItem(QString::number(empCols.salaryAt(i))));
+        }
+        shownViewKey = shownKey;
+    }
+
+    if (statusLabel) {
+        QString modeText = EmpSort::describeSpec(sortSpec);
+        QString text = QString("当前显示 %1 条员工记录（AVL -> UI，%2%3）")
+                           .arg(rows.size()).arg(modeText).arg(cached ? "，缓存" : "");
+        if (!filterText.isEmpty()) text += QString("  [筛选：%1]").arg(view->filterPlan);
+        if (!rows.isEmpty()) {
+            const auto& st = view->stats;
+            text += QString("  工资合计 %1 / 最低 %2 / 最高 %3")
+                        .arg(st.sum, 0, 'f', 2).arg(st.min).arg(st.max);
+        }
+        statusLabel->setText(text);
+    }
 }
 
-void MainWindow::refreshEmployeesByDeptSelection() {
-    if (!tableEmps) return;
+//按当前选中部门、筛选与排序规则算出表格行（列式副本须已是最新）
+EmpViewCache::View MainWindow::buildEmpView() {
+    TRACE_SCOPE("buildEmpView");
+    EmpViewCache::View v;
 
     //得到当前选中部门子树 depno 集合
     QSet<int> depSet = selectedDeptSubtreeNos();
     bool noFilter = depSet.isEmpty(); //空集合代表全部部门
 
-    //从AVL拿全量员工（按 no 升序）
-    QVector<Emp> all = empAvl.inorder();
-    QVector<Emp> show;
-    show.reserve(all.size());
-    for (int i = 0; i < all.size(); ++i) {
-        const Emp& e = all[i];
-        if (!noFilter && !depSet.contains(e.depno)) continue;
-        show.push_back(e);
+    //过滤得到行号（仍按 no 升序）；大数据量时分块并行
+    QVector<int>& rows = v.rows;
+    QString& filterPlan = v.filterPlan;
+    if (!filterText.isEmpty()) {
+        //筛选表达式的命中行按数据版本缓存，再与部门子树取交集
+        ensureSalaryIndex();
+        const QVector<int>* hit = filterCache.rows(filterText, empCols, deptTree, &salaryIdx,
+                                                   empShared.generation(), &filterPlan);
+        if (hit) {
+            if (noFilter) {
+                rows = *hit;
+            } else {
+                rows.reserve(hit->size());
+                for (int i : *hit)
+                    if (depSet.contains(empCols.depnoAt(i))) rows.push_back(i);
+            }
+        }
+    } else {
+        rows = noFilter ? empCols.allRows() : ParallelView::filterDeptSet(empCols, depSet);
     }
 
-    if (sortMode == SortBySalary) {
-        std::sort(show.begin(), show.end(), cmpSalaryAsc);
+    //多列排序：全表置换按 spec 缓存，过滤出的子集按名次整数比较
+    if (!EmpSort::isNaturalOrder(sortSpec)) {
+        TRACE_SCOPE("sortRows");
+        empSort.sortRows(empCols, sortSpec, rows);
     }
 
-    //填表：depno 在集合里就显示
-    tableEmps->setRowCount(0);
-    tableEmps->setRowCount(show.size());
+    if (!rows.isEmpty()) v.stats = empCols.salaryStats(&rows);
+    return v;
+}
+
+//员工数据有变动：列式副本等派生结构失效，并把新版本发布给后台读者
+void MainWindow::invalidateEmpViews() {
+    empColsDirty = true;
+    salaryIdxDirty = true;
+    empShared.publish(empVersion);
+}
+
+void MainWindow::invalidateEmpViews(const QVector<int>& nos) {
+    empColsDirty = true;
+    //改动的工号少时逐个挪位置（O(k log n)），多时留到下次查询整体重建
+    if (!salaryIdxDirty && nos.size() <= empAvl.size() / 8) {
+        for (int no : nos) salaryIdx.sync(no, empAvl.find(no));
+    } else {
+        salaryIdxDirty = true;
+    }
+    empShared.publish(empVersion);
+}
+
+
+//“刷新”：只合并数据库里变动过的行，库没变就什么也不做
+void MainWindow::reloadFromDb() {
+    auto rec = recordOp("reloadFromDb");
+    TRACE_SCOPE("reloadFromDb");
+    if (syncChangesFromDb(true)) return;
+    setStatus("数据库没有变化");
+}
+
+bool MainWindow::syncChangesFromDb(bool showErrors) {
+    TRACE_SCOPE("syncChangesFromDb");
+    QString err;
+    qint64 dv = 0;
+    if (!dbm.dataVersion(&dv, &err)) {
+        if (showErrors) QMessageBox::warning(this, "提示", "读取数据库版本失败:\n" + err);
+        return false;
+    }
+    //本连接自己的提交不改变 data_version；后台合并日志用的是另一个连接，合并完由 absorbOwnWrite 跟上
+    if (dv == dbDataVersion) return false;
+
+    //先把本地日志合并进库，否则读回来的旧行会盖掉还没合并的本地修改
+    //轮询不等：合并在后台跑，这一轮先跳过，合并完之后的下一轮再读
+    if (showErrors) {
+        compactJournal(true);
+    } else {
+        if (compactFuture.isRunning()) return false;
+        if (journal.isOpen() && journal.hasRecords()) {
+            compactJournal(false);
+            return false;
+        }
+    }
+    if (!dbm.dataVersion(&dv, &err)) {
+        if (showErrors) QMessageBox::warning(this, "提示", "读取数据库版本失败:\n" + err);
+        return false;
+    }
+
+    DbChangeSet cs;
+    if (!dbm.fetchChangesSince(dbChangeSeq, &cs, &err)) {
+        if (showErrors) QMessageBox::warning(this, "提示", "读取变更失败:\n" + err);
+        return false;
+    }
+    dbDataVersion = dv;
+    dbChangeSeq = cs.seq;
+
+    //本进程自己写的行（部门走 dbm 直接写库、员工由日志合并进库）读回来和内存里一样，跳过
+    for (int i = cs.depts.size() - 1; i >= 0; --i) {
+        const DeptRow& r = cs.depts[i];
+        const DeptRow* c = findDeptRow(deptRowsCache, r.id);
+        if (c && c->depno == r.depno && c->name == r.name && c->parentId.toInt() == r.parentId.toInt())
+            cs.depts.remove(i);
+    }
+    for (int i = cs.deptRemoved.size() - 1; i >= 0; --i) {
+        if (!deptTree.containsId(cs.deptRemoved[i])) cs.deptRemoved.remove(i);
+    }
+    if (!sqlMode) {
+        for (int i = cs.emps.size() - 1; i >= 0; --i) {
+            const Emp& e = cs.emps[i];
+            const Emp* cur = empAvl.find(e.no);
+            if (cur && cur->depno == e.depno && cur->salary == e.salary && cur->name == e.name)
+                cs.emps.remove(i);
+        }
+        for (int i = cs.empRemoved.size() - 1; i >= 0; --i) {
+            if (!empAvl.find(cs.empRemoved[i])) cs.empRemoved.remove(i);
+        }
+    }
+    if (cs.isEmpty()) return false;
+
+    //部门：先删，再增/改，最后统一调整父节点（父部门可能排在子部门之后才出现）
+    const bool deptChanged = !cs.depts.isEmpty() || !cs.deptRemoved.isEmpty();
+    if (deptChanged) {
+        TRACE_SCOPE("sync.depts");
+        const int keepSel = selectedDeptId().toInt();
+        for (int id : cs.deptRemoved) {
+            deptTree.removeDept(id);
+            for (int i = deptRowsCache.size() - 1; i >= 0; --i) {
+                if (deptRowsCache[i].id == id) deptRowsCache.remove(i);
+            }
+        }
+        for (const auto& r : cs.depts) {
+            if (deptTree.containsId(r.id)) {
+                deptTree.setDepno(r.id, r.depno);
+                deptTree.renameDept(r.id, r.name);
+            } else {
+                DeptRow top = r;
+                top.parentId = QVariant();
+                deptTree.addDept(top);
+            }
+            if (DeptRow* c = findDeptRow(deptRowsCache, r.id)) *c = r;
+            else deptRowsCache.push_back(r);
+        }
+        for (const auto& r : cs.depts) {
+            int pid = (r.parentId.isValid() && !r.parentId.isNull()) ? r.parentId.toInt() : 0;
+            if (!deptTree.containsId(pid)) pid = 0;
+            if (deptTree.parentOf(r.id) != pid) deptTree.moveDept(r.id, pid); //成环的数据保持原位
+        }
+        deptModel->reload(); //懒加载模型，重置只重建顶层
+        selectDept(deptTree.containsId(keepSel) ? keepSel : 0);
+    }
 
-    for (int r = 0; r < show.size(); ++r) {
-        const Emp& e = show[r];
+    //员工
+    const int changedEmps = cs.emps.size() + cs.empRemoved.size();
+    if (sqlMode) {
+        sqlPager.invalidate();
+    } else if (changedEmps > 0) {
+        TRACE_SCOPE("sync.emps");
+        for (const auto& e : cs.emps) {
+            if (Emp* cur = empAvl.find(e.no)) *cur = e;
+            else empAvl.insert(e);
+        }
+        for (int no : cs.empRemoved) empAvl.remove(no);
+
+        //与批量操作相同：改动多时整体重建持久化版本
+        if (changedEmps > empAvl.size() / 8) {
+            empVersion = PersistentAvl::fromSorted(empAvl.inorder());
+        } else {
+            for (const auto& e : cs.emps) {
+                bool ok = false;
+                PersistentAvl next = empVersion.update(e, &ok);
+                empVersion = ok ? next : empVersion.insert(e);
+            }
+            for (int no : cs.empRemoved) empVersion = empVersion.remove(no);
+        }
+        QVector<int> nos;
+        nos.reserve(changedEmps);
+        for (const auto& e : cs.emps) nos.push_back(e.no);
+        nos += cs.empRemoved;
+        invalidateEmpViews(nos);
+    }
+
+    refreshEmployeesByDeptSelection();
+    setStatus(QString("已从数据库同步：员工 %1 条变动，部门 %2 条变动")
+                  .arg(changedEmps).arg(cs.depts.size() + cs.deptRemoved.size()));
+    return true;
+}
+
+//SQL 直查：子树过滤、排序、分页都在 SQLite 里做，内存里只有分页器缓存的若干页
+void MainWindow::refreshEmployeesFromSql() {
+    TRACE_SCOPE("refreshEmployeesFromSql");
+    const int root = selectedDeptId().toInt();
+    //SQL 直查只支持工号/工资升序：主排序列是工资时按工资，否则按工号
+    const bool bySalary = !sortSpec.isEmpty() && sortSpec.first().col == EmpCol::Salary;
+    const auto order = bySalary ? DbManager::EmpOrder::BySalary : DbManager::EmpOrder::ByNo;
+    if (root != sqlPager.rootDeptId() || order != sqlPager.order()) sqlPage = 0;
+    sqlPager.setQuery(root, order);
+
+    QString err;
+    QVector<Emp> rows;
+    EmpAggregate agg;
+    if (!sqlPager.page(sqlPage, &rows, &err) || !sqlPager.aggregate(&agg, &err)) {
+        QMessageBox::warning(this, "查询失败", err);
+        return;
+    }
+
+    shownViewKey.clear();
+    tableEmps->setRowCount(0);
+    tableEmps->setRowCount(rows.size());
+    for (int r = 0; r < rows.size(); ++r) {
+        const Emp& e = rows[r];
         tableEmps->setItem(r, 0, new QTableWidgetItem(QString::number(e.no)));
-        tableEmps->setItem(r, 1, new QTableWidgetItem(e.name));
+        tableEmps->setItem(r, 1, new QTableWidgetItem(e.nameString()));
         tableEmps->setItem(r, 2, new QTableWidgetItem(QString::number(e.depno)));
         tableEmps->setItem(r, 3, new QTableWidgetItem(QString::number(e.salary)));
     }
 
-    if (statusLabel) {
-        QString modeText = (sortMode == SortBySalary) ? "工资升序" : "工号升序";
-        statusLabel->setText(QString("当前显示 %1 条员工记录（AVL -> UI，%2）")
-                                 .arg(show.size()).arg(modeText));
+    const int pages = std::max(1, sqlPager.pageCount());
+    labelPage->setText(QString("%1 / %2").arg(sqlPage + 1).arg(pages));
+    btnPrevPage->setEnabled(sqlPage > 0);
+    btnNextPage->setEnabled(sqlPage + 1 < pages);
+
+    QString modeText = bySalary ? "工资升序" : "工号升序";
+    QString text = QString("SQL 直查：共 %1 条，本页 %2 条（%3）").arg(agg.count).arg(rows.size()).arg(modeText);
+    if (agg.count > 0) {
+        text += QString("  工资合计 %1 / 最低 %2 / 最高 %3")
+                    .arg(agg.sum, 0, 'f', 2).arg(agg.min).arg(agg.max);
     }
+    statusLabel->setText(text);
 }
 
+void MainWindow::onSqlModeToggled(bool on) {
+    auto rec = recordOp("onSqlModeToggled", on);
+    if (on == sqlMode) return;
 
-void MainWindow::reloadFromDb() {
-    loadDeptsToTree(selectedDeptId().toInt());
-    loadEmployeesFromDbToAvl();
+    if (on) {
+        if (!confirm("进入 SQL 直查模式会释放内存中的员工数据（修改已写入变更日志，会先合并进数据库）。继续吗？")) {
+            QSignalBlocker block(chkSqlMode);
+            chkSqlMode->setChecked(false);
+            return;
+        }
+        compactJournal(true);
+        sqlMode = true;
+        empAvl.clear();
+        empVersion = PersistentAvl();
+        undoStack.clear();
+        redoStack.clear();
+        invalidateEmpViews();
+        empCols.buildFrom(empAvl); //释放列式副本
+        empColsDirty = false;
+        empSort.invalidate();
+        sqlPager.invalidate();
+        sqlPage = 0;
+    } else {
+        sqlMode = false;
+        loadEmployeesFromDbToAvl();
+    }
+
+    setEmpEditingEnabled(!sqlMode);
     refreshEmployeesByDeptSelection();
 }
 
+void MainWindow::prevSqlPage() {
+    auto rec = recordOp("prevSqlPage");
+    if (sqlPage <= 0) return;
+    --sqlPage;
+    refreshEmployeesFromSql();
+}
+
+void MainWindow::nextSqlPage() {
+    auto rec = recordOp("nextSqlPage");
+    if (sqlPage + 1 >= sqlPager.pageCount()) return;
+    ++sqlPage;
+    refreshEmployeesFromSql();
+}
+
+void MainWindow::setEmpEditingEnabled(bool on) {
+    for (QPushButton* b : { btnAddEmp, btnUpdateEmp, btnDeleteEmp, btnClearDb, btnSaveAll, btnExportCsv,
+                            btnBatchRaisePct, btnBatchRaiseAmt, btnBatchMove, btnBatchDelete, btnDeleteDept,
+                            btnTopPaid, btnLowestPaid, btnSalaryStats }) {
+        if (b) b->setEnabled(on);
+    }
+    if (editFilter) editFilter->setEnabled(on); //SQL 直查模式只按部门分页，不支持筛选表达式
+    if (on) updateUndoButtons();
+    else {
+        btnUndo->setEnabled(false);
+        btnRedo->setEnabled(false);
+    }
+    btnPrevPage->setVisible(!on);
+    btnNextPage->setVisible(!on);
+    labelPage->setVisible(!on);
+}
+
 //员工
 void MainWindow::addEmployee() {
+    auto rec = recordOp("addEmployee");
     bool okNo=false, okDep=false, okSal=false;
     int no = editNo->text().trimmed().toInt(&okNo);
     int depno = editDepno->text().trimmed().toInt(&okDep);
@@ -471,16 +1118,17 @@ void MainWindow::addEmployee() {
 
     Emp e;
     e.no = no;
-    e.name = name;
+    e.setName(name);
     e.depno = depno;
     e.salary = salary;
 
-    empAvl.insert(e);
+    empInsert(e);
 
     refreshEmployeesByDeptSelection();
 }
 
 void MainWindow::updateEmployee() {
+    auto rec = recordOp("updateEmployee");
     bool okNo=false, okDep=false, okSal=false;
     int no = editNo->text().trimmed().toInt(&okNo);
     int depno = editDepno->text().trimmed().toInt(&okDep);
@@ -497,21 +1145,23 @@ void MainWindow::updateEmployee() {
         return;
     }
 
-    Emp* p = empAvl.find(no);
-    if (!p) {
+    if (!empAvl.find(no)) {
         QMessageBox::information(this,"提示","找不到该工号（AVL中不存在）");
         return;
     }
 
-    // AVL 以 no 为 key，修改 name/depno/salary 不影响平衡/排序
-    p->name = name;
-    p->depno = depno;
-    p->salary = salary;
+    Emp e;
+    e.no = no;
+    e.setName(name);
+    e.depno = depno;
+    e.salary = salary;
+    empUpdate(e);
 
     refreshEmployeesByDeptSelection();
 }
 
 void MainWindow::deleteSelectedRow() {
+    auto rec = recordOp("deleteSelectedRow");
     auto ranges = tableEmps->selectedRanges();
     if (ranges.isEmpty()) {
         QMessageBox::information(this,"提示","请先选中一行再删除");
@@ -530,61 +1180,539 @@ void MainWindow::deleteSelectedRow() {
         return;
     }
 
-    empAvl.remove(no);
+    empRemove(no);
 
     refreshEmployeesByDeptSelection();
 }
 
 void MainWindow::clearAllInMemoryAndDb() {
-    if (QMessageBox::question(this, "确认", "确定要删除全部员工记录吗？") != QMessageBox::Yes)
+    auto rec = recordOp("clearAllInMemoryAndDb");
+    if (!confirm("确定要删除全部员工记录吗？"))
         return;
 
+    QVector<int> nos;
+    nos.reserve(empAvl.size());
+    empAvl.forEachInorder([&nos](const Emp& e) { nos.push_back(e.no); });
+
+    PersistentAvl before = empVersion;
     empAvl.clear();
+    journal.appendClear();
+    empVersion = PersistentAvl();
+    pushUndo("全清", before, nos);
+    invalidateEmpViews();
     refreshEmployeesByDeptSelection();
 }
 
+void MainWindow::batchRaisePercent() {
+    auto rec = recordOp("batchRaisePercent");
+    bool ok = false;
+    double pct = editBatchValue->text().trimmed().toDouble(&ok);
+    if (!ok) { QMessageBox::information(this,"提示","百分比必须是数字，例如 5 或 -3.5"); return; }
+    if (pct <= -100) { QMessageBox::information(this,"提示","百分比必须大于 -100"); return; }
+    runDeptBatch(BatchOp::RaisePercent, pct);
+}
 
-//递归找到子树
-void MainWindow::collectDeptNosFromItem(QTreeWidgetItem* item, QSet<int>& out) const {
-    if (!item) return;
+void MainWindow::batchRaiseAmount() {
+    auto rec = recordOp("batchRaiseAmount");
+    bool ok = false;
+    double amt = editBatchValue->text().trimmed().toDouble(&ok);
+    if (!ok) { QMessageBox::information(this,"提示","金额必须是数字"); return; }
+    runDeptBatch(BatchOp::RaiseAmount, amt);
+}
 
+void MainWindow::batchMoveDept() {
+    auto rec = recordOp("batchMoveDept");
     bool ok = false;
-    int depno = deptTree.depnoOf(item->data(0, Qt::UserRole).toInt(&ok));
-    if (ok) out.insert(depno);
+    int depno = editBatchTargetDep->text().trimmed().toInt(&ok);
+    if (!ok || depno <= 0) { QMessageBox::information(this,"提示","目标部门号必须是 >0 的整数"); return; }
+    if (!deptTree.containsDepno(depno)) {
+        QMessageBox::information(this,"提示", QString("部门 %1 不存在，请先新增部门。").arg(depno));
+        return;
+    }
+    runDeptBatch(BatchOp::MoveDept, depno);
+}
 
-    for (int i = 0; i < item->childCount(); ++i) {
-        collectDeptNosFromItem(item->child(i), out);
+void MainWindow::batchDelete() {
+    auto rec = recordOp("batchDelete");
+    runDeptBatch(BatchOp::Delete, 0);
+}
+
+void MainWindow::showTopPaid() {
+    auto rec = recordOp("showTopPaid");
+    showDeptTopK(true);
+}
+
+void MainWindow::showLowestPaid() {
+    auto rec = recordOp("showLowestPaid");
+    showDeptTopK(false);
+}
+
+//部门子树工资排行：走按部门分组的工资索引，各部门树的最值进堆合并，只取 K 个
+//  不用像“按工资排序”那样把子树里全部员工过滤出来再排序
+void MainWindow::showDeptTopK(bool highest) {
+    if (sqlMode) return;
+    bool ok = false;
+    const int k = editTopK->text().trimmed().toInt(&ok);
+    if (!ok || k <= 0) { QMessageBox::information(this,"提示","人数 K 必须是正整数"); return; }
+
+    TRACE_SCOPE("showDeptTopK");
+    ensureSalaryIndex();
+    const QSet<int> depSet = selectedDeptSubtreeNos();
+    const QVector<SalaryKey> top = salaryIdx.topK(depSet, k, highest);
+
+    TRACE_SCOPE("populateTable");
+    shownViewKey.clear();
+    tableEmps->setRowCount(0);
+    tableEmps->setRowCount(top.size());
+    for (int r = 0; r < top.size(); ++r) {
+        const Emp* e = empAvl.find(top[r].no);
+        if (!e) continue;
+        tableEmps->setItem(r, 0, new QTableWidgetItem(QString::number(e->no)));
+        tableEmps->setItem(r, 1, new QTableWidgetItem(e->nameString()));
+        tableEmps->setItem(r, 2, new QTableWidgetItem(QString::number(e->depno)));
+        tableEmps->setItem(r, 3, new QTableWidgetItem(QString::number(e->salary)));
     }
+
+    const QString scope = depSet.isEmpty() ? QString("全部部门") : QString("选中部门子树（%1 个部门）").arg(depSet.size());
+    setStatus(QString("%1工资%2的 %3 人（工资索引，%4）")
+                  .arg(scope).arg(highest ? "最高" : "最低").arg(top.size())
+                  .arg(highest ? "从高到低" : "从低到高"));
+}
+
+void MainWindow::ensureSalaryIndex() {
+    if (!salaryIdxDirty) return;
+    TRACE_SCOPE("salaryIdx.rebuild");
+    salaryIdx.rebuild(empAvl);
+    salaryIdxDirty = false;
 }
 
+//选中部门子树的工资分位数与定宽分段人数：全部走工资索引的子树计数，不拷贝、不排序员工
+void MainWindow::showSalaryStats() {
+    auto rec = recordOp("showSalaryStats");
+    if (sqlMode) return;
+    TRACE_SCOPE("showSalaryStats");
+    ensureSalaryIndex();
+
+    const QSet<int> depSet = selectedDeptSubtreeNos();
+    const QString scope = depSet.isEmpty() ? QString("全部部门") : QString("选中部门子树（%1 个部门）").arg(depSet.size());
+    const int n = salaryIdx.count(depSet);
+    if (n == 0) {
+        QMessageBox::information(this, "工资分布", scope + "没有员工");
+        return;
+    }
+
+    QStringList lines;
+    lines << QString("%1：%2 人").arg(scope).arg(n);
+    static const struct { double p; const char* name; } kPoints[] = {
+        {0.0, "最低"}, {0.10, "P10"}, {0.25, "P25"}, {0.50, "中位数"},
+        {0.75, "P75"}, {0.90, "P90"}, {0.99, "P99"}, {1.0, "最高"},
+    };
+    double lo = 0, hi = 0;
+    for (const auto& pt : kPoints) {
+        double v = 0;
+        salaryIdx.percentile(depSet, pt.p, &v);
+        if (pt.p == 0.0) lo = v;
+        if (pt.p == 1.0) hi = v;
+        lines << QString("%1：%2").arg(QString::fromUtf8(pt.name)).arg(v, 0, 'f', 2);
+    }
+
+    //最低到最高等分成固定段数；每段人数 = 两条边界的 countBelow 之差
+    const QVector<double> edges = DeptSalaryIndex::evenEdges(lo, hi, kSalaryBuckets);
+    const QVector<int> counts = salaryIdx.histogram(depSet, edges);
+    const int peak = counts.isEmpty() ? 0 : *std::max_element(counts.begin(), counts.end());
+    lines << QString() << "工资分段（人数）：";
+    for (int i = 0; i < counts.size(); ++i) {
+        const int bar = peak > 0 ? (counts[i] * 30 + peak - 1) / peak : 0;
+        lines << QString("[%1, %2%3  %4 人  %5")
+                     .arg(edges[i], 0, 'f', 0).arg(edges[i + 1], 0, 'f', 0)
+                     .arg(i + 1 == counts.size() ? "]" : ")")
+                     .arg(counts[i]).arg(QString(bar, QChar(0x2588)));
+    }
+    QMessageBox::information(this, "工资分布", lines.join('\n'));
+}
+
+//"yyyy-MM-dd HH:mm[:ss]" 或 "yyyy-MM-dd"（当天结束时）；空为现在。结果为 Unix 毫秒
+static bool parseAsOf(const QString& text, qint64* ms, QString* shown) {
+    const QString t = text.simplified();
+    QDateTime dt;
+    if (t.isEmpty()) {
+        dt = QDateTime::currentDateTime();
+    } else {
+        for (const char* fmt : { "yyyy-MM-dd HH:mm:ss", "yyyy-MM-dd HH:mm" }) {
+            dt = QDateTime::fromString(t, QString::fromLatin1(fmt));
+            if (dt.isValid()) break;
+        }
+        if (!dt.isValid()) {
+            const QDate d = QDate::fromString(t, "yyyy-MM-dd");
+            if (!d.isValid()) return false;
+            dt = QDateTime(d, QTime(23, 59, 59, 999));
+        }
+    }
+    *ms = dt.toMSecsSinceEpoch();
+    *shown = dt.toString("yyyy-MM-dd HH:mm:ss");
+    return true;
+}
+
+static QString formatTs(qint64 ms) {
+    return QDateTime::fromMSecsSinceEpoch(ms).toString("yyyy-MM-dd HH:mm:ss");
+}
+
+bool MainWindow::syncSalaryHistory(QString* err) {
+    TRACE_SCOPE("history.sync");
+    //日志里还没进库的修改先合并，合并时才按各自的编辑时间写进历史
+    compactJournal(true);
+    QVector<EmpHistoryRow> rows;
+    if (!dbm.fetchHistorySince(salaryHistory.lastId(), &rows, err)) return false;
+    for (const auto& r : rows) salaryHistory.append(r.id, r.ts, r.no, r.depno, r.salary, r.removed);
+    return true;
+}
+
+//某一时刻选中部门子树（按现在的部门结构）的人数与工资总额：从最近的检查点补增量，不重放全部历史
+void MainWindow::showPayrollAsOf() {
+    auto rec = recordOp("showPayrollAsOf");
+    TRACE_SCOPE("showPayrollAsOf");
+    qint64 ts = 0;
+    QString when;
+    if (!parseAsOf(editAsOf->text(), &ts, &when)) {
+        QMessageBox::warning(this, "提示", "日期格式应为 yyyy-MM-dd 或 yyyy-MM-dd HH:mm");
+        return;
+    }
+    QString err;
+    if (!syncSalaryHistory(&err)) {
+        QMessageBox::warning(this, "提示", "读取历史失败:\n" + err);
+        return;
+    }
+    if (salaryHistory.isEmpty() || ts < salaryHistory.firstTs()) {
+        QMessageBox::information(this, "工资总况",
+                                 QString("%1 之前没有历史记录（最早一条：%2）")
+                                     .arg(when).arg(salaryHistory.isEmpty() ? QString("无") : formatTs(salaryHistory.firstTs())));
+        return;
+    }
+
+    const SalaryHistory::Payroll p = salaryHistory.payrollAt(ts);
+    const QSet<int> depSet = selectedDeptSubtreeNos();
+    QList<int> deps;
+    int count = 0;
+    double total = 0;
+    for (auto it = p.byDept.cbegin(); it != p.byDept.cend(); ++it) {
+        if (!depSet.isEmpty() && !depSet.contains(it.key())) continue;
+        deps.push_back(it.key());
+        count += it->count;
+        total += it->total;
+    }
+    std::sort(deps.begin(), deps.end());
+
+    QStringList lines;
+    lines << QString("%1 %2").arg(when).arg(depSet.isEmpty() ? QString("全部部门")
+                                                              : QString("选中部门子树（%1 个部门）").arg(depSet.size()));
+    lines << QString("人数 %1，工资总额 %2，人均 %3")
+                 .arg(count).arg(total, 0, 'f', 2).arg(count ? total / count : 0.0, 0, 'f', 2);
+    lines << QString() << "各部门：";
+    const int kMaxLines = 30;
+    for (int i = 0; i < deps.size() && i < kMaxLines; ++i) {
+        const SalaryHistory::DeptPay d = p.byDept.value(deps[i]);
+        lines << QString("部门 %1：%2 人，%3").arg(deps[i]).arg(d.count).arg(d.total, 0, 'f', 2);
+    }
+    if (deps.size() > kMaxLines) lines << QString("……另有 %1 个部门").arg(deps.size() - kMaxLines);
+    QMessageBox::information(this, "工资总况", lines.join('\n'));
+}
+
+//某员工在某一时刻的部门与工资（每个工号按时间排好的版本数组上二分），并列出最近的变动
+void MainWindow::showEmployeeAsOf() {
+    auto rec = recordOp("showEmployeeAsOf");
+    TRACE_SCOPE("showEmployeeAsOf");
+    bool ok = false;
+    const int no = editNo->text().trimmed().toInt(&ok);
+    if (!ok) {
+        QMessageBox::warning(this, "提示", "请先在工号输入框里填写工号");
+        return;
+    }
+    qint64 ts = 0;
+    QString when;
+    if (!parseAsOf(editAsOf->text(), &ts, &when)) {
+        QMessageBox::warning(this, "提示", "日期格式应为 yyyy-MM-dd 或 yyyy-MM-dd HH:mm");
+        return;
+    }
+    QString err;
+    if (!syncSalaryHistory(&err)) {
+        QMessageBox::warning(this, "提示", "读取历史失败:\n" + err);
+        return;
+    }
+
+    QStringList lines;
+    SalaryHistory::Version v;
+    if (salaryHistory.employeeAt(no, ts, &v))
+        lines << QString("工号 %1 在 %2：部门 %3，工资 %4").arg(no).arg(when).arg(v.depno).arg(v.salary, 0, 'f', 2);
+    else
+        lines << QString("工号 %1 在 %2 不在职（或没有记录）").arg(no).arg(when);
+
+    const QVector<SalaryHistory::Version> all = salaryHistory.versionsOf(no);
+    if (!all.isEmpty()) {
+        const int kMaxLines = 20;
+        lines << QString() << QString("变动记录（共 %1 条，最近的在后）：").arg(all.size());
+        for (int i = std::max(0, all.size() - kMaxLines); i < all.size(); ++i) {
+            const auto& x = all[i];
+            lines << (x.removed ? QString("%1  删除").arg(formatTs(x.ts))
+                                : QString("%1  部门 %2，工资 %3").arg(formatTs(x.ts)).arg(x.depno).arg(x.salary, 0, 'f', 2));
+        }
+    }
+    QMessageBox::information(this, "员工历史", lines.join('\n'));
+}
+
+//批量操作：
+//  1. 主索引一次原地遍历（key 不变，不触发旋转），删除的工号先收集再逐个摘除
+//  2. 改动的行在一个事务里写回 DB
+//  3. 持久化版本按改动量选择逐条 path-copy 或整体重建，只记一条撤销
+//  4. 派生结构（列式副本/后台快照）统一失效一次，表格只刷新一次
+void MainWindow::runDeptBatch(BatchOp op, double value) {
+    TRACE_SCOPE("runDeptBatch");
+    QSet<int> depSet = selectedDeptSubtreeNos();
+    const bool all = depSet.isEmpty(); //根节点：作用于全部员工
+    const QString scope = all ? QString("全部部门") : QString("选中部门子树（%1 个部门）").arg(depSet.size());
+
+    QString label;
+    switch (op) {
+    case BatchOp::RaisePercent: label = QString("批量调薪 %1%").arg(value); break;
+    case BatchOp::RaiseAmount:  label = QString("批量调薪 %1").arg(value); break;
+    case BatchOp::MoveDept:     label = QString("批量转入部门 %1").arg(int(value)); break;
+    case BatchOp::Delete:       label = "批量删除"; break;
+    }
+
+    if (!confirm(QString("对%1的员工执行「%2」？").arg(scope).arg(label)))
+        return;
+
+    QVector<Emp> changed;
+    QVector<int> removed;
+    {
+        TRACE_SCOPE("batch.apply");
+        empAvl.forEachMutable([&](Emp& e) {
+            if (!all && !depSet.contains(e.depno)) return;
+            switch (op) {
+            case BatchOp::RaisePercent:
+                e.salary = std::round(e.salary * (100.0 + value)) / 100.0;
+                break;
+            case BatchOp::RaiseAmount:
+                e.salary = std::round((e.salary + value) * 100.0) / 100.0;
+                break;
+            case BatchOp::MoveDept:
+                if (e.depno == int(value)) return;
+                e.depno = int(value);
+                break;
+            case BatchOp::Delete:
+                removed.push_back(e.no);
+                return;
+            }
+            changed.push_back(e);
+        });
+        for (int no : removed) empAvl.remove(no);
+    }
+
+    if (changed.isEmpty() && removed.isEmpty()) {
+        setStatus(QString("%1：没有需要修改的员工").arg(label));
+        return;
+    }
+
+    QVector<int> nos;
+    nos.reserve(changed.size() + removed.size());
+    for (const auto& e : changed) nos.push_back(e.no);
+    nos += removed;
+
+    PersistentAvl before = empVersion;
+    {
+        TRACE_SCOPE("batch.version");
+        //改动超过 1/8 时整体重建（O(n)）比逐条复制路径（O(k log n)）更省
+        if (nos.size() > empAvl.size() / 8) {
+            empVersion = PersistentAvl::fromSorted(empAvl.inorder());
+        } else {
+            for (const auto& e : changed) empVersion = empVersion.update(e);
+            for (int no : removed) empVersion = empVersion.remove(no);
+        }
+    }
+    pushUndo(label, before, nos);
+    invalidateEmpViews(nos);
+
+    //与单条修改走同一条路：整批作为一个事务记进变更日志，组提交落盘后由后台合并进库
+    //（日志不可用时同样等“保存”整表写回）
+    journal.appendBatch(changed, removed);
+
+    refreshEmployeesByDeptSelection();
+    setStatus(QString("%1：%2 条员工记录").arg(label).arg(nos.size()));
+}
+
+//员工变更统一入口：AVL（主数据）与持久化版本同步修改，并记一条撤销
+//持久化版本每次只复制 O(log n) 条路径，旧版本留在撤销栈里
+bool MainWindow::empInsert(const Emp& e) {
+    if (!empAvl.insert(e)) return false;
+    journal.appendUpsert(e);
+    PersistentAvl before = empVersion;
+    empVersion = empVersion.insert(e);
+    pushUndo(QString("添加 %1").arg(e.no), before, QVector<int>() << e.no);
+    invalidateEmpViews(QVector<int>() << e.no);
+    return true;
+}
+
+bool MainWindow::empUpdate(const Emp& e) {
+    Emp* p = empAvl.find(e.no);
+    if (!p) return false;
+    // AVL 以 no 为 key，修改 name/depno/salary 不影响平衡/排序
+    *p = e;
+    journal.appendUpsert(e);
+    PersistentAvl before = empVersion;
+    empVersion = empVersion.update(e);
+    pushUndo(QString("修改 %1").arg(e.no), before, QVector<int>() << e.no);
+    invalidateEmpViews(QVector<int>() << e.no);
+    return true;
+}
+
+bool MainWindow::empRemove(int no) {
+    if (!empAvl.remove(no)) return false;
+    journal.appendRemove(no);
+    PersistentAvl before = empVersion;
+    empVersion = empVersion.remove(no);
+    pushUndo(QString("删除 %1").arg(no), before, QVector<int>() << no);
+    invalidateEmpViews(QVector<int>() << no);
+    return true;
+}
+
+void MainWindow::pushUndo(const QString& label, const PersistentAvl& before, const QVector<int>& nos) {
+    EmpUndo u;
+    u.label = label;
+    u.before = before;
+    u.after = empVersion;
+    u.nos = nos;
+    undoStack.push_back(u);
+    if (undoStack.size() > kMaxUndo) undoStack.removeFirst();
+    redoStack.clear();
+    updateUndoButtons();
+}
+
+//把 nos 这些工号在 AVL 中的状态改成 target 版本里的样子
+void MainWindow::applyEmpVersion(const PersistentAvl& target, const QVector<int>& nos) {
+    TRACE_SCOPE("applyEmpVersion");
+    QVector<Emp> upserts;
+    QVector<int> removes;
+    for (int no : nos) {
+        const Emp* want = target.find(no);
+        Emp* cur = empAvl.find(no);
+        if (want && cur) *cur = *want;
+        else if (want) empAvl.insert(*want);
+        else if (cur) empAvl.remove(no);
+        if (want) upserts.push_back(*want);
+        else removes.push_back(no);
+    }
+    //撤销/重做一次批量修改时同样整批一个日志事务
+    journal.appendBatch(upserts, removes);
+    empVersion = target;
+    invalidateEmpViews(nos);
+}
+
+void MainWindow::undoEmp() {
+    auto rec = recordOp("undoEmp");
+    if (undoStack.isEmpty()) return;
+    EmpUndo u = undoStack.takeLast();
+    applyEmpVersion(u.before, u.nos);
+    redoStack.push_back(u);
+    updateUndoButtons();
+    refreshEmployeesByDeptSelection();
+    setStatus(QString("已撤销：%1").arg(u.label));
+}
+
+void MainWindow::redoEmp() {
+    auto rec = recordOp("redoEmp");
+    if (redoStack.isEmpty()) return;
+    EmpUndo u = redoStack.takeLast();
+    applyEmpVersion(u.after, u.nos);
+    undoStack.push_back(u);
+    updateUndoButtons();
+    refreshEmployeesByDeptSelection();
+    setStatus(QString("已重做：%1").arg(u.label));
+}
+
+void MainWindow::updateUndoButtons() {
+    if (btnUndo) btnUndo->setEnabled(!undoStack.isEmpty());
+    if (btnRedo) btnRedo->setEnabled(!redoStack.isEmpty());
+}
+
+
+//选中部门子树的 depno 集合：直接从 DeptTree 取，未展开的下级部门也包含在内
 QSet<int> MainWindow::selectedDeptSubtreeNos() const {
     QSet<int> s;
     if (!treeDepts) return s;
 
-    QTreeWidgetItem* cur = treeDepts->currentItem();
-    if (!cur) return s;
-
     // 约定：0 - 全部部门（根），选它就代表不过滤/显示全部
-    bool ok = false;
-    int depno = deptTree.depnoOf(cur->data(0, Qt::UserRole).toInt(&ok));
-    qDebug() << depno;
-    if (ok && depno == 0) {
-        return s; // 返回空集合，表示“不过滤”
-    }
+    int id = selectedDeptId().toInt();
+    if (id == 0) return s; // 返回空集合，表示“不过滤”
 
-    collectDeptNosFromItem(cur, s);
-    return s;
+    return deptTree.subtreeDepnos(id);
 }
+
 void MainWindow::sortByNo(){
-    sortMode = SortMode::SortByNo;
+    auto rec = recordOp("sortByNo");
+    sortSpec = EmpSortSpec{{EmpCol::No, false}};
+    updateSortIndicator();
     refreshEmployeesByDeptSelection();
 }
 
 void MainWindow::sortBySalary(){
-    sortMode = SortMode::SortBySalary;
+    auto rec = recordOp("sortBySalary");
+    sortSpec = EmpSortSpec{{EmpCol::Salary, false}};
+    updateSortIndicator();
+    refreshEmployeesByDeptSelection();
+}
+
+void MainWindow::applySortSpec(const QString& spec) {
+    auto rec = recordOp("applySortSpec", spec);
+    EmpSortSpec parsed;
+    if (!EmpSort::parseSpec(spec, &parsed)) return;
+    sortSpec = parsed;
+    updateSortIndicator();
     refreshEmployeesByDeptSelection();
 }
 
+void MainWindow::applyFilter(const QString& text) {
+    auto rec = recordOp("applyFilter", text);
+    if (sqlMode) return;
+    const QString t = text.simplified();
+    QString err;
+    if (!t.isEmpty() && !EmpFilter::compile(t, deptTree, &err)) { //出错时保留原来的筛选
+        QMessageBox::warning(this, "筛选表达式有误", err);
+        return;
+    }
+    filterText = t;
+    refreshEmployeesByDeptSelection(); //状态栏带上命中行数与执行计划
+}
+
+//点表头：按这一列排序，再点一次反向；按住 Shift 点则把这一列追加为次要排序列（已在其中则反向）
+void MainWindow::onEmpHeaderClicked(int section) {
+    if (section < 0 || section > int(EmpCol::Salary)) return;
+    const EmpCol col = EmpCol(section);
+    const bool shift = QGuiApplication::keyboardModifiers() & Qt::ShiftModifier;
+
+    EmpSortSpec next = sortSpec;
+    int at = -1;
+    for (int i = 0; i < next.size(); ++i)
+        if (next[i].col == col) at = i;
+    if (shift) {
+        if (at >= 0) next[at].desc = !next[at].desc;
+        else next.push_back(EmpSortKey{col, false});
+    } else if (at == 0) {
+        next[0].desc = !next[0].desc;
+    } else {
+        next = EmpSortSpec{{col, false}};
+    }
+    //经过 applySortSpec，录制下来的是排序规则文本，回放与键盘状态无关
+    applySortSpec(EmpSort::formatSpec(next));
+}
+
+void MainWindow::updateSortIndicator() {
+    QHeaderView* h = tableEmps->horizontalHeader();
+    if (sortSpec.isEmpty()) {
+        h->setSortIndicator(-1, Qt::AscendingOrder);
+        return;
+    }
+    h->setSortIndicator(int(sortSpec.first().col), sortSpec.first().desc ? Qt::DescendingOrder : Qt::AscendingOrder);
+}
+
 void MainWindow::appendDeptAndRefresh(int newId, int depno, const QString& name, const QVariant& parentId) {
     DeptRow r;
     r.id = newId;
@@ -592,11 +1720,392 @@ void MainWindow::appendDeptAndRefresh(int newId, int depno, const QString& name,
     r.name = name;
     r.parentId = parentId;  //顶级为QVariant()
 
+    TRACE_SCOPE("appendDeptAndRefresh");
     deptRowsCache.push_back(r);                 //更新内存主数据
-    deptTree.buildFromRows(deptRowsCache);//用缓存重建 DeptTree
-    loadDeptsToTree(newId);//刷新UI，并选中新节点
+    QString err;
+    if (!deptTree.addDept(r, &err)) {           //就地挂到父节点下
+        deptTree.buildFromRows(deptRowsCache);
+        loadDeptsToTree(newId);
+        return;
+    }
+
+    //模型里只插入这一行并选中
+    deptModel->deptAdded(newId);
+    selectDept(newId);
 }
 
+//修改在提交窗口内就已落盘到日志；“保存”只是立即提交并触发后台合并进 SQLite
 void MainWindow::saveAll(){
-    saveEmployeesFromAvlToDb();
+    auto rec = recordOp("saveAll");
+    TRACE_SCOPE("saveAll");
+    if (!journal.isOpen()) { //日志不可用：退回整表写回
+        QString err;
+        if (!dbm.replaceAllEmployees(empSnapshot().inorder(), &err)) {
+            QMessageBox::warning(this, "保存失败", err);
+            return;
+        }
+        noteOwnDbWrite();
+        setStatus("已保存（整表写回数据库）");
+        return;
+    }
+    QString err;
+    if (!journal.sync(&err)) {
+        QMessageBox::warning(this, "保存失败", "变更日志写盘失败（修改仍在内存里，稍后会自动重试）:\n" + err);
+        return;
+    }
+    compactJournal(false);
+    setStatus("已保存（变更日志已落盘，后台合并到数据库）");
+}
+
+//把日志段合并进数据库：用独立连接（可在后台线程执行），成功后删除这些段
+//重放是幂等的（按 no 覆盖/删除），中途崩溃下次再重放一遍即可
+static JournalCompaction compactSegmentsIntoDb(const QString& dbFile, const QStringList& segs, const QString& connName) {
+    TRACE_SCOPE("journal.compact");
+    JournalCompaction res;
+    QVector<ChangeJournal::Record> recs;
+    for (const auto& seg : segs) {
+        if (!ChangeJournal::readSegment(seg, &recs, &res.err)) return res;
+    }
+    ChangeJournal::Delta d = ChangeJournal::collapse(recs);
+
+    //净变化之外，每条记录按它的编辑时间写历史：中间被覆盖或改回去的修改也留得下来
+    QVector<EmpEdit> edits;
+    edits.reserve(recs.size());
+    for (const auto& r : recs) {
+        EmpEdit e;
+        e.kind = r.type == ChangeJournal::EmpUpsert ? EmpEdit::Upsert
+               : r.type == ChangeJournal::EmpRemove ? EmpEdit::Remove : EmpEdit::Clear;
+        e.ts = r.ts;
+        e.no = r.emp.no;
+        e.depno = r.emp.depno;
+        e.salary = r.emp.salary;
+        edits.push_back(e);
+    }
+
+    if (!d.isEmpty()) {
+        DbManager db(connName);
+        if (!db.open(dbFile)) {
+            res.err = db.db().lastError().text();
+            return res;
+        }
+        bool ok = db.applyEmployeeChanges(d.upserts, d.removes, &res.err, d.clear, &edits, &res.span);
+        db.close();
+        if (!ok) return res;
+    }
+    for (const auto& seg : segs) QFile::remove(seg);
+    return res;
+}
+
+bool MainWindow::replayJournalIntoDb() {
+    TRACE_SCOPE("journal.replay");
+    const QStringList segs = ChangeJournal::segments(dbFile + ".journal");
+    if (segs.isEmpty()) return true;
+
+    const QString err = compactSegmentsIntoDb(dbFile, segs, "conn_journal_replay").err;
+    if (!err.isEmpty()) {
+        QMessageBox::warning(this, "DB错误", "重放变更日志失败:\n" + err);
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::compactJournal(bool wait) {
+    if (!journal.isOpen()) return;
+    if (compactFuture.isRunning()) {
+        if (!wait) return; //上一轮还没合并完，下次再说
+        compactFuture.waitForFinished();
+    }
+
+    QString err;
+    const QStringList segs = journal.rotate(&err);
+    if (!err.isEmpty()) {
+        if (wait) QMessageBox::warning(this, "提示", "切换变更日志失败:\n" + err);
+        else setStatus("切换变更日志失败（稍后重试）：" + err);
+        return;
+    }
+    if (segs.isEmpty()) return;
+
+    const QString file = dbFile;
+    compactFuture = QtConcurrent::run([file, segs]() {
+        return compactSegmentsIntoDb(file, segs, "conn_journal_compact");
+    });
+
+    if (wait) {
+        const JournalCompaction res = compactFuture.result();
+        absorbOwnWrite(res.span);
+        if (!res.err.isEmpty()) QMessageBox::warning(this, "提示", "合并变更日志失败:\n" + res.err);
+        return;
+    }
+    auto* watcher = new QFutureWatcher<JournalCompaction>(this);
+    connect(watcher, &QFutureWatcher<JournalCompaction>::finished, this, [this, watcher]() {
+        const JournalCompaction res = watcher->result();
+        watcher->deleteLater();
+        absorbOwnWrite(res.span);
+        if (!res.err.isEmpty()) setStatus("后台合并变更日志失败（日志仍保留，稍后重试）：" + res.err);
+    });
+    watcher->setFuture(compactFuture);
+}
+
+void MainWindow::absorbOwnWrite(const ChangeSeqSpan& span) {
+    //写之前还有没同步的外部变更：起点不动，轮询照常去读（自己写的行读回来会被认出来跳过）
+    if (span.before < 0 || span.before != dbChangeSeq) return;
+    //先读 data_version 再读序号：序号还停在这次写之后，说明读 data_version 时也没有别的提交
+    qint64 dv = 0, seq = 0;
+    if (!dbm.dataVersion(&dv) || !dbm.changeSeq(&seq) || seq != span.after) return;
+    dbDataVersion = dv;
+    dbChangeSeq = span.after;
+}
+
+void MainWindow::noteOwnDbWrite() {
+    //先读序号再读 data_version：data_version 还是上次同步时的值，说明读序号之前没有别的连接提交，增长全是自己写的
+    qint64 seq = 0, dv = 0;
+    if (dbm.changeSeq(&seq) && dbm.dataVersion(&dv) && dv == dbDataVersion) dbChangeSeq = seq;
+}
+
+void MainWindow::onTraceToggled(bool on) {
+    Trace::setEnabled(on);
+    if (on) traceTimer->start();
+    else traceTimer->stop();
+    refreshTracePanel();
+}
+
+//最近 N 次操作耗时（新的在上）
+void MainWindow::refreshTracePanel() {
+    if (!listTrace) return;
+    const int kShow = 50;
+    QVector<Trace::Event> evs = Trace::recent(kShow);
+
+    listTrace->clear();
+    for (int i = evs.size() - 1; i >= 0; --i) {
+        const auto& e = evs[i];
+        listTrace->addItem(QString("%1  %2 ms")
+                               .arg(QString::fromLatin1(e.name))
+                               .arg(e.durUs / 1000.0, 0, 'f', 3));
+    }
+}
+
+void MainWindow::exportTrace() {
+    QString path = QFileDialog::getSaveFileName(this, "导出Trace", "trace.json", "JSON (*.json)");
+    if (path.isEmpty()) return;
+
+    QString err;
+    if (!Trace::exportChromeJson(path, &err)) {
+        QMessageBox::warning(this, "导出失败", err);
+        return;
+    }
+    setStatus(QString("已导出 Trace：%1（可用 chrome://tracing 打开）").arg(path));
+}
+
+MemReport MainWindow::memoryReport() const {
+    TRACE_SCOPE("memoryReport");
+    //seen 只用在规模小的地方（部门、撤销历史独占的节点）；员工姓名都在全局 arena 里，单独一行
+    MemAcct::Seen seen;
+    MemReport rep;
+    rep.add("员工主索引", empAvl.memoryUsage());
+    rep.add("员工姓名 arena", NameArena::global().memoryUsage());
+    rep.add("持久化版本", empVersion.memoryUsage());
+
+    MemUsage hist;
+    for (const auto* stack : {&undoStack, &redoStack}) {
+        for (const auto& u : *stack) {
+            hist += u.before.memoryUsageBeyond(empVersion, &seen);
+            hist += u.after.memoryUsageBeyond(empVersion, &seen);
+        }
+    }
+    hist += empShared.snapshot()->memoryUsageBeyond(empVersion, &seen);
+    rep.add("撤销历史/快照", hist);
+
+    rep.add("列式副本", empCols.memoryUsage());
+    rep.add("排序缓存", empSort.memoryUsage());
+    rep.add("筛选缓存", filterCache.memoryUsage());
+    rep.add("视图缓存", viewCache.memoryUsage());
+    rep.add("工资历史", salaryHistory.memoryUsage());
+    rep.add("部门工资索引", salaryIdx.memoryUsage());
+    rep.add("部门树", deptTree.memoryUsage(&seen));
+    MemUsage rows;
+    MemAcct::addVector(deptRowsCache, &rows, &seen);
+    rep.add("部门缓存", rows);
+    rep.add("SQL 分页缓存", sqlPager.memoryUsage());
+    rep.add("变更日志缓冲", journal.memoryUsage());
+
+    //持久化版本整体重建、导出等会做一次全量 inorder()：数组是新分配的，姓名只拷句柄
+    rep.addTransient("一次全量 inorder() 拷贝",
+                     MemAcct::heapBlock(24 + qint64(empAvl.size()) * qint64(sizeof(Emp))));
+    return rep;
+}
+
+void MainWindow::refreshMemoryStatus() {
+    if (!labelMem) return;
+    const quint64 gen = empShared.generation();
+    if (gen == memReportGen) return;
+    memReportGen = gen;
+
+    const MemReport rep = memoryReport();
+    labelMem->setText(rep.summary());
+    labelMem->setToolTip(rep.table());
+}
+
+//---- 操作录制与回放 ----
+
+//录制时恢复的输入框（回放按名字写回）
+#define EM_RECORDED_FIELDS(X) \
+    X(editNo) X(editName) X(editDepno) X(editSalary) \
+    X(editBatchValue) X(editBatchTargetDep) X(editTopK) X(editFilter) X(editAsOf) \
+    X(editDeptNo) X(editDeptName) X(editDeptNewName) X(editDeptMoveTo)
+
+bool MainWindow::startRecording(const QString& path, QString* err) {
+    return recorder.open(path, err);
+}
+
+SessionRecorder::Scope MainWindow::recordOp(const char* op, const QVariant& arg) {
+    QJsonObject st;
+    if (recorder.wantsRecord()) {
+        st = captureUiState();
+        st.insert("op", QString::fromLatin1(op));
+        if (arg.isValid()) st.insert("arg", QJsonValue::fromVariant(arg));
+    }
+    return SessionRecorder::Scope(&recorder, st);
+}
+
+QJsonObject MainWindow::captureUiState() const {
+    QJsonObject st;
+    st.insert("dept", selectedDeptId().toInt());
+
+    //删除按表格选中行取工号，录下工号而不是行号（回放时行号可能不同）
+    auto ranges = tableEmps->selectedRanges();
+    if (!ranges.isEmpty()) {
+        if (auto* it = tableEmps->item(ranges.first().topRow(), 0)) st.insert("row", it->text().toInt());
+    }
+
+    QJsonObject f;
+#define EM_SAVE_FIELD(w) f.insert(#w, w->text());
+    EM_RECORDED_FIELDS(EM_SAVE_FIELD)
+#undef EM_SAVE_FIELD
+    st.insert("fields", f);
+    //勾选框的状态单独记：onSqlModeToggled 被调用时它已经是新状态
+    st.insert("sql", chkSqlMode->isChecked());
+    return st;
+}
+
+void MainWindow::restoreUiState(const QJsonObject& st) {
+    const QJsonObject f = st.value("fields").toObject();
+#define EM_LOAD_FIELD(w) if (f.contains(#w)) w->setText(f.value(#w).toString());
+    EM_RECORDED_FIELDS(EM_LOAD_FIELD)
+#undef EM_LOAD_FIELD
+    if (st.contains("sql")) {
+        QSignalBlocker block(chkSqlMode);
+        chkSqlMode->setChecked(st.value("sql").toBool());
+    }
+
+    tableEmps->clearSelection();
+    if (st.contains("row")) {
+        const QString no = QString::number(st.value("row").toInt());
+        for (int r = 0; r < tableEmps->rowCount(); ++r) {
+            auto* it = tableEmps->item(r, 0);
+            if (it && it->text() == no) {
+                tableEmps->selectRow(r);
+                break;
+            }
+        }
+    }
+}
+
+bool MainWindow::confirm(const QString& text) {
+    const bool yes = replaying ? replayConfirm
+                               : QMessageBox::question(this, "确认", text) == QMessageBox::Yes;
+    recorder.setConfirm(yes);
+    return yes;
+}
+
+int MainWindow::replayPass(const QVector<QJsonObject>& ops, OpStats* stats) {
+    //确认框不弹出，用录制的选择
+    replaying = true;
+    int skipped = 0;
+    for (const QJsonObject& st : ops) {
+        const QString op = st.value("op").toString();
+        //槽的规范化签名：参数与录制时的 arg 类型一致（const QString& 规范化后是 QString）
+        const QByteArray sig = op.toLatin1() + (!st.contains("arg")           ? "()"
+                                                : st.value("arg").isString() ? "(QString)"
+                                                                             : "(bool)");
+        if (metaObject()->indexOfSlot(sig.constData()) < 0) {
+            skipped++;
+            continue;
+        }
+        const int dept = st.value("dept").toInt();
+        replayConfirm = st.value("confirm").toBool(true);
+
+        //选中部门本身就是被测操作时，恢复状态不能提前触发它
+        if (op != "onDeptSelectionChanged") {
+            QSignalBlocker block(treeDepts->selectionModel());
+            selectDept(dept);
+        }
+        restoreUiState(st);
+        QCoreApplication::processEvents();
+
+        //计时范围：槽函数本身 + 它投递出去的布局/重绘事件
+        const AllocCount::Snapshot a0 = AllocCount::now();
+        QElapsedTimer t;
+        t.start();
+        if (op == "onDeptSelectionChanged") {
+            if (selectedDeptId().toInt() != dept) selectDept(dept);
+            else onDeptSelectionChanged();
+        } else if (st.value("arg").isString()) {
+            QMetaObject::invokeMethod(this, op.toLatin1().constData(), Qt::DirectConnection,
+                                      Q_ARG(QString, st.value("arg").toString()));
+        } else if (st.contains("arg")) {
+            QMetaObject::invokeMethod(this, op.toLatin1().constData(), Qt::DirectConnection,
+                                      Q_ARG(bool, st.value("arg").toBool()));
+        } else {
+            QMetaObject::invokeMethod(this, op.toLatin1().constData(), Qt::DirectConnection);
+        }
+        QCoreApplication::processEvents();
+        const qint64 ns = t.nsecsElapsed();
+        const AllocCount::Snapshot a1 = AllocCount::now();
+        stats->add(op, ns, a1.count - a0.count, a1.bytes - a0.bytes);
+    }
+    replaying = false;
+    return skipped;
+}
+
+//CSV 字段转义：含逗号/引号/换行时加引号
+static QString csvField(const QString& s) {
+    if (!s.contains(',') && !s.contains('"') && !s.contains('\n')) return s;
+    QString t = s;
+    t.replace("\"", "\"\"");
+    return "\"" + t + "\"";
+}
+
+//在后台线程导出：只读一份快照，GUI 可以继续编辑
+void MainWindow::exportCsv() {
+    QString path = QFileDialog::getSaveFileName(this, "导出CSV", "employees.csv", "CSV (*.csv)");
+    if (path.isEmpty()) return;
+
+    ConcurrentEmpStore::Snapshot snap = empShared.snapshot();
+    btnExportCsv->setEnabled(false);
+    setStatus(QString("正在后台导出 %1 条员工记录...").arg(snap->size()));
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, path]() {
+        QString err = watcher->result();
+        watcher->deleteLater();
+        btnExportCsv->setEnabled(true);
+        if (!err.isEmpty()) {
+            QMessageBox::warning(this, "导出失败", err);
+            return;
+        }
+        setStatus(QString("已导出：%1").arg(path));
+    });
+
+    watcher->setFuture(QtConcurrent::run([snap, path]() -> QString {
+        TRACE_SCOPE("exportCsv");
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return f.errorString();
+        QTextStream out(&f);
+        out << "no,name,depno,salary\n";
+        snap->forEachInorder([&out](const Emp& e) {
+            out << e.no << ',' << csvField(e.nameString()) << ',' << e.depno << ',' << QString::number(e.salary) << '\n';
+        });
+        out.flush();
+        return f.error() == QFile::NoError ? QString() : f.errorString();
+    }));
 }
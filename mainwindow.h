@@ -4,27 +4,63 @@
 #include <QMainWindow>
 #include <QVariant>
 
-#include "avl.h"
+#include "empindex.h"
 #include "depttree.h"
 #include "dbmanager.h"
-#include <QTreeWidgetItem>
-class QTreeWidget;
+#include "empcolumns.h"
+#include "pavl.h"
+#include "empstore.h"
+#include "sqlpager.h"
+#include "journal.h"
+#include "memusage.h"
+#include "sessionrec.h"
+#include "deptsalary.h"
+#include "empsort.h"
+#include "filterexpr.h"
+#include "viewcache.h"
+#include "salaryhistory.h"
+#include <QFuture>
+class QTreeView;
+class DeptTreeModel;
 class QTableWidget;
 class QLineEdit;
 class QLabel;
 class QPushButton;
+class QCheckBox;
+class QListWidget;
+class QTimer;
+
+//一次日志合并的结果：err 为空表示成功，span 为写库前后的变更序号（段里没有净变化时不写库，为 -1）
+struct JournalCompaction {
+    QString err;
+    ChangeSeqSpan span;
+};
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    //dbFile 为空时使用默认数据目录下的 EmployeeManage.db
+    explicit MainWindow(QWidget *parent = nullptr, const QString& dbFile = QString());
     ~MainWindow() override;
 
+    //把之后的界面操作录制到 path（JSON Lines）
+    bool startRecording(const QString& path, QString* err = nullptr);
+
+    //在当前库上回放一遍录制的操作，每个操作的耗时与分配计入 stats；返回跳过的未知操作数
+    //每遍都要从同一起点开始：调用方每遍用新的库副本新建窗口（见 main.cpp）
+    int replayPass(const QVector<QJsonObject>& ops, OpStats* stats);
+
 private slots:
     // 部门
     void addDeptAsTop();
     void addDeptAsChild();
+    //从 CSV 批量导入部门（depno,name,parent_depno），一个事务写入，部门树只重建一次
+    void importDepartments();
+    void importDepartmentsFrom(const QString& path);
     void onDeptSelectionChanged();
+    void moveSelectedDept();
+    void renameSelectedDept();
+    void deleteSelectedDept();
 
 
 
@@ -37,14 +73,53 @@ private slots:
 
     void sortBySalary();
     void sortByNo();
+    //多列排序，spec 形如 "salary desc, name"（见 EmpSort::parseSpec）
+    void applySortSpec(const QString& spec);
+    void onEmpHeaderClicked(int section);
+    //筛选表达式（见 EmpFilter），空文本取消筛选
+    void applyFilter(const QString& text);
 
     void saveAll();
 
+    void undoEmp();
+    void redoEmp();
+
+    void exportCsv();
+
+    // SQL 直查模式
+    void onSqlModeToggled(bool on);
+    void prevSqlPage();
+    void nextSqlPage();
+
+    // 部门子树批量操作
+    void batchRaisePercent();
+    void batchRaiseAmount();
+    void batchMoveDept();
+    void batchDelete();
+
+    // 部门子树工资排行（前 K 高 / 前 K 低）
+    void showTopPaid();
+    void showLowestPaid();
+    void showSalaryStats();
+    //按日期回看：日期取 editAsOf（空为现在）
+    void showPayrollAsOf();
+    void showEmployeeAsOf();
+
+    // 性能追踪面板
+    void onTraceToggled(bool on);
+    void refreshTracePanel();
+    void exportTrace();
+
+    // 内存占用（状态栏常驻）
+    void refreshMemoryStatus();
+
 private:
     //UI
-    QTreeWidget* treeDepts = nullptr;
+    QTreeView* treeDepts = nullptr;
+    DeptTreeModel* deptModel = nullptr; //懒加载，直接读 deptTree
 
     QTableWidget* tableEmps = nullptr;
+    QLineEdit* editFilter = nullptr;
     QLabel* statusLabel = nullptr;
 
     //员工编辑框
@@ -63,18 +138,107 @@ private:
     QPushButton* btnOrderByNo = nullptr;
 
     QPushButton* btnSaveAll = nullptr;
+    QPushButton* btnUndo = nullptr;
+    QPushButton* btnRedo = nullptr;
+    QPushButton* btnExportCsv = nullptr;
+
+    //部门子树批量操作
+    QLineEdit* editBatchValue = nullptr;
+    QLineEdit* editBatchTargetDep = nullptr;
+    QPushButton* btnBatchRaisePct = nullptr;
+    QPushButton* btnBatchRaiseAmt = nullptr;
+    QPushButton* btnBatchMove = nullptr;
+    QPushButton* btnBatchDelete = nullptr;
+
+    //部门子树工资排行
+    QLineEdit* editTopK = nullptr;
+    QPushButton* btnTopPaid = nullptr;
+    QPushButton* btnLowestPaid = nullptr;
+    QPushButton* btnSalaryStats = nullptr;
+
+    //工资/部门历史
+    QLineEdit* editAsOf = nullptr;
+    QPushButton* btnPayrollAsOf = nullptr;
+    QPushButton* btnEmpAsOf = nullptr;
+
+    //SQL 直查模式
+    QCheckBox* chkSqlMode = nullptr;
+    QPushButton* btnPrevPage = nullptr;
+    QPushButton* btnNextPage = nullptr;
+    QLabel* labelPage = nullptr;
     //新增部门区域
     QLineEdit* editDeptNo = nullptr;
     QLineEdit* editDeptName = nullptr;
     QPushButton* btnAddDeptTop = nullptr;
     QPushButton* btnAddDeptChild = nullptr;
-
+    QPushButton* btnImportDepts = nullptr;
+
+    //调整部门区域（作用于选中部门）
+    QLineEdit* editDeptNewName = nullptr;
+    QLineEdit* editDeptMoveTo = nullptr;
+    QPushButton* btnRenameDept = nullptr;
+    QPushButton* btnMoveDept = nullptr;
+    QPushButton* btnDeleteDept = nullptr;
+
+    //性能追踪面板
+    QCheckBox* chkTrace = nullptr;
+    QListWidget* listTrace = nullptr;
+    QPushButton* btnExportTrace = nullptr;
+    QTimer* traceTimer = nullptr;
+
+    //状态栏内存占用：员工数据版本没变就不重算（遍历主索引要 O(n)）
+    QLabel* labelMem = nullptr;
+    QTimer* memTimer = nullptr;
+    quint64 memReportGen = ~quint64(0);
 
     //DB
     DbManager dbm;
-
-    //主数据：AVL 保存全部员工（按 no 作为 key）
-    AvlTree empAvl;
+    QString dbFile; //打开的数据库文件路径
+
+    //员工变更日志：每次修改先追加到日志（组提交落盘），再由后台合并进 SQLite
+    static const int kJournalGroupCommitMs = 10;
+    static const qint64 kJournalCompactBytes = 4 * 1024 * 1024;
+    ChangeJournal journal;
+    QFuture<JournalCompaction> compactFuture;
+    QTimer* compactTimer = nullptr;
+
+    //增量同步：其它进程（如夜间 HR 同步）写库后，只把变动的行合并进内存
+    qint64 dbDataVersion = -1; //上次看到的 PRAGMA data_version
+    qint64 dbChangeSeq = 0;    //已合并到的变更序号
+    QTimer* pollTimer = nullptr;
+
+    //SQL 直查模式：员工不全量进内存，列表按页从 SQLite 读（只读浏览）
+    bool sqlMode = false;
+    int sqlPage = 0;
+    SqlEmpPager sqlPager{&dbm};
+
+    //主数据：主索引保存全部员工（按 no 作为 key；默认 AVL，可编译期换成 B+ 树）
+    EmpIndex empAvl;
+
+    //与 AVL 同步的持久化版本：O(1) 快照，撤销/重做和后台读者都用它
+    PersistentAvl empVersion;
+
+    //一次员工变更：前后两个版本 + 涉及的工号
+    struct EmpUndo {
+        QString label;
+        PersistentAvl before;
+        PersistentAvl after;
+        QVector<int> nos;
+    };
+    static const int kMaxUndo = 100;
+    QVector<EmpUndo> undoStack;
+    QVector<EmpUndo> redoStack;
+
+    //发布给后台线程（导出/报表）的只读版本，读者不加锁
+    ConcurrentEmpStore empShared;
+
+    //列式副本：过滤/排序/统计用，AVL 变动后按需重建
+    EmpColumns empCols;
+    bool empColsDirty = true;
+
+    //按部门分组的工资有序索引（带子树计数）：前 K 高/低、分位数、分段统计用；已知改动工号时增量维护，整体重载后按需重建
+    DeptSalaryIndex salaryIdx;
+    bool salaryIdxDirty = true;
 
     //部门树（用于左侧展示 + 校验 depno 是否存在）
     DeptTree deptTree;
@@ -89,8 +253,19 @@ private:
     //初始化数据库
     void initDbAndLoad();
 
-    enum SortMode { SortByNo, SortBySalary };
-    SortMode sortMode = SortByNo;
+    //表格排序规则；空或只有工号升序时就是列式存储的自然顺序
+    EmpSortSpec sortSpec;
+    EmpSortCache empSort;
+    void updateSortIndicator();
+
+    //当前生效的筛选表达式（空为不筛选）；编译结果与命中行按表达式缓存
+    QString filterText;
+    EmpFilterCache filterCache;
+
+    //表格行的视图缓存（部门 + 排序 + 筛选），按员工数据与部门树版本作废
+    EmpViewCache viewCache;
+    //表格里当前显示的视图（视图键 + 两个版本号）；SQL 直查、Top-K 等直接填表时清空
+    QString shownViewKey;
 
     //部门
     //如果没有部门，就插入默认部门
@@ -99,6 +274,9 @@ private:
     //从数据库中读取部门信息
     void loadDeptsToTree(int selectDeptId = 0);
 
+    //选中部门：只展开它的祖先路径并滚动到可见
+    void selectDept(int id);
+
     //退回选中部门的id
     QVariant selectedDeptId() const;
 
@@ -111,11 +289,70 @@ private:
 
 
 
-    //将AVL中的员工数据写回数据库
-    void saveEmployeesFromAvlToDb();
+    //日志：启动时把残留的段重放进 SQLite；运行中切段后在后台合并（wait=true 时等合并完成）
+    bool replayJournalIntoDb();
+    void compactJournal(bool wait);
+
+    //库没被别的连接动过时直接返回 false；否则拉取 rowver 之后的变更并就地合并到 AVL / DeptTree
+    //showErrors 为 false 时（定时轮询）不弹框、不等后台合并：本地日志还有记录时只启动合并，下一轮再同步
+    bool syncChangesFromDb(bool showErrors);
+    //后台合并日志（另一个连接）提交之后调用：把同步起点挪过自己写的这段，轮询不再把它当成外部变更
+    void absorbOwnWrite(const ChangeSeqSpan& span);
+    //通过 dbm 自己写库（部门增删改）之后调用：期间没有别的连接提交时，同步起点直接跟到当前序号
+    void noteOwnDbWrite();
 
     //刷新table的显示信息
     void refreshEmployeesByDeptSelection();
+    EmpViewCache::View buildEmpView();
+    void refreshEmployeesFromSql();
+
+    //SQL 直查模式下内存数据不完整，关闭依赖它的编辑入口
+    void setEmpEditingEnabled(bool on);
+
+    //员工数据变动后调用，使派生结构失效；知道改了哪些工号时传进来，工资索引就地更新
+    void invalidateEmpViews();
+    void invalidateEmpViews(const QVector<int>& nos);
+
+    //选中部门子树里工资最高（highest）或最低的 K 人显示到表格
+    void showDeptTopK(bool highest);
+    //工资索引被整体作废过（重载/全清等）时重建
+    void ensureSalaryIndex();
+    //工资分布的分段数
+    static const int kSalaryBuckets = 10;
+
+    //工资/部门历史（emp_history 的内存索引）：查询前先把日志合并进库，再增量读入新记录
+    SalaryHistory salaryHistory;
+    bool syncSalaryHistory(QString* err);
+
+    //员工增删改统一入口（同步持久化版本并记录撤销）
+    bool empInsert(const Emp& e);
+    bool empUpdate(const Emp& e);
+    bool empRemove(int no);
+
+    //对选中部门子树内全部员工做一次批量操作：一次遍历、一个 DB 事务、一条撤销、一次刷新
+    enum class BatchOp { RaisePercent, RaiseAmount, MoveDept, Delete };
+    void runDeptBatch(BatchOp op, double value);
+
+    void pushUndo(const QString& label, const PersistentAvl& before, const QVector<int>& nos);
+    void applyEmpVersion(const PersistentAvl& target, const QVector<int>& nos);
+    void updateUndoButtons();
+
+    //操作录制：槽函数入口调用，返回的 Scope 覆盖整个操作
+    SessionRecorder recorder;
+    SessionRecorder::Scope recordOp(const char* op, const QVariant& arg = QVariant());
+    QJsonObject captureUiState() const;
+    void restoreUiState(const QJsonObject& st);
+
+    //回放时不弹确认框，直接用录制时的选择
+    bool replaying = false;
+    bool replayConfirm = true;
+    bool confirm(const QString& text);
+
+    //各内存存储的占用明细
+    MemReport memoryReport() const;
+
+    //当前员工数据的只读快照（零拷贝，可交给后台线程）
+    PersistentAvl empSnapshot() const { return empVersion; }
 
     //把选中的部门id转换为depno
     int selectedDeptNoForFilter() const;
@@ -123,9 +360,6 @@ private:
     //状态设置
     void setStatus(const QString& s);
 
-    //找到子树
-    void collectDeptNosFromItem(QTreeWidgetItem* item, QSet<int>& out) const;
-
     //过滤子树
     QSet<int> selectedDeptSubtreeNos() const;
 
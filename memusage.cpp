@@ -0,0 +1,71 @@
+#include "memusage.h"
+
+#include <QStringList>
+
+#include "depttree.h"
+
+namespace MemAcct {
+
+void addString(const QString& s, MemUsage* u, Seen* seen) {
+    //capacity 为 0：共享的空串或字面量，不在堆上
+    if (s.capacity() == 0) return;
+    if (seen) {
+        if (seen->contains(s.constData())) return;
+        seen->insert(s.constData());
+    }
+    const qint64 hdr = 24; //sizeof(QArrayData)
+    const qint64 used = hdr + qint64(s.size() + 1) * 2;
+    const qint64 alloc = hdr + qint64(s.capacity() + 1) * 2;
+    u->strings += used;
+    u->slack += heapBlock(alloc) - used;
+}
+
+void addValueExtra(const DeptRow& r, MemUsage* u, Seen* seen) {
+    addString(r.name, u, seen);
+}
+
+QString formatBytes(qint64 bytes) {
+    if (bytes < 1024) return QString("%1 B").arg(bytes);
+    if (bytes < 1024 * 1024) return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+} // namespace MemAcct
+
+MemUsage MemReport::total() const {
+    MemUsage t;
+    for (const auto& l : m_lines) t += l.second;
+    return t;
+}
+
+QString MemReport::summary() const {
+    const MemUsage t = total();
+    return QString("内存约 %1（节点 %2 / 字符串 %3 / 索引 %4 / 余量 %5）")
+        .arg(MemAcct::formatBytes(t.total()))
+        .arg(MemAcct::formatBytes(t.nodes))
+        .arg(MemAcct::formatBytes(t.strings))
+        .arg(MemAcct::formatBytes(t.index))
+        .arg(MemAcct::formatBytes(t.slack));
+}
+
+QString MemReport::table() const {
+    QStringList rows;
+    rows << QString("%1 %2 %3 %4 %5 %6")
+                .arg("存储", -16).arg("节点", 10).arg("字符串", 10)
+                .arg("索引", 10).arg("余量", 10).arg("合计", 10);
+    auto row = [](const QString& name, const MemUsage& u) {
+        return QString("%1 %2 %3 %4 %5 %6")
+            .arg(name, -16)
+            .arg(MemAcct::formatBytes(u.nodes), 10)
+            .arg(MemAcct::formatBytes(u.strings), 10)
+            .arg(MemAcct::formatBytes(u.index), 10)
+            .arg(MemAcct::formatBytes(u.slack), 10)
+            .arg(MemAcct::formatBytes(u.total()), 10);
+    };
+    for (const auto& l : m_lines) rows << row(l.first, l.second);
+    rows << row("合计", total());
+    for (const auto& t : m_transient) {
+        rows << QString("（瞬时）%1 约 %2").arg(t.first).arg(MemAcct::formatBytes(t.second));
+    }
+    return rows.join('\n');
+}
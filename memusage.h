@@ -0,0 +1,129 @@
+#ifndef MEMUSAGE_H
+#define MEMUSAGE_H
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <algorithm>
+#include <vector>
+
+struct DeptRow;
+
+//一个存储的内存占用（字节，估算值，按 64 位 Qt5 + glibc malloc）：
+//  nodes   元素本体（Emp / DeptRow 等结构体自身的字节）
+//  strings 字符串堆数据（QString 的数据块，隐式共享的只计一次）
+//  index   组织结构的开销：子指针、树高、哈希桶、容器头、引用计数块
+//  slack   已分配但没用上的：容量余量、节点空槽、malloc 取整
+struct MemUsage {
+    qint64 nodes = 0;
+    qint64 strings = 0;
+    qint64 index = 0;
+    qint64 slack = 0;
+
+    qint64 total() const { return nodes + strings + index + slack; }
+    MemUsage& operator+=(const MemUsage& o) {
+        nodes += o.nodes;
+        strings += o.strings;
+        index += o.index;
+        slack += o.slack;
+        return *this;
+    }
+};
+
+namespace MemAcct {
+
+//已经计过的共享数据块（QString 数据、持久化树节点），同一块只计一次
+using Seen = QSet<const void*>;
+
+//malloc(n) 实际占用的堆块：加 8 字节块头后按 16 字节取整，最小 32
+inline qint64 heapBlock(qint64 n) {
+    return std::max<qint64>(32, (n + 8 + 15) / 16 * 16);
+}
+
+//QString 的数据块（对象本身算在所属结构体里）；seen 非空时共享的数据只计一次
+void addString(const QString& s, MemUsage* u, Seen* seen = nullptr);
+
+//元素里挂着的堆数据；没有特化的类型什么也不加
+template <class T>
+inline void addValueExtra(const T&, MemUsage*, Seen*) {}
+void addValueExtra(const DeptRow& r, MemUsage* u, Seen* seen);
+
+//QVector 的数据块：元素本体计入 nodes，数组头计入 index，未用容量计入 slack
+template <class T>
+void addVector(const QVector<T>& v, MemUsage* u, Seen* seen = nullptr) {
+    if (v.capacity() == 0) return;
+    if (seen) {
+        if (seen->contains(v.constData())) return;
+        seen->insert(v.constData());
+    }
+    const qint64 hdr = 24; //sizeof(QArrayData)
+    const qint64 used = qint64(v.size()) * qint64(sizeof(T));
+    const qint64 alloc = hdr + qint64(v.capacity()) * qint64(sizeof(T));
+    u->nodes += used;
+    u->index += hdr;
+    u->slack += heapBlock(alloc) - hdr - used;
+    for (const T& x : v) addValueExtra(x, u, seen);
+}
+
+template <class T>
+void addStdVector(const std::vector<T>& v, MemUsage* u) {
+    if (v.capacity() == 0) return;
+    const qint64 used = qint64(v.size()) * qint64(sizeof(T));
+    u->nodes += used;
+    u->slack += heapBlock(qint64(v.capacity()) * qint64(sizeof(T))) - used;
+}
+
+//QMap（Qt5 红黑树）：每个键值对一个节点，节点头 24 字节（父指针+颜色、左右孩子）
+template <class K, class V>
+void addMap(const QMap<K, V>& m, MemUsage* u, Seen* seen = nullptr) {
+    const qint64 node = qint64(sizeof(QMapNode<K, V>));
+    const qint64 payload = qint64(sizeof(K) + sizeof(V));
+    const qint64 n = m.size();
+    u->index += 48 + n * (node - payload); //QMapData 头 + 每个节点的树指针
+    u->nodes += n * payload;
+    u->slack += heapBlock(48) - 48 + n * (heapBlock(node) - node);
+    for (auto it = m.cbegin(); it != m.cend(); ++it) {
+        addValueExtra(it.key(), u, seen);
+        addValueExtra(it.value(), u, seen);
+    }
+}
+
+//QHash（Qt5 链式哈希）：桶数组 + 每个键值对一个节点（next 指针 + 哈希值）
+template <class K, class V>
+void addHash(const QHash<K, V>& h, MemUsage* u) {
+    const qint64 node = qint64(sizeof(QHashNode<K, V>));
+    const qint64 payload = qint64(sizeof(K) + sizeof(V));
+    const qint64 n = h.size();
+    const qint64 buckets = qint64(h.capacity()) * qint64(sizeof(void*));
+    u->index += 48 + buckets + n * (node - payload);
+    u->nodes += n * payload;
+    u->slack += (buckets > 0 ? heapBlock(buckets) - buckets : 0) + n * (heapBlock(node) - node);
+}
+
+//"12.3 MB" 之类
+QString formatBytes(qint64 bytes);
+
+} // namespace MemAcct
+
+//合并报告：每个存储一行，状态栏显示摘要，明细放提示/日志
+class MemReport {
+public:
+    void add(const QString& store, const MemUsage& u) { m_lines.push_back(qMakePair(store, u)); }
+    //不计入合计的参考项（例如一次全量 inorder() 拷贝的瞬时峰值）
+    void addTransient(const QString& what, qint64 bytes) { m_transient.push_back(qMakePair(what, bytes)); }
+
+    const QVector<QPair<QString, MemUsage>>& lines() const { return m_lines; }
+    MemUsage total() const;
+
+    QString summary() const; //一行
+    QString table() const;   //多行明细
+
+private:
+    QVector<QPair<QString, MemUsage>> m_lines;
+    QVector<QPair<QString, qint64>> m_transient;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "namearena.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+NameArena::NameArena(bool intern)
+    : m_intern(intern) {
+    for (auto& c : m_chunks) c.store(nullptr, std::memory_order_relaxed);
+    m_slots.assign(16, 0);
+}
+
+NameArena::~NameArena() {
+    for (auto& c : m_chunks) delete[] c.load(std::memory_order_relaxed);
+}
+
+NameArena& NameArena::global() {
+    static NameArena arena(true);
+    return arena;
+}
+
+void NameArena::clear() {
+    QMutexLocker lock(&m_mu);
+    for (auto& c : m_chunks) delete[] c.exchange(nullptr);
+    m_end = 0;
+    m_chars = 0;
+    m_unique.clear();
+    m_hashes.clear();
+    m_slots.assign(16, 0);
+}
+
+void NameArena::reserve(int names) {
+    if (!m_intern) return;
+    QMutexLocker lock(&m_mu);
+    m_unique.reserve(size_t(names));
+    m_hashes.reserve(size_t(names));
+    size_t want = 16;
+    while (want < size_t(names) * 2) want <<= 1;
+    if (want > m_slots.size()) rehash(want);
+}
+
+//FNV-1a
+quint32 NameArena::hashOf(const ushort* p, int n) {
+    quint32 h = 2166136261u;
+    for (int i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void NameArena::rehash(size_t slots) {
+    m_slots.assign(slots, 0);
+    const size_t mask = slots - 1;
+    for (size_t u = 0; u < m_unique.size(); ++u) {
+        size_t i = m_hashes[u] & mask;
+        while (m_slots[i] != 0) i = (i + 1) & mask;
+        m_slots[i] = quint32(u + 1);
+    }
+}
+
+const ushort* NameArena::data(NameRef r) const {
+    if (r.len == 0) return nullptr;
+    const int k = chunkOf(r.off);
+    return m_chunks[k].load(std::memory_order_acquire) + (r.off - chunkStart(k));
+}
+
+//放到当前块剩余的空间里；放不下就跳到下一块的开头（姓名不跨块，data() 才能直接返回指针）
+NameRef NameArena::store(const ushort* p, int n) {
+    NameRef r;
+    r.len = quint32(n);
+    if (n == 0) {
+        r.off = m_end;
+        return r;
+    }
+    int k = chunkOf(m_end);
+    while (m_end + quint32(n) > chunkStart(k) + chunkSize(k)) {
+        ++k;
+        Q_ASSERT(k < kMaxChunks);
+        m_end = chunkStart(k);
+    }
+    ushort* chunk = m_chunks[k].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new ushort[chunkSize(k)];
+        m_chunks[k].store(chunk, std::memory_order_release);
+    }
+    std::memcpy(chunk + (m_end - chunkStart(k)), p, size_t(n) * sizeof(ushort));
+    r.off = m_end;
+    m_end += quint32(n);
+    m_chars += n;
+    return r;
+}
+
+NameRef NameArena::add(const QString& s) {
+    return add(s.utf16(), s.size());
+}
+
+NameRef NameArena::add(const ushort* p, int n) {
+    n = std::min(n, kMaxLen);
+    QMutexLocker lock(&m_mu);
+    if (!m_intern) return store(p, n);
+
+    const quint32 h = hashOf(p, n);
+    const size_t mask = m_slots.size() - 1;
+    size_t i = h & mask;
+    while (m_slots[i] != 0) {
+        const quint32 u = m_slots[i] - 1;
+        const NameRef& r = m_unique[u];
+        if (m_hashes[u] == h && int(r.len) == n &&
+            (n == 0 || std::memcmp(data(r), p, size_t(n) * sizeof(ushort)) == 0)) {
+            return r; //已存在：共享
+        }
+        i = (i + 1) & mask;
+    }
+
+    const NameRef r = store(p, n);
+    m_unique.push_back(r);
+    m_hashes.push_back(h);
+    //负载超过 1/2 时扩容
+    if (m_unique.size() * 2 > m_slots.size()) rehash(m_slots.size() * 2);
+    else m_slots[i] = quint32(m_unique.size()); //i 停在探测到的第一个空槽
+    return r;
+}
+
+QString NameArena::toString(NameRef r) const {
+    if (r.len == 0) return QString();
+    return QString::fromUtf16(data(r), int(r.len));
+}
+
+bool NameArena::equals(NameRef r, const QString& s) const {
+    if (int(r.len) != s.size()) return false;
+    return r.len == 0 || std::memcmp(data(r), s.utf16(), size_t(r.len) * sizeof(ushort)) == 0;
+}
+
+int NameArena::uniqueCount() const {
+    QMutexLocker lock(&m_mu);
+    return int(m_unique.size());
+}
+
+NameRef NameArena::uniqueAt(int i) const {
+    QMutexLocker lock(&m_mu);
+    return m_unique[size_t(i)];
+}
+
+int NameArena::uniqueIndexOf(NameRef r) const {
+    QMutexLocker lock(&m_mu);
+    //空姓名不占码元，与下一个姓名偏移相同，所以按 (off, len) 比较
+    auto it = std::lower_bound(m_unique.begin(), m_unique.end(), r, [](const NameRef& u, const NameRef& x) {
+        return u.off < x.off || (u.off == x.off && u.len < x.len);
+    });
+    if (it == m_unique.end() || *it != r) return -1;
+    return int(it - m_unique.begin());
+}
+
+qint64 NameArena::qstringFootprint(int len) {
+    //堆块：QArrayData 头 + (len+1) 个码元，再加 malloc 自身 8 字节并按 16 字节取整
+    qint64 heap = qint64(sizeof(QArrayData)) + qint64(len + 1) * 2;
+    heap = (heap + 8 + 15) / 16 * 16;
+    return qint64(sizeof(QString)) + heap;
+}
+
+NameArena::Stats NameArena::stats(int records, qint64 recordChars) const {
+    const MemUsage u = memoryUsage();
+    Stats st;
+    st.names = records;
+    st.unique = uniqueCount();
+    st.arenaBytes = u.total() + qint64(records) * qint64(sizeof(NameRef));
+
+    //按这些记录的平均姓名长度估算逐条 QString 的占用
+    if (records > 0) {
+        const int avgLen = int((recordChars + records / 2) / records);
+        st.qstringBytes = qint64(records) * qstringFootprint(avgLen);
+    }
+    return st;
+}
+
+MemUsage NameArena::memoryUsage() const {
+    QMutexLocker lock(&m_mu);
+    MemUsage u;
+    qint64 allocated = 0;
+    for (int k = 0; k < kMaxChunks; ++k) {
+        if (m_chunks[k].load(std::memory_order_relaxed)) allocated += qint64(chunkSize(k)) * qint64(sizeof(ushort));
+    }
+    u.strings = m_chars * qint64(sizeof(ushort));
+    u.slack = allocated - u.strings;
+
+    MemUsage table;
+    MemAcct::addStdVector(m_slots, &table);
+    MemAcct::addStdVector(m_unique, &table);
+    MemAcct::addStdVector(m_hashes, &table);
+    u.index = table.nodes;
+    u.slack += table.slack;
+    return u;
+}
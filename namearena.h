@@ -0,0 +1,104 @@
+#ifndef NAMEARENA_H
+#define NAMEARENA_H
+
+#include <QMutex>
+#include <QString>
+#include <QtAlgorithms>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+#include "memusage.h"
+
+//姓名句柄：在 NameArena 中的 UTF-16 偏移 + 长度，8 字节
+//驻留的 arena 里相同姓名的句柄相同，比较句柄即比较姓名
+struct NameRef {
+    quint32 off = 0;
+    quint32 len = 0;
+};
+
+inline bool operator==(NameRef a, NameRef b) { return a.off == b.off && a.len == b.len; }
+inline bool operator!=(NameRef a, NameRef b) { return !(a == b); }
+
+//紧凑姓名存储：
+//  所有姓名的 UTF-16 码元存放在若干块里，外部只持有 NameRef
+//  块大小按 2 倍增长、分配后不再移动，已发出的句柄一直有效；读（toString / data / equals）不加锁，
+//  可以与另一个线程的 add() 并发（句柄随员工数据发布，发布本身保证了可见性）
+//  可选对重复姓名做驻留（interning），相同姓名共享同一段数据
+//  只在显示/导出时才转换成 QString
+//  员工姓名统一放在 global() 里；姓名只增不删，占用上限是出现过的不同姓名总长
+class NameArena {
+public:
+    struct Stats {
+        int names = 0;          //统计的记录数
+        int unique = 0;         //arena 里的不同姓名数（含已不再使用的）
+        qint64 arenaBytes = 0;  //码元块 + 驻留表 + 每条记录的 NameRef
+        qint64 qstringBytes = 0;//同样的记录若每条都用独立 QString 的估算占用
+    };
+
+    explicit NameArena(bool intern = true);
+    ~NameArena();
+    NameArena(const NameArena&) = delete;
+    NameArena& operator=(const NameArena&) = delete;
+
+    //员工姓名用的全局 arena（驻留）
+    static NameArena& global();
+
+    //只能在没有句柄还在使用时调用
+    void clear();
+    void reserve(int names);
+
+    //超过 0xFFFF 个码元的部分截掉（与变更日志的上限一致）
+    NameRef add(const QString& s);
+    NameRef add(const ushort* p, int n);
+
+    QString toString(NameRef r) const;
+    const ushort* data(NameRef r) const;
+    bool equals(NameRef r, const QString& s) const;
+
+    //arena 本身的占用；records / recordChars 为当前持有句柄的记录数与它们的姓名总长，用来算对比
+    Stats stats(int records, qint64 recordChars) const;
+
+    //驻留后的不同姓名（按首次出现顺序）；不驻留时为空
+    int uniqueCount() const;
+    NameRef uniqueAt(int i) const;
+    //句柄对应的不同姓名下标：驻留的姓名偏移随下标递增，二分即可；找不到（或不驻留）时返回 -1
+    int uniqueIndexOf(NameRef r) const;
+
+    //码元计入 strings，驻留表计入 index（NameRef 由持有者自己计）
+    MemUsage memoryUsage() const;
+
+    //单个 QString 的估算占用（对象本身 + 堆上的头和数据，按 malloc 16 字节粒度）
+    static qint64 qstringFootprint(int len);
+
+private:
+    //块 k 有 kFirstChunk << k 个码元，起点为 kFirstChunk * (2^k - 1)；20 块正好用满 32 位偏移
+    static constexpr quint32 kFirstChunk = 4096;
+    static constexpr int kMaxChunks = 20;
+    static constexpr int kMaxLen = 0xFFFF;
+
+    static int chunkOf(quint32 off) {
+        return 31 - qCountLeadingZeroBits(quint32(off / kFirstChunk + 1));
+    }
+    static quint32 chunkStart(int k) { return kFirstChunk * ((quint32(1) << k) - 1); }
+    static quint32 chunkSize(int k) { return kFirstChunk << k; }
+
+    //在锁内调用
+    NameRef store(const ushort* p, int n);
+    void rehash(size_t slots);
+    static quint32 hashOf(const ushort* p, int n);
+
+    bool m_intern;
+    std::atomic<ushort*> m_chunks[kMaxChunks];
+    quint32 m_end = 0;      //下一个码元写到哪里
+    qint64 m_chars = 0;     //实际存放的码元数（不含块尾跳过的部分）
+
+    //驻留表与写入位置只在 m_mu 内访问
+    mutable QMutex m_mu;
+    //开放寻址驻留表：槽里存 m_unique 下标 + 1，0 表示空
+    std::vector<quint32> m_slots;
+    std::vector<NameRef> m_unique;
+    std::vector<quint32> m_hashes;
+};
+
+#endif
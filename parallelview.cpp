@@ -0,0 +1,55 @@
+#include "parallelview.h"
+
+#include "trace.h"
+
+namespace ParallelView {
+
+int workerCount() {
+    return std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+}
+
+QVector<int> splitBounds(int n, int parts) {
+    parts = std::max(1, std::min(parts, n));
+    QVector<int> b(parts + 1);
+    for (int i = 0; i <= parts; ++i) b[i] = int(qint64(n) * i / parts);
+    return b;
+}
+
+//分块执行 chunkFn(from, to)，再按块顺序拼接
+template <class ChunkFn>
+static QVector<int> chunkedFilter(int n, ChunkFn chunkFn) {
+    const int workers = workerCount();
+    if (n < kSeqCutoff || workers <= 1) return chunkFn(0, n);
+
+    const QVector<int> bounds = splitBounds(n, workers);
+    QVector<QVector<int>> parts(bounds.size() - 1);
+    QVector<int> jobs(parts.size());
+    for (int i = 0; i < jobs.size(); ++i) jobs[i] = i;
+
+    QtConcurrent::blockingMap(jobs, [&](int& i) {
+        parts[i] = chunkFn(bounds[i], bounds[i + 1]);
+    });
+
+    int total = 0;
+    for (const auto& p : parts) total += p.size();
+    QVector<int> out;
+    out.reserve(total);
+    for (const auto& p : parts) out += p;
+    return out;
+}
+
+QVector<int> filterDeptSet(const EmpColumns& c, const QSet<int>& depnos) {
+    TRACE_SCOPE("parallel.filterDeptSet");
+    return chunkedFilter(c.size(), [&](int from, int to) {
+        return c.filterDeptSet(depnos, from, to);
+    });
+}
+
+QVector<int> filterSalaryRange(const EmpColumns& c, double lo, double hi) {
+    TRACE_SCOPE("parallel.filterSalaryRange");
+    return chunkedFilter(c.size(), [&](int from, int to) {
+        return c.filterSalaryRange(lo, hi, from, to);
+    });
+}
+
+} // namespace ParallelView
@@ -0,0 +1,79 @@
+#ifndef PARALLELVIEW_H
+#define PARALLELVIEW_H
+
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+
+#include "empcolumns.h"
+
+//大视图的并行过滤/排序流水线（Qt 全局线程池）：
+//  过滤：按行号区间分块，各块独立跑向量化内核，再按块顺序拼接（结果仍按 no 升序）
+//  排序：各块并行 std::sort，再逐轮两两并行归并
+//  比较器必须是严格全序（例如工资相同再比 no），这样结果与单线程 std::sort 完全一致
+//  行数低于 kSeqCutoff 或只有一个工作线程时直接走串行
+namespace ParallelView {
+
+const int kSeqCutoff = 1 << 15;
+
+int workerCount();
+
+QVector<int> filterDeptSet(const EmpColumns& c, const QSet<int>& depnos);
+QVector<int> filterSalaryRange(const EmpColumns& c, double lo, double hi);
+
+//把 [0, n) 均分成 parts 段，返回 parts+1 个边界
+QVector<int> splitBounds(int n, int parts);
+
+template <class Less>
+void sortRows(QVector<int>& rows, Less less) {
+    const int n = rows.size();
+    const int workers = workerCount();
+    if (n < kSeqCutoff || workers <= 1) {
+        std::sort(rows.begin(), rows.end(), less);
+        return;
+    }
+
+    int* data = rows.data(); //只 detach 一次，之后各线程只碰自己的区间
+    QVector<int> bounds = splitBounds(n, workers);
+
+    QVector<int> jobs(bounds.size() - 1);
+    for (int i = 0; i < jobs.size(); ++i) jobs[i] = i;
+    QtConcurrent::blockingMap(jobs, [&](int& i) {
+        std::sort(data + bounds[i], data + bounds[i + 1], less);
+    });
+
+    //两两归并，直到只剩一段
+    QVector<int> buf(n);
+    int* src = data;
+    int* dst = buf.data();
+    while (bounds.size() > 2) {
+        const int runs = bounds.size() - 1;
+        QVector<int> pairs((runs + 1) / 2);
+        for (int j = 0; j < pairs.size(); ++j) pairs[j] = j;
+
+        QtConcurrent::blockingMap(pairs, [&](int& j) {
+            const int lo = bounds[2 * j];
+            if (2 * j + 1 >= runs) { //落单的最后一段原样搬过去
+                std::copy(src + lo, src + bounds[2 * j + 1], dst + lo);
+                return;
+            }
+            const int mid = bounds[2 * j + 1];
+            const int hi = bounds[2 * j + 2];
+            std::merge(src + lo, src + mid, src + mid, src + hi, dst + lo, less);
+        });
+
+        QVector<int> next;
+        for (int i = 0; i < bounds.size(); i += 2) next.push_back(bounds[i]);
+        if (next.last() != n) next.push_back(n);
+        bounds = next;
+        std::swap(src, dst);
+    }
+
+    if (src != data) std::copy(src, src + n, data);
+}
+
+} // namespace ParallelView
+
+#endif
@@ -0,0 +1,178 @@
+#include "pavl.h"
+
+#include <algorithm>
+
+PersistentAvl::Node::Node(const Emp& x, NodePtr a, NodePtr b)
+    : e(x), l(std::move(a)), r(std::move(b)) {
+    h = std::max(height(l), height(r)) + 1;
+}
+
+PersistentAvl::NodePtr PersistentAvl::make(const Emp& e, NodePtr l, NodePtr r) {
+    return std::make_shared<const Node>(e, std::move(l), std::move(r));
+}
+
+//以 e 为根、l/r 为左右子树建新节点，必要时做一次单/双旋
+//（l、r 本身都是平衡的，且高度差不超过 2）
+PersistentAvl::NodePtr PersistentAvl::balanced(const Emp& e, NodePtr l, NodePtr r) {
+    const int hl = height(l);
+    const int hr = height(r);
+
+    if (hl > hr + 1) {
+        // LL
+        if (height(l->l) >= height(l->r)) return make(l->e, l->l, make(e, l->r, r));
+        // LR
+        const Node* lr = l->r.get();
+        return make(lr->e, make(l->e, l->l, lr->l), make(e, lr->r, r));
+    }
+    if (hr > hl + 1) {
+        // RR
+        if (height(r->r) >= height(r->l)) return make(r->e, make(e, l, r->l), r->r);
+        // RL
+        const Node* rl = r->l.get();
+        return make(rl->e, make(e, l, rl->l), make(r->e, rl->r, r->r));
+    }
+    return make(e, std::move(l), std::move(r));
+}
+
+PersistentAvl::NodePtr PersistentAvl::insertRec(const NodePtr& n, const Emp& e, bool& ok) {
+    if (!n) { ok = true; return make(e, nullptr, nullptr); }
+    if (e.no < n->e.no) {
+        NodePtr l = insertRec(n->l, e, ok);
+        return ok ? balanced(n->e, l, n->r) : n;
+    }
+    if (e.no > n->e.no) {
+        NodePtr r = insertRec(n->r, e, ok);
+        return ok ? balanced(n->e, n->l, r) : n;
+    }
+    ok = false; // 重复 no
+    return n;
+}
+
+PersistentAvl::NodePtr PersistentAvl::removeMin(const NodePtr& n, Emp& minOut) {
+    if (!n->l) { minOut = n->e; return n->r; }
+    NodePtr l = removeMin(n->l, minOut);
+    return balanced(n->e, l, n->r);
+}
+
+PersistentAvl::NodePtr PersistentAvl::removeRec(const NodePtr& n, int no, bool& ok) {
+    if (!n) { ok = false; return nullptr; }
+    if (no < n->e.no) {
+        NodePtr l = removeRec(n->l, no, ok);
+        return ok ? balanced(n->e, l, n->r) : n;
+    }
+    if (no > n->e.no) {
+        NodePtr r = removeRec(n->r, no, ok);
+        return ok ? balanced(n->e, n->l, r) : n;
+    }
+
+    ok = true;
+    if (!n->l) return n->r;
+    if (!n->r) return n->l;
+
+    Emp succ;
+    NodePtr r = removeMin(n->r, succ);
+    return balanced(succ, n->l, r);
+}
+
+PersistentAvl::NodePtr PersistentAvl::updateRec(const NodePtr& n, const Emp& e, bool& ok) {
+    if (!n) { ok = false; return nullptr; }
+    //key 不变，形状不变，不需要旋转
+    if (e.no < n->e.no) {
+        NodePtr l = updateRec(n->l, e, ok);
+        return ok ? make(n->e, l, n->r) : n;
+    }
+    if (e.no > n->e.no) {
+        NodePtr r = updateRec(n->r, e, ok);
+        return ok ? make(n->e, n->l, r) : n;
+    }
+    ok = true;
+    return make(e, n->l, n->r);
+}
+
+PersistentAvl::NodePtr PersistentAvl::buildRec(const QVector<Emp>& v, int lo, int hi) {
+    if (lo >= hi) return nullptr;
+    int mid = lo + (hi - lo) / 2;
+    NodePtr l = buildRec(v, lo, mid);
+    NodePtr r = buildRec(v, mid + 1, hi);
+    return make(v[mid], l, r);
+}
+
+PersistentAvl PersistentAvl::fromSorted(const QVector<Emp>& sortedByNo) {
+    return PersistentAvl(buildRec(sortedByNo, 0, sortedByNo.size()), sortedByNo.size());
+}
+
+PersistentAvl PersistentAvl::insert(const Emp& e, bool* ok) const {
+    bool done = false;
+    NodePtr root = insertRec(m_root, e, done);
+    if (ok) *ok = done;
+    return done ? PersistentAvl(root, m_size + 1) : *this;
+}
+
+PersistentAvl PersistentAvl::remove(int no, bool* ok) const {
+    bool done = false;
+    NodePtr root = removeRec(m_root, no, done);
+    if (ok) *ok = done;
+    return done ? PersistentAvl(root, m_size - 1) : *this;
+}
+
+PersistentAvl PersistentAvl::update(const Emp& e, bool* ok) const {
+    bool done = false;
+    NodePtr root = updateRec(m_root, e, done);
+    if (ok) *ok = done;
+    return done ? PersistentAvl(root, m_size) : *this;
+}
+
+const Emp* PersistentAvl::find(int no) const {
+    const Node* n = m_root.get();
+    while (n) {
+        if (no < n->e.no) n = n->l.get();
+        else if (no > n->e.no) n = n->r.get();
+        else return &n->e;
+    }
+    return nullptr;
+}
+
+QVector<Emp> PersistentAvl::inorder() const {
+    QVector<Emp> out;
+    out.reserve(m_size);
+    forEachInorder([&out](const Emp& e) { out.push_back(e); });
+    return out;
+}
+
+//make_shared：节点与控制块（虚表指针 + 两个计数）在同一个堆块里
+static const qint64 kCtrlBlockBytes = 16;
+
+MemUsage PersistentAvl::memoryUsage() const {
+    MemUsage u;
+    const qint64 node = qint64(sizeof(Node));
+    const qint64 payload = qint64(sizeof(Emp));
+    u.nodes = m_size * payload;
+    u.index = m_size * (node - payload + kCtrlBlockBytes);
+    u.slack = m_size * (MemAcct::heapBlock(node + kCtrlBlockBytes) - node - kCtrlBlockBytes);
+    return u;
+}
+
+MemUsage PersistentAvl::memoryUsageBeyond(const PersistentAvl& base, MemAcct::Seen* seen) const {
+    MemUsage u;
+    const qint64 node = qint64(sizeof(Node));
+    const qint64 payload = qint64(sizeof(Emp));
+
+    //节点不可变：base 里同一工号的节点若就是这个对象，它的整棵子树都是共享的，不用再往下走
+    QVector<const Node*> stack;
+    stack.push_back(m_root.get());
+    while (!stack.isEmpty()) {
+        const Node* n = stack.takeLast();
+        if (!n || seen->contains(n)) continue;
+        const Emp* b = base.find(n->e.no);
+        if (b == &n->e) continue;
+        seen->insert(n);
+
+        u.nodes += payload;
+        u.index += node - payload + kCtrlBlockBytes;
+        u.slack += MemAcct::heapBlock(node + kCtrlBlockBytes) - node - kCtrlBlockBytes;
+
+        stack.push_back(n->l.get());
+        stack.push_back(n->r.get());
+    }
+    return u;
+}
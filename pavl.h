@@ -0,0 +1,81 @@
+#ifndef PAVL_H
+#define PAVL_H
+
+#include <QVector>
+#include <memory>
+
+#include "avl.h"
+#include "memusage.h"
+
+//持久化（路径复制）AVL：
+//  节点不可变，insert/remove/update 只复制根到目标的 O(log n) 条路径，返回新版本
+//  旧版本保持可读，未改动的子树在各版本之间共享
+//  节点用 shared_ptr 引用计数，最后一个持有它的版本释放时自动回收
+//  拷贝一个 PersistentAvl 就是 O(1) 快照
+class PersistentAvl {
+public:
+    PersistentAvl() = default;
+
+    //由按 no 升序的数组 O(n) 建一棵平衡树
+    static PersistentAvl fromSorted(const QVector<Emp>& sortedByNo);
+
+    //以下操作都不修改当前版本；ok 为 false 时返回的版本与当前相同
+    PersistentAvl insert(const Emp& e, bool* ok = nullptr) const;
+    PersistentAvl remove(int no, bool* ok = nullptr) const;
+    PersistentAvl update(const Emp& e, bool* ok = nullptr) const; //按 e.no 整条替换
+
+    const Emp* find(int no) const;
+
+    QVector<Emp> inorder() const;
+
+    template <class F>
+    void forEachInorder(F&& f) const { forEachRec(m_root.get(), f); }
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    //内存占用（节点与 shared_ptr 控制块）；姓名在 NameArena::global() 里，不在这里计
+    MemUsage memoryUsage() const;
+    //只计 base 里没有的节点（例如撤销历史独占的部分）；seen 在多次调用间去重
+    MemUsage memoryUsageBeyond(const PersistentAvl& base, MemAcct::Seen* seen) const;
+
+    //两个版本是否共享同一个根（即内容完全相同）
+    bool sameAs(const PersistentAvl& o) const { return m_root == o.m_root; }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        Emp e;
+        NodePtr l;
+        NodePtr r;
+        int h = 1;
+        Node(const Emp& x, NodePtr a, NodePtr b);
+    };
+
+    NodePtr m_root;
+    int m_size = 0;
+
+    PersistentAvl(NodePtr root, int size) : m_root(std::move(root)), m_size(size) {}
+
+    static int height(const NodePtr& n) { return n ? n->h : 0; }
+    static NodePtr make(const Emp& e, NodePtr l, NodePtr r);
+    static NodePtr balanced(const Emp& e, NodePtr l, NodePtr r);
+
+    static NodePtr insertRec(const NodePtr& n, const Emp& e, bool& ok);
+    static NodePtr removeRec(const NodePtr& n, int no, bool& ok);
+    static NodePtr removeMin(const NodePtr& n, Emp& minOut);
+    static NodePtr updateRec(const NodePtr& n, const Emp& e, bool& ok);
+    static NodePtr buildRec(const QVector<Emp>& v, int lo, int hi);
+
+    template <class F>
+    static void forEachRec(const Node* n, F& f) {
+        if (!n) return;
+        forEachRec(n->l.get(), f);
+        f(n->e);
+        forEachRec(n->r.get(), f);
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "salaryhistory.h"
+
+#include <algorithm>
+
+void SalaryHistory::clear() {
+    m_log.clear();
+    m_byEmp.clear();
+    m_checkpoints.clear();
+    m_current = Payroll();
+    m_lastId = 0;
+}
+
+void SalaryHistory::append(qint64 id, qint64 ts, int no, int depno, double salary, bool removed) {
+    if (!m_log.empty()) ts = std::max(ts, m_log.back().ts);
+    QVector<int>& mine = m_byEmp[no];
+    Version v;
+    v.ts = ts;
+    v.salary = salary;
+    v.no = no;
+    v.depno = depno;
+    v.prev = mine.isEmpty() ? -1 : mine.last();
+    v.removed = removed;
+    mine.push_back(int(m_log.size()));
+    m_log.push_back(v);
+    m_lastId = id;
+
+    applyTo(&m_current, int(m_log.size()) - 1);
+    if (m_log.size() % kCheckpointEvery == 0) m_checkpoints.push_back(Checkpoint{int(m_log.size()), m_current});
+}
+
+void SalaryHistory::applyTo(Payroll* p, int i) const {
+    const Version& v = m_log[size_t(i)];
+    if (v.prev >= 0) {
+        const Version& old = m_log[size_t(v.prev)];
+        if (!old.removed) {
+            p->count--;
+            p->total -= old.salary;
+            auto it = p->byDept.find(old.depno);
+            if (it != p->byDept.end()) {
+                it->count--;
+                it->total -= old.salary;
+                if (it->count == 0) p->byDept.erase(it); //没人的部门不留，检查点只存有人的部门
+            }
+        }
+    }
+    if (!v.removed) {
+        p->count++;
+        p->total += v.salary;
+        DeptPay& d = p->byDept[v.depno];
+        d.count++;
+        d.total += v.salary;
+    }
+}
+
+int SalaryHistory::countUpTo(qint64 ts) const {
+    auto it = std::upper_bound(m_log.begin(), m_log.end(), ts,
+                               [](qint64 t, const Version& v) { return t < v.ts; });
+    return int(it - m_log.begin());
+}
+
+bool SalaryHistory::employeeAt(int no, qint64 ts, Version* out) const {
+    auto e = m_byEmp.constFind(no);
+    if (e == m_byEmp.constEnd()) return false;
+    const QVector<int>& idx = *e;
+    auto it = std::upper_bound(idx.begin(), idx.end(), ts,
+                               [this](qint64 t, int i) { return t < m_log[size_t(i)].ts; });
+    if (it == idx.begin()) return false; //那时还没有这个人
+    const Version& v = m_log[size_t(*(it - 1))];
+    if (v.removed) return false;
+    if (out) *out = v;
+    return true;
+}
+
+QVector<SalaryHistory::Version> SalaryHistory::versionsOf(int no) const {
+    QVector<Version> out;
+    for (int i : m_byEmp.value(no)) out.push_back(m_log[size_t(i)]);
+    return out;
+}
+
+SalaryHistory::Payroll SalaryHistory::payrollAt(qint64 ts) const {
+    const int upto = countUpTo(ts);
+    if (upto == int(m_log.size())) return m_current;
+
+    //at <= upto 的最后一个检查点；没有时从空状态开始
+    auto cp = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), upto,
+                               [](int n, const Checkpoint& c) { return n < c.at; });
+    Payroll p;
+    int from = 0;
+    if (cp != m_checkpoints.begin()) {
+        --cp;
+        p = cp->payroll;
+        from = cp->at;
+    }
+    for (int i = from; i < upto; ++i) applyTo(&p, i);
+    return p;
+}
+
+MemUsage SalaryHistory::memoryUsage() const {
+    MemUsage u;
+    MemAcct::addStdVector(m_log, &u);
+    MemAcct::addHash(m_byEmp, &u);
+    for (auto it = m_byEmp.cbegin(); it != m_byEmp.cend(); ++it) MemAcct::addVector(it.value(), &u);
+    MemAcct::addStdVector(m_checkpoints, &u);
+    for (const Checkpoint& c : m_checkpoints) MemAcct::addHash(c.payroll.byDept, &u);
+    MemAcct::addHash(m_current.byDept, &u);
+    return u;
+}
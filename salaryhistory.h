@@ -0,0 +1,77 @@
+#ifndef SALARYHISTORY_H
+#define SALARYHISTORY_H
+
+#include <QHash>
+#include <QVector>
+#include <vector>
+
+#include "memusage.h"
+
+//员工工资/部门历史的内存索引（数据来自 emp_history 表，按 id 增量追加）：
+//  日志：每次变化一条 32 字节的增量，只追加，时间非递减；每条记着同一工号的上一条
+//  员工在某一时刻：每个工号一个按时间排好的下标数组，二分找到当时生效的那条，O(log 版本数)
+//  某一时刻的全公司工资：每 kCheckpointEvery 条存一个检查点（总人数、总额、各部门人数与总额），
+//                      从时刻之前最近的检查点往后补至多 kCheckpointEvery 条，不用从头重放
+class SalaryHistory {
+public:
+    //一条增量；salary/depno 为这一刻之后的值（删除时为删除前的值）
+    struct Version {
+        qint64 ts;     //Unix 毫秒
+        double salary;
+        int no;
+        int depno;
+        int prev;      //同一工号的上一条在日志里的下标，-1 为第一条
+        bool removed;
+    };
+
+    struct DeptPay {
+        int count = 0;
+        double total = 0;
+    };
+    struct Payroll {
+        int count = 0;
+        double total = 0;
+        QHash<int, DeptPay> byDept;
+    };
+
+    static const int kCheckpointEvery = 4096;
+
+    void clear();
+
+    //按 id 升序追加；时间比上一条还早（改过系统时钟，或日志里较早的编辑在别的写入之后才合并）时按上一条的时间记，保证日志按时间有序
+    void append(qint64 id, qint64 ts, int no, int depno, double salary, bool removed);
+    qint64 lastId() const { return m_lastId; }
+    int size() const { return int(m_log.size()); }
+    bool isEmpty() const { return m_log.empty(); }
+    //最早一条的时间（没有记录时为 0），早于它的时刻查不到任何员工
+    qint64 firstTs() const { return m_log.empty() ? 0 : m_log.front().ts; }
+
+    //工号 no 在 ts 时刻（含）生效的版本；当时不存在（尚未入职或已删除）返回 false
+    bool employeeAt(int no, qint64 ts, Version* out) const;
+    //工号 no 的全部版本，按时间升序
+    QVector<Version> versionsOf(int no) const;
+
+    //ts 时刻（含）的工资总况
+    Payroll payrollAt(qint64 ts) const;
+
+    MemUsage memoryUsage() const;
+
+private:
+    //把第 i 条增量叠加到 p 上：撤掉同一工号的上一版本，再加上这一版本
+    void applyTo(Payroll* p, int i) const;
+    //ts 时刻（含）之前的增量条数
+    int countUpTo(qint64 ts) const;
+
+    struct Checkpoint {
+        int at; //日志前 at 条叠加后的状态
+        Payroll payroll;
+    };
+
+    std::vector<Version> m_log;
+    QHash<int, QVector<int>> m_byEmp; //工号 -> 日志下标（升序即时间升序）
+    std::vector<Checkpoint> m_checkpoints;
+    Payroll m_current;                //全部日志叠加后的状态，满 kCheckpointEvery 条时存成检查点
+    qint64 m_lastId = 0;
+};
+
+#endif
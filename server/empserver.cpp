@@ -0,0 +1,370 @@
+#include "empserver.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMap>
+#include <QTimer>
+#include <climits>
+
+#include "protocol.h"
+#include "trace.h"
+
+using namespace EmProto;
+
+EmpServer::EmpServer(QObject* parent) : QObject(parent) {
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(1000);
+    connect(pollTimer, &QTimer::timeout, this, &EmpServer::syncChangesFromDb);
+}
+
+EmpServer::~EmpServer() {
+    if (server) server->close();
+    dbm.close();
+}
+
+bool EmpServer::open(const QString& dbFile, QString* err) {
+    TRACE_SCOPE("server.open");
+    if (!dbm.open(dbFile)) {
+        if (err) *err = "无法打开数据库: " + dbFile;
+        return false;
+    }
+    if (!dbm.ensureTables(err)) return false;
+
+    //先记下基线再读全量，中间别人提交的改动下一次轮询会补上
+    dbm.changeSeq(&dbChangeSeq);
+    dbm.dataVersion(&dbDataVersion);
+
+    QVector<DeptRow> rows = dbm.fetchDepartments(err);
+    deptTree.buildFromRows(rows);
+
+    QVector<Emp> emps = dbm.fetchAllEmployees(err);
+    empAvl.clear();
+    for (const auto& e : emps) empAvl.insert(e);
+    salaryIdx.rebuild(empAvl);
+    aggCache.clear();
+
+    pollTimer->start();
+    return true;
+}
+
+bool EmpServer::listen(const QString& socketName, QString* err) {
+    server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    server->setMaxPendingConnections(1024);
+    //上次异常退出留下的 socket 文件
+    QLocalServer::removeServer(socketName);
+    if (!server->listen(socketName)) {
+        if (err) *err = server->errorString();
+        return false;
+    }
+    connect(server, &QLocalServer::newConnection, this, &EmpServer::onNewConnection);
+    return true;
+}
+
+void EmpServer::setPollInterval(int ms) {
+    if (ms <= 0) pollTimer->stop();
+    else pollTimer->setInterval(ms);
+}
+
+void EmpServer::onNewConnection() {
+    while (QLocalSocket* s = server->nextPendingConnection()) {
+        inbuf.insert(s, QByteArray());
+        connect(s, &QLocalSocket::readyRead, this, &EmpServer::onReadyRead);
+        connect(s, &QLocalSocket::disconnected, this, &EmpServer::onDisconnected);
+    }
+}
+
+void EmpServer::onDisconnected() {
+    auto* s = qobject_cast<QLocalSocket*>(sender());
+    if (!s) return;
+    inbuf.remove(s);
+    s->deleteLater();
+}
+
+void EmpServer::onReadyRead() {
+    auto* s = qobject_cast<QLocalSocket*>(sender());
+    if (!s) return;
+    auto it = inbuf.find(s);
+    if (it == inbuf.end()) return;
+
+    QByteArray& buf = it.value();
+    buf.append(s->readAll());
+
+    //把已到齐的帧全部处理完，响应攒在一起只写一次；消费掉的字节最后一次性移除
+    QByteArray out;
+    int consumed = 0;
+    for (;;) {
+        quint32 reqId = 0, bodyLen = 0;
+        quint8 op = 0;
+        bool tooLarge = false;
+        const QByteArray rest = QByteArray::fromRawData(buf.constData() + consumed, buf.size() - consumed);
+        if (!peekFrame(rest, &reqId, &op, &bodyLen, &tooLarge)) {
+            if (tooLarge) {
+                //帧长度明显不对，连接已经失步，直接断开
+                s->abort();
+                return;
+            }
+            break;
+        }
+        handle(reqId, op, rest.constData() + kHeaderBytes, int(bodyLen), &out);
+        consumed += kHeaderBytes + int(bodyLen);
+    }
+    if (consumed > 0) buf.remove(0, consumed);
+    if (!out.isEmpty()) s->write(out);
+}
+
+void EmpServer::handle(quint32 reqId, quint8 op, const char* body, int len, QByteArray* out) {
+    switch (op) {
+    case Ping: endFrame(out, beginFrame(out, reqId, Ok)); break;
+    case Get: handleGet(reqId, body, len, out); break;
+    case List: handleList(reqId, body, len, out); break;
+    case Aggregate: handleAggregate(reqId, body, len, out); break;
+    case Batch: handleBatch(reqId, body, len, out); break;
+    case Memory: handleMemory(reqId, out); break;
+    case TopK: handleTopK(reqId, body, len, out); break;
+    default: endFrame(out, beginFrame(out, reqId, BadRequest)); break;
+    }
+}
+
+void EmpServer::handleGet(quint32 reqId, const char* body, int len, QByteArray* out) {
+    Reader r(body, len);
+    const int no = r.get<qint32>();
+    if (!r.ok()) { endFrame(out, beginFrame(out, reqId, BadRequest)); return; }
+
+    const Emp* e = empAvl.find(no);
+    const int at = beginFrame(out, reqId, e ? Ok : NotFound);
+    if (e) Writer(out).putEmp(*e);
+    endFrame(out, at);
+}
+
+bool EmpServer::subtreeOf(int depno, QSet<int>* out) const {
+    out->clear();
+    if (depno == 0) return true;
+    const int id = deptTree.idOfDepno(depno);
+    if (id < 0) return false;
+    *out = deptTree.subtreeDepnos(id);
+    return true;
+}
+
+void EmpServer::handleList(quint32 reqId, const char* body, int len, QByteArray* out) {
+    TRACE_SCOPE("server.list");
+    Reader r(body, len);
+    const int depno = r.get<qint32>();
+    const int afterNo = r.get<qint32>();
+    const int limit = r.get<quint16>();
+    QSet<int> deps;
+    if (!r.ok()) { endFrame(out, beginFrame(out, reqId, BadRequest)); return; }
+    if (!subtreeOf(depno, &deps)) { endFrame(out, beginFrame(out, reqId, NotFound)); return; }
+
+    const int at = beginFrame(out, reqId, Ok);
+    Writer w(out);
+    const int countAt = out->size();
+    w.put<quint16>(0);
+
+    //按 no 顺序从 afterNo 之后扫，凑够 limit 条即停（keyset 分页，不需要 offset）
+    int n = 0;
+    if (limit > 0 && afterNo < INT_MAX) {
+        empAvl.forEachRange(afterNo + 1, INT_MAX, [&](const Emp& e) {
+            if (depno != 0 && !deps.contains(e.depno)) return true;
+            w.putEmp(e);
+            return ++n < limit;
+        });
+    }
+    qToLittleEndian(quint16(n), out->data() + countAt);
+    endFrame(out, at);
+}
+
+void EmpServer::handleAggregate(quint32 reqId, const char* body, int len, QByteArray* out) {
+    TRACE_SCOPE("server.aggregate");
+    Reader r(body, len);
+    const int depno = r.get<qint32>();
+    if (!r.ok()) { endFrame(out, beginFrame(out, reqId, BadRequest)); return; }
+
+    auto it = aggCache.constFind(depno);
+    if (it == aggCache.constEnd()) {
+        QSet<int> deps;
+        if (!subtreeOf(depno, &deps)) { endFrame(out, beginFrame(out, reqId, NotFound)); return; }
+        EmpAggregate a;
+        empAvl.forEachInorder([&](const Emp& e) {
+            if (depno != 0 && !deps.contains(e.depno)) return;
+            if (a.count == 0 || e.salary < a.min) a.min = e.salary;
+            if (a.count == 0 || e.salary > a.max) a.max = e.salary;
+            a.sum += e.salary;
+            a.count++;
+        });
+        it = aggCache.insert(depno, a);
+    }
+
+    const EmpAggregate& a = it.value();
+    const int at = beginFrame(out, reqId, Ok);
+    Writer w(out);
+    w.put<quint32>(quint32(a.count));
+    w.putF64(a.sum);
+    w.putF64(a.min);
+    w.putF64(a.max);
+    endFrame(out, at);
+}
+
+//部门子树工资前 K 高/低：直接走工资索引，不扫全部员工
+void EmpServer::handleTopK(quint32 reqId, const char* body, int len, QByteArray* out) {
+    TRACE_SCOPE("server.topk");
+    Reader r(body, len);
+    const int depno = r.get<qint32>();
+    const int k = r.get<quint16>();
+    const bool highest = r.get<quint8>() != 0;
+    QSet<int> deps;
+    if (!r.ok()) { endFrame(out, beginFrame(out, reqId, BadRequest)); return; }
+    if (!subtreeOf(depno, &deps)) { endFrame(out, beginFrame(out, reqId, NotFound)); return; }
+
+    const QVector<SalaryKey> top = salaryIdx.topK(deps, k, highest);
+    const int at = beginFrame(out, reqId, Ok);
+    Writer w(out);
+    w.put<quint16>(quint16(top.size()));
+    for (const SalaryKey& key : top) w.putEmp(*empAvl.find(key.no));
+    endFrame(out, at);
+}
+
+void EmpServer::handleBatch(quint32 reqId, const char* body, int len, QByteArray* out) {
+    TRACE_SCOPE("server.batch");
+    Reader r(body, len);
+    const quint32 n = r.get<quint32>();
+
+    //同一工号在一批里出现多次时以最后一次为准
+    QMap<int, Emp> upserts;
+    QMap<int, bool> removes;
+    for (quint32 i = 0; i < n && r.ok(); ++i) {
+        const quint8 kind = r.get<quint8>();
+        const Emp e = r.getEmp();
+        if (!r.ok()) break;
+        if (kind == Upsert) {
+            if (e.no <= 0 || e.nameString().trimmed().isEmpty() || !deptTree.containsDepno(e.depno)) {
+                endFrame(out, beginFrame(out, reqId, BadRequest));
+                return;
+            }
+            removes.remove(e.no);
+            upserts.insert(e.no, e);
+        } else if (kind == Remove) {
+            upserts.remove(e.no);
+            removes.insert(e.no, true);
+        } else {
+            endFrame(out, beginFrame(out, reqId, BadRequest));
+            return;
+        }
+    }
+    if (!r.ok() || !r.atEnd()) { endFrame(out, beginFrame(out, reqId, BadRequest)); return; }
+
+    //先落库（一个事务），成功后再改内存，失败时内存保持原样
+    const QVector<Emp> up = upserts.values().toVector();
+    const QVector<int> del = removes.keys().toVector();
+    QString err;
+    if (!dbm.applyEmployeeChanges(up, del, &err)) {
+        qWarning("batch failed: %s", qPrintable(err));
+        endFrame(out, beginFrame(out, reqId, Failed));
+        return;
+    }
+    for (const auto& e : up) {
+        if (Emp* cur = empAvl.find(e.no)) *cur = e;
+        else empAvl.insert(e);
+        salaryIdx.upsert(e);
+    }
+    for (int no : del) {
+        empAvl.remove(no);
+        salaryIdx.remove(no);
+    }
+    aggCache.clear();
+
+    const int at = beginFrame(out, reqId, Ok);
+    Writer(out).put<quint32>(quint32(up.size() + del.size()));
+    endFrame(out, at);
+}
+
+MemReport EmpServer::memoryReport() const {
+    MemAcct::Seen seen;
+    MemReport rep;
+    rep.add("员工主索引", empAvl.memoryUsage());
+    rep.add("员工姓名 arena", NameArena::global().memoryUsage());
+    rep.add("部门工资索引", salaryIdx.memoryUsage());
+    rep.add("部门树", deptTree.memoryUsage(&seen));
+
+    MemUsage agg;
+    MemAcct::addHash(aggCache, &agg);
+    rep.add("汇总缓存", agg);
+
+    MemUsage conns;
+    MemAcct::addHash(inbuf, &conns);
+    for (auto it = inbuf.cbegin(); it != inbuf.cend(); ++it) {
+        conns.nodes += it.value().size();
+        conns.slack += it.value().capacity() - it.value().size();
+    }
+    rep.add("连接缓冲", conns);
+
+    rep.addTransient("一次全量 inorder() 拷贝",
+                     MemAcct::heapBlock(24 + qint64(empAvl.size()) * qint64(sizeof(Emp))));
+    return rep;
+}
+
+void EmpServer::handleMemory(quint32 reqId, QByteArray* out) {
+    const MemReport rep = memoryReport();
+    const int at = beginFrame(out, reqId, Ok);
+    Writer w(out);
+    w.put<quint16>(quint16(rep.lines().size()));
+    for (const auto& l : rep.lines()) {
+        w.putString(l.first);
+        w.put<qint64>(l.second.nodes);
+        w.put<qint64>(l.second.strings);
+        w.put<qint64>(l.second.index);
+        w.put<qint64>(l.second.slack);
+    }
+    endFrame(out, at);
+}
+
+//与界面程序的 syncChangesFromDb 相同的增量同步，只是没有界面要刷新
+void EmpServer::syncChangesFromDb() {
+    TRACE_SCOPE("server.sync");
+    qint64 dv = 0;
+    QString err;
+    if (!dbm.dataVersion(&dv, &err)) {
+        qWarning("data_version failed: %s", qPrintable(err));
+        return;
+    }
+    //本连接自己的提交不改变 data_version
+    if (dv == dbDataVersion) return;
+    dbDataVersion = dv;
+
+    DbChangeSet cs;
+    if (!dbm.fetchChangesSince(dbChangeSeq, &cs, &err)) {
+        qWarning("fetch changes failed: %s", qPrintable(err));
+        return;
+    }
+    dbChangeSeq = cs.seq;
+    if (cs.isEmpty()) return;
+
+    //部门：先删，再增/改，最后统一调整父节点（父部门可能排在子部门之后才出现）
+    for (int id : cs.deptRemoved) deptTree.removeDept(id);
+    for (const auto& r : cs.depts) {
+        if (deptTree.containsId(r.id)) {
+            deptTree.setDepno(r.id, r.depno);
+            deptTree.renameDept(r.id, r.name);
+        } else {
+            DeptRow top = r;
+            top.parentId = QVariant();
+            deptTree.addDept(top);
+        }
+    }
+    for (const auto& r : cs.depts) {
+        int pid = (r.parentId.isValid() && !r.parentId.isNull()) ? r.parentId.toInt() : 0;
+        if (!deptTree.containsId(pid)) pid = 0;
+        if (deptTree.parentOf(r.id) != pid) deptTree.moveDept(r.id, pid);
+    }
+
+    for (const auto& e : cs.emps) {
+        if (Emp* cur = empAvl.find(e.no)) *cur = e;
+        else empAvl.insert(e);
+        salaryIdx.upsert(e);
+    }
+    for (int no : cs.empRemoved) {
+        empAvl.remove(no);
+        salaryIdx.remove(no);
+    }
+    aggCache.clear();
+}
@@ -0,0 +1,74 @@
+#ifndef EMPSERVER_H
+#define EMPSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include "dbmanager.h"
+#include "deptsalary.h"
+#include "depttree.h"
+#include "empindex.h"
+#include "memusage.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+//无界面查询服务：与界面程序共用 DbManager / DeptTree / 员工主索引，
+//  全部数据进内存，通过本地套接字（Unix domain socket / Windows 命名管道）应答请求，协议见 protocol.h
+//  单线程事件循环：每次 readyRead 把缓冲区里完整的请求帧全部处理完，响应拼成一次写出（流水线）
+//  别的进程（界面程序、其它工具）改了库，定时按 data_version / rowver 增量同步进来
+class EmpServer : public QObject {
+    Q_OBJECT
+public:
+    explicit EmpServer(QObject* parent = nullptr);
+    ~EmpServer() override;
+
+    bool open(const QString& dbFile, QString* err = nullptr);
+    bool listen(const QString& socketName, QString* err = nullptr);
+    void setPollInterval(int ms);
+
+    int employeeCount() const { return empAvl.size(); }
+    int departmentCount() const { return deptTree.allIds().size(); }
+
+    //各内存存储的占用明细（与界面程序状态栏同一套统计）
+    MemReport memoryReport() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void syncChangesFromDb();
+
+private:
+    //处理一个请求帧，响应追加到 out
+    void handle(quint32 reqId, quint8 op, const char* body, int len, QByteArray* out);
+    void handleGet(quint32 reqId, const char* body, int len, QByteArray* out);
+    void handleList(quint32 reqId, const char* body, int len, QByteArray* out);
+    void handleAggregate(quint32 reqId, const char* body, int len, QByteArray* out);
+    void handleBatch(quint32 reqId, const char* body, int len, QByteArray* out);
+    void handleMemory(quint32 reqId, QByteArray* out);
+    void handleTopK(quint32 reqId, const char* body, int len, QByteArray* out);
+
+    //depno 为 0 表示全部；部门不存在返回 false
+    bool subtreeOf(int depno, QSet<int>* out) const;
+
+    DbManager dbm{QStringLiteral("conn_server")};
+    DeptTree deptTree;
+    EmpIndex empAvl;
+    DeptSalaryIndex salaryIdx; //按部门分组的工资索引，随员工改动增量维护
+
+    qint64 dbDataVersion = 0;
+    qint64 dbChangeSeq = 0;
+
+    //部门汇总缓存：任何员工/部门变动都整体作废
+    QHash<int, EmpAggregate> aggCache;
+
+    QLocalServer* server = nullptr;
+    QTimer* pollTimer = nullptr;
+    QHash<QLocalSocket*, QByteArray> inbuf; //每个连接未处理完的字节
+};
+
+#endif
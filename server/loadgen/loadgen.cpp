@@ -0,0 +1,371 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QQueue>
+#include <QSet>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "protocol.h"
+
+//EmployeeServer 压测客户端：
+//  先用一个连接分页取一批真实员工做样本，再开 --clients 个连接，
+//  每个连接保持 --pipeline 个请求在途，共发 --requests 个，按 --mix 的比例混合各种请求
+//  结束时报告吞吐和延迟分位数（从写出请求到读到完整响应）
+//  EmployeeLoadGen --clients 16 --pipeline 8 --requests 20000 --mix get=70,list=20,agg=10,batch=0
+
+using namespace EmProto;
+
+namespace {
+
+QTextStream& out() {
+    static QTextStream s(stdout);
+    return s;
+}
+
+QElapsedTimer g_clock;
+
+struct Mix {
+    int get = 70, list = 20, agg = 10, batch = 0, topk = 0;
+    int total() const { return get + list + agg + batch + topk; }
+};
+
+bool parseMix(const QString& s, Mix* m) {
+    Mix r{0, 0, 0, 0, 0};
+    for (const QString& part : s.split(',', Qt::SkipEmptyParts)) {
+        const QStringList kv = part.split('=');
+        bool ok = false;
+        const int w = kv.value(1).toInt(&ok);
+        if (kv.size() != 2 || !ok || w < 0) return false;
+        const QString k = kv[0].trimmed();
+        if (k == "get") r.get = w;
+        else if (k == "list") r.list = w;
+        else if (k == "agg") r.agg = w;
+        else if (k == "batch") r.batch = w;
+        else if (k == "topk") r.topk = w;
+        else return false;
+    }
+    if (r.total() <= 0) return false;
+    *m = r;
+    return true;
+}
+
+struct Sample {
+    QVector<Emp> emps;
+    QVector<int> depnos; //含 0（全部）
+};
+
+//同步发一个请求、等它的响应（只在压测前后用）
+bool roundTrip(QLocalSocket& s, const QByteArray& req, QByteArray* body, QString* err) {
+    s.write(req);
+    QByteArray buf;
+    quint32 reqId = 0, len = 0;
+    quint8 status = 0;
+    bool tooLarge = false;
+    while (!peekFrame(buf, &reqId, &status, &len, &tooLarge)) {
+        if (tooLarge || !s.waitForReadyRead(5000)) {
+            *err = "no response";
+            return false;
+        }
+        buf.append(s.readAll());
+    }
+    if (status != Ok) {
+        *err = QString("status %1").arg(status);
+        return false;
+    }
+    *body = buf.mid(kHeaderBytes, int(len));
+    return true;
+}
+
+bool connectSync(QLocalSocket& s, const QString& socketName, QString* err) {
+    s.connectToServer(socketName);
+    if (s.waitForConnected(3000)) return true;
+    *err = s.errorString();
+    return false;
+}
+
+//同步取样：按 no 分页把前 n 个员工取回来
+bool takeSample(const QString& socketName, int n, Sample* out, QString* err) {
+    QLocalSocket s;
+    if (!connectSync(s, socketName, err)) return false;
+
+    int afterNo = 0;
+    QSet<int> deps;
+    while (out->emps.size() < n) {
+        QByteArray req, body;
+        const int at = beginFrame(&req, 1, List);
+        Writer w(&req);
+        w.put<qint32>(0);
+        w.put<qint32>(afterNo);
+        w.put<quint16>(quint16(std::min(1000, n - out->emps.size())));
+        endFrame(&req, at);
+        if (!roundTrip(s, req, &body, err)) return false;
+
+        Reader r(body.constData(), body.size());
+        const int cnt = r.get<quint16>();
+        for (int i = 0; i < cnt; ++i) {
+            Emp e = r.getEmp();
+            out->emps.push_back(e);
+            deps.insert(e.depno);
+            afterNo = e.no;
+        }
+        if (cnt == 0) break;
+    }
+
+    out->depnos = deps.values().toVector();
+    out->depnos.push_back(0);
+    return !out->emps.isEmpty();
+}
+
+//服务端各存储的内存占用，与吞吐/延迟一起记录，便于发现内存回归
+bool printServerMemory(const QString& socketName, QString* err) {
+    QLocalSocket s;
+    if (!connectSync(s, socketName, err)) return false;
+    QByteArray req, body;
+    endFrame(&req, beginFrame(&req, 1, Memory));
+    if (!roundTrip(s, req, &body, err)) return false;
+
+    Reader r(body.constData(), body.size());
+    MemReport rep;
+    const int n = r.get<quint16>();
+    for (int i = 0; i < n && r.ok(); ++i) {
+        const QString name = r.getString();
+        MemUsage u;
+        u.nodes = r.get<qint64>();
+        u.strings = r.get<qint64>();
+        u.index = r.get<qint64>();
+        u.slack = r.get<qint64>();
+        rep.add(name, u);
+    }
+    out() << "server memory:\n" << rep.table() << "\n";
+    out().flush();
+    return r.ok();
+}
+
+struct Options {
+    int requests = 20000;
+    int pipeline = 8;
+    int pageSize = 50;
+    int batchSize = 10;
+    Mix mix;
+};
+
+//一个连接：保持 pipeline 个请求在途，响应按顺序返回，所以发送时间排成队列即可
+struct Client {
+    QLocalSocket* sock = nullptr;
+    QByteArray buf;
+    QQueue<qint64> sentAt;
+    std::mt19937 rng;
+    int sent = 0;
+    int done = 0;
+    int errors = 0;
+    QVector<qint64> latNs;
+};
+
+class LoadRun {
+public:
+    LoadRun(const Sample& sample, const Options& opt) : m_sample(sample), m_opt(opt) {}
+
+    void start(const QString& socketName, int clients, quint32 seed) {
+        m_running = clients;
+        for (int i = 0; i < clients; ++i) {
+            auto c = std::make_shared<Client>();
+            c->rng.seed(seed + quint32(i));
+            c->latNs.reserve(m_opt.requests);
+            c->sock = new QLocalSocket(qApp);
+            QObject::connect(c->sock, &QLocalSocket::connected, qApp, [this, c]() { pump(*c); });
+            QObject::connect(c->sock, &QLocalSocket::readyRead, qApp, [this, c]() { onReadyRead(*c); });
+            //连不上或中途断开：按已完成的部分统计
+            QObject::connect(c->sock, &QLocalSocket::disconnected, qApp, [this, c]() { finish(*c); });
+            QObject::connect(c->sock, &QLocalSocket::errorOccurred, qApp,
+                             [this, c](QLocalSocket::LocalSocketError) { finish(*c); });
+            m_clients.push_back(c);
+            c->sock->connectToServer(socketName);
+        }
+    }
+
+    void report(double wallMs) const {
+        QVector<qint64> all;
+        int errors = 0, unfinished = 0;
+        for (const auto& c : m_clients) {
+            all += c->latNs;
+            errors += c->errors;
+            unfinished += m_opt.requests - c->done;
+        }
+        std::sort(all.begin(), all.end());
+        auto pct = [&all](double p) -> double {
+            if (all.isEmpty()) return 0;
+            int i = std::min(all.size() - 1, int(p * all.size()));
+            return all[i] / 1000.0;
+        };
+        out() << QString("requests %1  errors %2  unfinished %3  wall %4 ms  %5 req/s\n")
+                     .arg(all.size())
+                     .arg(errors)
+                     .arg(unfinished)
+                     .arg(wallMs, 0, 'f', 1)
+                     .arg(wallMs > 0 ? all.size() * 1000.0 / wallMs : 0.0, 0, 'f', 0);
+        out() << QString("latency us  p50 %1  p90 %2  p99 %3  p99.9 %4  max %5\n")
+                     .arg(pct(0.50), 0, 'f', 1)
+                     .arg(pct(0.90), 0, 'f', 1)
+                     .arg(pct(0.99), 0, 'f', 1)
+                     .arg(pct(0.999), 0, 'f', 1)
+                     .arg(all.isEmpty() ? 0.0 : all.last() / 1000.0, 0, 'f', 1);
+        out().flush();
+    }
+
+private:
+    const Sample& m_sample;
+    Options m_opt;
+    QVector<std::shared_ptr<Client>> m_clients;
+    int m_running = 0;
+
+    template <class T>
+    const T& pick(const QVector<T>& v, Client& c) {
+        return v[int(c.rng() % quint32(v.size()))];
+    }
+
+    void appendRequest(Client& c, QByteArray* req) {
+        const quint32 reqId = quint32(c.sent);
+        const int roll = int(c.rng() % quint32(m_opt.mix.total()));
+        const Mix& m = m_opt.mix;
+        int at;
+        if (roll < m.get) {
+            at = beginFrame(req, reqId, Get);
+            Writer(req).put<qint32>(pick(m_sample.emps, c).no);
+        } else if (roll < m.get + m.list) {
+            at = beginFrame(req, reqId, List);
+            Writer w(req);
+            w.put<qint32>(pick(m_sample.depnos, c));
+            w.put<qint32>(0);
+            w.put<quint16>(quint16(m_opt.pageSize));
+        } else if (roll < m.get + m.list + m.agg) {
+            at = beginFrame(req, reqId, Aggregate);
+            Writer(req).put<qint32>(pick(m_sample.depnos, c));
+        } else if (roll < m.get + m.list + m.agg + m.topk) {
+            //K 与 list 的页大小相同，便于和“过滤后取一页”对比
+            at = beginFrame(req, reqId, TopK);
+            Writer w(req);
+            w.put<qint32>(pick(m_sample.depnos, c));
+            w.put<quint16>(quint16(m_opt.pageSize));
+            w.put<quint8>(quint8(c.rng() & 1));
+        } else {
+            //写回取样时读到的原值：走完整的写路径，但不改变数据
+            at = beginFrame(req, reqId, Batch);
+            Writer w(req);
+            w.put<quint32>(quint32(m_opt.batchSize));
+            for (int i = 0; i < m_opt.batchSize; ++i) {
+                w.put<quint8>(Upsert);
+                w.putEmp(pick(m_sample.emps, c));
+            }
+        }
+        endFrame(req, at);
+    }
+
+    //补满在途请求，一次写出
+    void pump(Client& c) {
+        QByteArray req;
+        const qint64 now = g_clock.nsecsElapsed();
+        while (c.sent < m_opt.requests && c.sentAt.size() < m_opt.pipeline) {
+            appendRequest(c, &req);
+            c.sentAt.enqueue(now);
+            c.sent++;
+        }
+        if (!req.isEmpty()) c.sock->write(req);
+    }
+
+    void onReadyRead(Client& c) {
+        c.buf.append(c.sock->readAll());
+        int consumed = 0;
+        for (;;) {
+            quint32 reqId = 0, len = 0;
+            quint8 status = 0;
+            bool tooLarge = false;
+            const QByteArray rest = QByteArray::fromRawData(c.buf.constData() + consumed, c.buf.size() - consumed);
+            if (!peekFrame(rest, &reqId, &status, &len, &tooLarge) || c.sentAt.isEmpty()) {
+                if (tooLarge) c.sock->abort();
+                break;
+            }
+            consumed += kHeaderBytes + int(len);
+            c.latNs.push_back(g_clock.nsecsElapsed() - c.sentAt.dequeue());
+            if (status != Ok && status != NotFound) c.errors++;
+            c.done++;
+        }
+        if (consumed > 0) c.buf.remove(0, consumed);
+
+        if (c.done >= m_opt.requests) finish(c);
+        else pump(c);
+    }
+
+    void finish(Client& c) {
+        if (!c.sock) return;
+        c.sock->disconnect();
+        c.sock->disconnectFromServer();
+        c.sock = nullptr;
+        if (--m_running == 0) qApp->quit();
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("EmployeeServer load generator");
+    parser.addHelpOption();
+    QCommandLineOption optSocket(QStringList() << "socket", "local socket name", "name", kDefaultSocket);
+    QCommandLineOption optClients(QStringList() << "clients", "concurrent connections", "n", "16");
+    QCommandLineOption optRequests(QStringList() << "requests", "requests per connection", "n", "20000");
+    QCommandLineOption optPipeline(QStringList() << "pipeline", "requests in flight per connection", "n", "8");
+    QCommandLineOption optMix(QStringList() << "mix", "request mix weights", "get=..,list=..,agg=..,batch=..,topk=..",
+                              "get=70,list=20,agg=10,batch=0");
+    QCommandLineOption optPage(QStringList() << "page", "rows per list request", "n", "50");
+    QCommandLineOption optBatch(QStringList() << "batch-size", "rows per batch request", "n", "10");
+    QCommandLineOption optSample(QStringList() << "sample", "employees sampled for request keys", "n", "10000");
+    QCommandLineOption optSeed(QStringList() << "seed", "random seed", "seed", "42");
+    for (const auto* o : {&optSocket, &optClients, &optRequests, &optPipeline, &optMix, &optPage, &optBatch,
+                          &optSample, &optSeed}) {
+        parser.addOption(*o);
+    }
+    parser.process(app);
+
+    QTextStream err(stderr);
+    Options opt;
+    opt.requests = std::max(1, parser.value(optRequests).toInt());
+    opt.pipeline = std::max(1, parser.value(optPipeline).toInt());
+    opt.pageSize = qBound(1, parser.value(optPage).toInt(), 0xFFFF);
+    opt.batchSize = std::max(1, parser.value(optBatch).toInt());
+    if (!parseMix(parser.value(optMix), &opt.mix)) {
+        err << "bad --mix: " << parser.value(optMix) << "\n";
+        return 1;
+    }
+
+    const QString socketName = parser.value(optSocket);
+    Sample sample;
+    QString msg;
+    if (!takeSample(socketName, std::max(1, parser.value(optSample).toInt()), &sample, &msg)) {
+        err << "sampling failed: " << msg << "\n";
+        return 1;
+    }
+
+    const int clients = std::max(1, parser.value(optClients).toInt());
+    out() << QString("%1 clients x %2 requests, pipeline %3, sample %4 employees / %5 departments\n")
+                 .arg(clients)
+                 .arg(opt.requests)
+                 .arg(opt.pipeline)
+                 .arg(sample.emps.size())
+                 .arg(sample.depnos.size() - 1);
+    out().flush();
+
+    LoadRun run(sample, opt);
+    g_clock.start();
+    run.start(socketName, clients, parser.value(optSeed).toUInt());
+    app.exec();
+    run.report(g_clock.nsecsElapsed() / 1e6);
+    if (!printServerMemory(socketName, &msg)) err << "memory report failed: " << msg << "\n";
+    return 0;
+}
@@ -0,0 +1,20 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = EmployeeLoadGen
+
+INCLUDEPATH += .. ../..
+
+SOURCES += \
+    loadgen.cpp \
+    ../../memusage.cpp \
+    ../../namearena.cpp
+
+HEADERS += \
+    ../protocol.h \
+    ../../avl.h \
+    ../../memusage.h \
+    ../../namearena.h
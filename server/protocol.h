@@ -0,0 +1,153 @@
+#ifndef EMPROTOCOL_H
+#define EMPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtEndian>
+#include <cstring>
+
+#include "avl.h"
+
+//EmployeeServer 本地协议（小端、定长头 + 变长体）：
+//  请求  [u32 体长][u32 reqId][u8 op][体]
+//  响应  [u32 体长][u32 reqId][u8 status][体]
+//  同一连接上可以连发多个请求不等回复（流水线），响应按请求顺序返回，并带回 reqId
+//
+//  op          请求体                                           响应体
+//  Ping        -                                                -
+//  Get         i32 no                                           Emp
+//  List        i32 depno(0=全部) i32 afterNo u16 limit          u16 n, n×Emp（按 no 升序，keyset 分页）
+//  Aggregate   i32 depno(0=全部)                                u32 count, f64 sum, f64 min, f64 max
+//  Batch       u32 n, n×(u8 kind, Emp)  kind: 1=upsert 2=remove  u32 已应用条数
+//  Memory      -                                                u16 n, n×(Str 存储名, i64 nodes, i64 strings, i64 index, i64 slack)
+//  TopK        i32 depno(0=全部) u16 k u8 highest(1=最高 0=最低)  u16 n, n×Emp（按工资从高到低 / 从低到高）
+//
+//  Str = u16 长度, UTF-16 码元
+//  Emp = i32 no, i32 depno, f64 salary, Str 姓名
+namespace EmProto {
+
+enum Op : quint8 { Ping = 0, Get = 1, List = 2, Aggregate = 3, Batch = 4, Memory = 5, TopK = 6 };
+enum Status : quint8 { Ok = 0, NotFound = 1, BadRequest = 2, Failed = 3 };
+enum BatchKind : quint8 { Upsert = 1, Remove = 2 };
+
+const int kHeaderBytes = 9;
+const quint32 kMaxBody = 16 * 1024 * 1024;
+const QString kDefaultSocket = QStringLiteral("employeemanage");
+
+//顺序写
+class Writer {
+public:
+    explicit Writer(QByteArray* out) : m_out(out) {}
+
+    template <class T>
+    void put(T v) {
+        char buf[sizeof(T)];
+        qToLittleEndian(v, buf);
+        m_out->append(buf, int(sizeof(T)));
+    }
+    void putF64(double v) {
+        quint64 bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put<quint64>(bits);
+    }
+    void putString(const QString& s) {
+        const int n = std::min(int(s.size()), 0xFFFF);
+        put<quint16>(quint16(n));
+        const ushort* u = s.utf16();
+        for (int i = 0; i < n; ++i) put<quint16>(u[i]);
+    }
+    void putEmp(const Emp& e) {
+        put<qint32>(e.no);
+        put<qint32>(e.depno);
+        putF64(e.salary);
+        putString(e.nameString());
+    }
+
+private:
+    QByteArray* m_out;
+};
+
+//顺序读，越界时 ok() 变 false，之后读到的都是 0
+class Reader {
+public:
+    Reader(const char* p, int n) : m_p(p), m_n(n) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos >= m_n; }
+
+    template <class T>
+    T get() {
+        if (!need(int(sizeof(T)))) return T(0);
+        T v = qFromLittleEndian<T>(m_p + m_pos);
+        m_pos += int(sizeof(T));
+        return v;
+    }
+    double getF64() {
+        quint64 bits = get<quint64>();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    QString getString() {
+        const int n = get<quint16>();
+        if (!need(n * 2)) return QString();
+        QVector<QChar> s(n);
+        for (int i = 0; i < n; ++i) s[i] = QChar(get<quint16>());
+        return QString(s.constData(), n);
+    }
+    Emp getEmp() {
+        Emp e{};
+        e.no = get<qint32>();
+        e.depno = get<qint32>();
+        e.salary = getF64();
+        e.setName(getString());
+        return e;
+    }
+
+private:
+    const char* m_p;
+    int m_n;
+    int m_pos = 0;
+    bool m_ok = true;
+
+    bool need(int k) {
+        if (m_ok && m_pos + k <= m_n) return true;
+        m_ok = false;
+        return false;
+    }
+};
+
+//帧：先写 9 字节头，体写完后回填长度
+inline int beginFrame(QByteArray* out, quint32 reqId, quint8 opOrStatus) {
+    const int at = out->size();
+    Writer w(out);
+    w.put<quint32>(0);
+    w.put<quint32>(reqId);
+    w.put<quint8>(opOrStatus);
+    return at;
+}
+
+inline void endFrame(QByteArray* out, int at) {
+    qToLittleEndian(quint32(out->size() - at - kHeaderBytes), out->data() + at);
+}
+
+//从 buf 开头取一个完整帧；不完整返回 false。bodyLen 超限时 tooLarge=true
+inline bool peekFrame(const QByteArray& buf, quint32* reqId, quint8* tag, quint32* bodyLen, bool* tooLarge) {
+    *tooLarge = false;
+    if (buf.size() < kHeaderBytes) return false;
+    const char* p = buf.constData();
+    *bodyLen = qFromLittleEndian<quint32>(p);
+    if (*bodyLen > kMaxBody) {
+        *tooLarge = true;
+        return false;
+    }
+    if (quint32(buf.size()) < kHeaderBytes + *bodyLen) return false;
+    *reqId = qFromLittleEndian<quint32>(p + 4);
+    *tag = quint8(p[8]);
+    return true;
+}
+
+} // namespace EmProto
+
+#endif
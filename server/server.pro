@@ -0,0 +1,33 @@
+QT       += core sql network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = EmployeeServer
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    servermain.cpp \
+    empserver.cpp \
+    ../bptree.cpp \
+    ../dbmanager.cpp \
+    ../deptsalary.cpp \
+    ../depttree.cpp \
+    ../memusage.cpp \
+    ../namearena.cpp \
+    ../trace.cpp
+
+HEADERS += \
+    protocol.h \
+    empserver.h \
+    ../avl.h \
+    ../bptree.h \
+    ../dbmanager.h \
+    ../deptsalary.h \
+    ../depttree.h \
+    ../empindex.h \
+    ../memusage.h \
+    ../namearena.h \
+    ../trace.h
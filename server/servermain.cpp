@@ -0,0 +1,72 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+#include "empserver.h"
+#include "protocol.h"
+
+//无界面查询服务
+//  EmployeeServer [--db path] [--socket name] [--poll-ms 1000] [--mem-report-s 0]
+//  默认打开界面程序所用的数据库（同一个 AppDataLocation 下的 EmployeeManage.db）
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    //与界面程序共用数据目录
+    QCoreApplication::setApplicationName("EmployeeManage");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("EmployeeManage headless query server");
+    parser.addHelpOption();
+    const QString defDb = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/EmployeeManage.db";
+    QCommandLineOption optDb(QStringList() << "db", "SQLite database file", "path", defDb);
+    QCommandLineOption optSocket(QStringList() << "socket", "local socket name", "name", EmProto::kDefaultSocket);
+    QCommandLineOption optPoll(QStringList() << "poll-ms", "poll interval for external changes, 0 = off", "ms", "1000");
+    parser.addOption(optDb);
+    parser.addOption(optSocket);
+    QCommandLineOption optMemReport(QStringList() << "mem-report-s", "log memory usage every N seconds, 0 = off",
+                                    "s", "0");
+    parser.addOption(optPoll);
+    parser.addOption(optMemReport);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QString dbFile = parser.value(optDb);
+    if (!QFile::exists(dbFile)) {
+        err << "database not found: " << dbFile << "\n";
+        return 1;
+    }
+
+    EmpServer server;
+    QString msg;
+    if (!server.open(dbFile, &msg)) {
+        err << "open failed: " << msg << "\n";
+        return 1;
+    }
+    server.setPollInterval(parser.value(optPoll).toInt());
+    if (!server.listen(parser.value(optSocket), &msg)) {
+        err << "listen failed: " << msg << "\n";
+        return 1;
+    }
+
+    err << QString("serving %1 employees / %2 departments on %3\n")
+               .arg(server.employeeCount())
+               .arg(server.departmentCount())
+               .arg(parser.value(optSocket));
+    err << server.memoryReport().table() << "\n";
+    err.flush();
+
+    //定时把内存占用打到日志里，便于容量规划和发现内存回归
+    const int memEvery = parser.value(optMemReport).toInt();
+    QTimer memTimer;
+    if (memEvery > 0) {
+        QObject::connect(&memTimer, &QTimer::timeout, [&server, &err]() {
+            err << server.memoryReport().summary() << "\n";
+            err.flush();
+        });
+        memTimer.start(memEvery * 1000);
+    }
+    return app.exec();
+}
@@ -0,0 +1,199 @@
+#include "sessionrec.h"
+
+#include <QDialog>
+#include <QEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+#include <algorithm>
+#include <random>
+
+#include "dbmanager.h"
+
+//---- 录制 ----
+
+bool SessionRecorder::open(const QString& path, QString* err) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (err) *err = m_file.errorString();
+        return false;
+    }
+    m_clock.start();
+    m_depth = 0;
+    return true;
+}
+
+void SessionRecorder::close() {
+    if (m_file.isOpen()) m_file.close();
+}
+
+void SessionRecorder::setConfirm(bool yes) {
+    if (isOpen() && m_depth > 0) m_pending.insert("confirm", yes);
+}
+
+SessionRecorder::Scope::Scope(SessionRecorder* rec, QJsonObject state)
+    : m_rec(rec), m_outer(rec->isOpen() && rec->m_depth == 0) {
+    if (m_outer) {
+        state.insert("ms", rec->m_clock.elapsed());
+        rec->m_pending = state;
+    }
+    rec->m_depth++;
+}
+
+SessionRecorder::Scope::~Scope() {
+    m_rec->m_depth--;
+    if (!m_outer || !m_rec->isOpen()) return;
+    //一行一个操作；每行立即写出，程序崩溃也只丢最后一个操作
+    m_rec->m_file.write(QJsonDocument(m_rec->m_pending).toJson(QJsonDocument::Compact));
+    m_rec->m_file.write("\n");
+    m_rec->m_file.flush();
+    m_rec->m_pending = QJsonObject();
+}
+
+QVector<QJsonObject> readSession(const QString& path, int* badLines, QString* err) {
+    QVector<QJsonObject> out;
+    if (badLines) *badLines = 0;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (err) *err = f.errorString();
+        return out;
+    }
+    while (!f.atEnd()) {
+        const QByteArray line = f.readLine().trimmed();
+        if (line.isEmpty()) continue;
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject() || doc.object().value("op").toString().isEmpty()) {
+            if (badLines) (*badLines)++;
+            continue;
+        }
+        out.push_back(doc.object());
+    }
+    return out;
+}
+
+//---- 统计 ----
+
+void OpStats::add(const QString& op, qint64 ns, quint64 allocs, quint64 allocBytes) {
+    if (!m_ops.contains(op)) m_order << op;
+    Op& o = m_ops[op];
+    o.ns.push_back(ns);
+    o.allocs += allocs;
+    o.bytes += allocBytes;
+    m_totalAllocs += allocs;
+    m_totalBytes += allocBytes;
+}
+
+double OpStats::percentileUs(QVector<qint64> v, double p) {
+    if (v.isEmpty()) return 0;
+    const int i = std::min(v.size() - 1, int(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i] / 1000.0;
+}
+
+QJsonObject OpStats::toJson() const {
+    QJsonObject ops;
+    for (const QString& name : m_order) {
+        const Op& o = m_ops[name];
+        QJsonObject j;
+        j.insert("count", o.ns.size());
+        j.insert("p50Us", percentileUs(o.ns, 0.50));
+        j.insert("p99Us", percentileUs(o.ns, 0.99));
+        j.insert("maxUs", o.ns.isEmpty() ? 0.0 : *std::max_element(o.ns.begin(), o.ns.end()) / 1000.0);
+        j.insert("allocs", double(o.allocs));
+        j.insert("allocBytes", double(o.bytes));
+        ops.insert(name, j);
+    }
+    QJsonObject root;
+    root.insert("ops", ops);
+    root.insert("totalAllocs", double(m_totalAllocs));
+    root.insert("totalAllocBytes", double(m_totalBytes));
+    return root;
+}
+
+QString OpStats::table(const QJsonObject& baseline) const {
+    const QJsonObject base = baseline.value("ops").toObject();
+    QStringList rows;
+    QString head = QString("%1 %2 %3 %4 %5 %6 %7")
+                       .arg("op", -28).arg("count", 6).arg("p50 ms", 10).arg("p99 ms", 10)
+                       .arg("max ms", 10).arg("allocs/op", 10).arg("KB/op", 9);
+    if (!base.isEmpty()) head += QString(" %1 %2").arg("p50 x", 7).arg("p99 x", 7);
+    rows << head;
+
+    for (const QString& name : m_order) {
+        const Op& o = m_ops[name];
+        const int n = o.ns.size();
+        const double p50 = percentileUs(o.ns, 0.50);
+        const double p99 = percentileUs(o.ns, 0.99);
+        const double mx = *std::max_element(o.ns.begin(), o.ns.end()) / 1000.0;
+        QString row = QString("%1 %2 %3 %4 %5 %6 %7")
+                          .arg(name, -28).arg(n, 6)
+                          .arg(p50 / 1000.0, 10, 'f', 3).arg(p99 / 1000.0, 10, 'f', 3).arg(mx / 1000.0, 10, 'f', 3)
+                          .arg(double(o.allocs) / n, 10, 'f', 0)
+                          .arg(double(o.bytes) / n / 1024.0, 9, 'f', 1);
+        //与基线的比值，> 1 表示变慢
+        const QJsonObject b = base.value(name).toObject();
+        if (!b.isEmpty() && b.value("p50Us").toDouble() > 0 && b.value("p99Us").toDouble() > 0) {
+            row += QString(" %1 %2")
+                       .arg(p50 / b.value("p50Us").toDouble(), 7, 'f', 2)
+                       .arg(p99 / b.value("p99Us").toDouble(), 7, 'f', 2);
+        }
+        rows << row;
+    }
+    return rows.join('\n');
+}
+
+//---- 回放辅助 ----
+
+bool DialogDismisser::eventFilter(QObject* obj, QEvent* ev) {
+    if (ev->type() == QEvent::Show) {
+        if (auto* dlg = qobject_cast<QDialog*>(obj)) {
+            //排到对话框自己的事件循环里关掉，相当于用户按了取消
+            m_dismissed++;
+            QTimer::singleShot(0, dlg, [dlg]() { dlg->done(QDialog::Rejected); });
+        }
+    }
+    return QObject::eventFilter(obj, ev);
+}
+
+bool makeSyntheticDb(const QString& path, int employees, int depts, quint32 seed, QString* err) {
+    QFile::remove(path);
+    DbManager db(QStringLiteral("conn_synthetic"));
+    if (!db.open(path)) {
+        if (err) *err = "无法创建数据库: " + path;
+        return false;
+    }
+    bool ok = db.ensureTables(err);
+
+    std::mt19937 rng(seed);
+    QVector<int> depnos;
+    QVector<int> ids;
+    //前几个是顶级部门，其余随机挂在已有部门下，形成深浅不一的树
+    const int tops = std::min(depts, 5);
+    for (int i = 0; ok && i < depts; ++i) {
+        QVariant parent;
+        if (i >= tops) parent = ids[int(rng() % quint32(ids.size()))];
+        int id = 0;
+        const int depno = 100 + i;
+        ok = db.insertDepartment(depno, QString("部门%1").arg(depno), parent, &id, err);
+        ids.push_back(id);
+        depnos.push_back(depno);
+    }
+
+    static const char* kFamily[] = {"张", "王", "李", "赵", "刘", "陈", "杨", "黄", "周", "吴"};
+    static const char* kGiven[] = {"伟", "芳", "娜", "敏", "静", "磊", "强", "洋", "艳", "勇", "军", "杰"};
+    QVector<Emp> emps;
+    emps.reserve(employees);
+    for (int i = 0; ok && i < employees && !depnos.isEmpty(); ++i) {
+        Emp e;
+        e.no = i + 1;
+        e.setName(QString::fromUtf8(kFamily[rng() % 10]) + QString::fromUtf8(kGiven[rng() % 12]) +
+                  QString::fromUtf8(kGiven[rng() % 12]));
+        e.depno = depnos[int(rng() % quint32(depnos.size()))];
+        e.salary = 3000 + int(rng() % 27000);
+        emps.push_back(e);
+    }
+    if (ok) ok = db.replaceAllEmployees(emps, err);
+    db.close();
+    return ok;
+}
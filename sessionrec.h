@@ -0,0 +1,102 @@
+#ifndef SESSIONREC_H
+#define SESSIONREC_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//界面操作录制与回放：
+//  录制：每个界面操作（槽函数）入口记下操作名、当时的输入框内容、选中的部门/员工行，
+//        操作结束时连同确认框的选择写成一行 JSON（JSON Lines）
+//        操作里间接触发的其它槽（例如新增部门后自动选中）不单独记录，回放时会自然重现
+//  回放：在无界面（offscreen）的主窗口上按顺序恢复输入状态并调用同一个槽，
+//        统计每种操作的耗时分布与内存分配次数（见 MainWindow::replayPass 与 main.cpp）
+class SessionRecorder {
+public:
+    SessionRecorder() = default;
+    ~SessionRecorder() { close(); }
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    bool open(const QString& path, QString* err = nullptr);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    //一个操作的录制范围：最外层的 Scope 析构时写出一行
+    class Scope {
+    public:
+        Scope(SessionRecorder* rec, QJsonObject state);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        SessionRecorder* m_rec;
+        bool m_outer;
+    };
+
+    //只有最外层操作需要采集状态
+    bool wantsRecord() const { return isOpen() && m_depth == 0; }
+    //当前操作里确认框的选择
+    void setConfirm(bool yes);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    int m_depth = 0;
+    QJsonObject m_pending;
+};
+
+//读回录制文件；坏行跳过并计数
+QVector<QJsonObject> readSession(const QString& path, int* badLines = nullptr, QString* err = nullptr);
+
+//每种操作的耗时与分配统计
+class OpStats {
+public:
+    void add(const QString& op, qint64 ns, quint64 allocs, quint64 allocBytes);
+
+    //文本表：count / p50 / p99 / max / 每次分配次数与字节；baseline 非空时附上与基线 p50/p99 的比值
+    QString table(const QJsonObject& baseline = QJsonObject()) const;
+    //机器可读的报告，可作为下次回放的 --baseline
+    QJsonObject toJson() const;
+
+    quint64 totalAllocs() const { return m_totalAllocs; }
+    quint64 totalAllocBytes() const { return m_totalBytes; }
+
+private:
+    struct Op {
+        QVector<qint64> ns;
+        quint64 allocs = 0;
+        quint64 bytes = 0;
+    };
+    QStringList m_order; //按首次出现的顺序输出
+    QHash<QString, Op> m_ops;
+    quint64 m_totalAllocs = 0;
+    quint64 m_totalBytes = 0;
+
+    static double percentileUs(QVector<qint64> v, double p);
+};
+
+//回放期间自动关掉弹出的模态对话框（提示/警告），并计数
+class DialogDismisser : public QObject {
+public:
+    explicit DialogDismisser(QObject* parent = nullptr) : QObject(parent) {}
+    int dismissed() const { return m_dismissed; }
+
+protected:
+    bool eventFilter(QObject* obj, QEvent* ev) override;
+
+private:
+    int m_dismissed = 0;
+};
+
+//生成一个确定性的合成库：depts 个部门（随机挂在前面的部门下），employees 个员工
+bool makeSyntheticDb(const QString& path, int employees, int depts, quint32 seed, QString* err = nullptr);
+
+#endif
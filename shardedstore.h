@@ -0,0 +1,178 @@
+#ifndef SHARDEDSTORE_H
+#define SHARDEDSTORE_H
+
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <vector>
+
+#include "avl.h"
+#include "memusage.h"
+
+//按工号区间分片的员工存储：K 个互相独立的员工索引（AvlTree / BPlusTree），分片 i 管 [m_lo[i], m_lo[i+1])
+//  单点操作（insert / remove / find）按工号二分到唯一的分片，树高只有 log(n/K)
+//  整体装载、过滤、工资汇总、导出：各分片在 Qt 全局线程池上并行，再按分片顺序拼接/合并；
+//  分片本身按工号区间排好，拼接结果天然按工号升序，不用再归并
+//  分界在 bulkLoad 时按工号分位数选，各分片大小相近；之后的插入落在哪个区间就进哪个分片，
+//  不自动再平衡，偏得厉害时重新 bulkLoad
+//  与 AvlTree 一样只允许一个线程修改；并行只发生在单个批量调用内部
+template <class Index>
+class ShardedStore {
+public:
+    struct SalaryStats {
+        qint64 count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+    };
+
+    explicit ShardedStore(int shards = 1) { reset(shards); }
+
+    ShardedStore(const ShardedStore&) = delete;
+    ShardedStore& operator=(const ShardedStore&) = delete;
+
+    int shardCount() const { return int(m_shards.size()); }
+    const Index& shard(int i) const { return *m_shards[size_t(i)]; }
+    //分片 i 的最小工号（分片 0 为 INT_MIN）
+    int shardLow(int i) const { return m_lo[size_t(i)]; }
+
+    int size() const {
+        int n = 0;
+        for (const auto& s : m_shards) n += s->size();
+        return n;
+    }
+
+    //清空并改成 shards 个分片（分界全部落在 INT_MIN，等下一次 bulkLoad 重新划分）
+    void reset(int shards) {
+        shards = std::max(1, shards);
+        m_shards.clear();
+        for (int i = 0; i < shards; ++i) m_shards.emplace_back(new Index);
+        m_lo.assign(size_t(shards), INT_MIN);
+    }
+    void clear() { reset(shardCount()); }
+
+    //整体替换：emps 顺序任意，工号不得重复；shards <= 0 时沿用当前分片数
+    //  1. 等距抽样取工号分位数作分界（O(K · 1024 · log)）
+    //  2. 一遍把员工分到各分片的桶里
+    //  3. 各分片并行：桶内按工号排序后依次插入自己的索引
+    void bulkLoad(const QVector<Emp>& emps, int shards = 0) {
+        reset(shards > 0 ? shards : shardCount());
+        const int k = shardCount();
+        const int n = emps.size();
+        if (n == 0) return;
+
+        const int samples = std::min(n, k * 1024);
+        std::vector<int> sample(static_cast<size_t>(samples));
+        for (int i = 0; i < samples; ++i) sample[size_t(i)] = emps[int(qint64(n) * i / samples)].no;
+        std::sort(sample.begin(), sample.end());
+        for (int i = 1; i < k; ++i) m_lo[size_t(i)] = sample[size_t(qint64(samples) * i / k)];
+
+        std::vector<std::vector<Emp>> buckets(static_cast<size_t>(k));
+        for (auto& b : buckets) b.reserve(size_t(n / k + n / (4 * k) + 16));
+        for (const Emp& e : emps) buckets[size_t(shardOf(e.no))].push_back(e);
+
+        forShards([&](int i) {
+            std::vector<Emp>& b = buckets[size_t(i)];
+            std::sort(b.begin(), b.end(), [](const Emp& x, const Emp& y) { return x.no < y.no; });
+            Index& idx = *m_shards[size_t(i)];
+            for (const Emp& e : b) idx.insert(e);
+            std::vector<Emp>().swap(b); //尽早还内存
+        });
+    }
+
+    bool insert(const Emp& e) { return m_shards[size_t(shardOf(e.no))]->insert(e); }
+    bool remove(int no) { return m_shards[size_t(shardOf(no))]->remove(no); }
+    Emp* find(int no) { return m_shards[size_t(shardOf(no))]->find(no); }
+    const Emp* find(int no) const { return m_shards[size_t(shardOf(no))]->find(no); }
+
+    //工号 no 所在的分片
+    int shardOf(int no) const {
+        return int(std::upper_bound(m_lo.begin() + 1, m_lo.end(), no) - (m_lo.begin() + 1));
+    }
+
+    //按工号升序逐个访问（串行）
+    template <class F>
+    void forEachInorder(F&& f) const {
+        for (const auto& s : m_shards) s->forEachInorder(f);
+    }
+
+    //满足 pred 的员工，按工号升序；pred 会在多个线程上同时调用
+    template <class Pred>
+    QVector<Emp> filter(Pred pred) const {
+        std::vector<QVector<Emp>> parts(m_shards.size());
+        forShards([&](int i) {
+            m_shards[size_t(i)]->forEachInorder([&](const Emp& e) {
+                if (pred(e)) parts[size_t(i)].push_back(e);
+            });
+        });
+        int total = 0;
+        for (const auto& p : parts) total += p.size();
+        QVector<Emp> out;
+        out.reserve(total);
+        for (const auto& p : parts) out += p;
+        return out;
+    }
+
+    //全体工资的人数 / 总和 / 最低 / 最高：各分片并行汇总再合并
+    SalaryStats salaryStats() const {
+        std::vector<SalaryStats> parts(m_shards.size());
+        forShards([&](int i) {
+            SalaryStats& st = parts[size_t(i)];
+            m_shards[size_t(i)]->forEachInorder([&st](const Emp& e) {
+                if (st.count == 0 || e.salary < st.min) st.min = e.salary;
+                if (st.count == 0 || e.salary > st.max) st.max = e.salary;
+                st.sum += e.salary;
+                st.count++;
+            });
+        });
+        SalaryStats all;
+        for (const SalaryStats& p : parts) {
+            if (p.count == 0) continue;
+            all.min = all.count == 0 ? p.min : std::min(all.min, p.min);
+            all.max = all.count == 0 ? p.max : std::max(all.max, p.max);
+            all.sum += p.sum;
+            all.count += p.count;
+        }
+        return all;
+    }
+
+    //全部员工按工号升序导出：各分片的起点由前面分片的大小算出，并行直接写进同一个数组
+    QVector<Emp> inorder() const {
+        std::vector<int> offset(m_shards.size() + 1, 0);
+        for (size_t i = 0; i < m_shards.size(); ++i) offset[i + 1] = offset[i] + m_shards[i]->size();
+        QVector<Emp> out(offset.back());
+        Emp* data = out.data();
+        forShards([&](int i) {
+            Emp* p = data + offset[size_t(i)];
+            m_shards[size_t(i)]->forEachInorder([&p](const Emp& e) { *p++ = e; });
+        });
+        return out;
+    }
+
+    MemUsage memoryUsage(MemAcct::Seen* seen = nullptr) const {
+        MemUsage u;
+        for (const auto& s : m_shards) u += s->memoryUsage(seen);
+        u.index += qint64(m_shards.size()) * qint64(sizeof(void*) + sizeof(int));
+        return u;
+    }
+
+private:
+    //每个分片一个任务；只有一个分片时直接在调用线程上做
+    template <class Fn>
+    void forShards(Fn fn) const {
+        if (m_shards.size() == 1) {
+            fn(0);
+            return;
+        }
+        QVector<int> jobs(int(m_shards.size()));
+        for (int i = 0; i < jobs.size(); ++i) jobs[i] = i;
+        QtConcurrent::blockingMap(jobs, [&fn](int& i) { fn(i); });
+    }
+
+    std::vector<std::unique_ptr<Index>> m_shards;
+    std::vector<int> m_lo; //m_lo[i]：分片 i 的最小工号，m_lo[0] 恒为 INT_MIN
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "sqlpager.h"
+
+#include <algorithm>
+
+#include "trace.h"
+
+SqlEmpPager::SqlEmpPager(DbManager* db, int pageSize, int maxCachedRows)
+    : m_db(db), m_pageSize(std::max(1, pageSize)), m_pages(std::max(pageSize, maxCachedRows)) {
+    invalidate();
+}
+
+void SqlEmpPager::setQuery(int rootDeptId, DbManager::EmpOrder order) {
+    if (rootDeptId == m_root && order == m_order) return;
+    m_root = rootDeptId;
+    m_order = order;
+    invalidate();
+}
+
+void SqlEmpPager::invalidate() {
+    m_starts.clear();
+    m_starts.push_back(EmpCursor()); //第 0 页从头开始
+    m_pages.clear();
+    m_pageMem.clear();
+    m_aggValid = false;
+}
+
+bool SqlEmpPager::fetch(int k, QVector<Emp>* out, QString* err) {
+    QString e;
+    QVector<Emp> rows = m_db->fetchEmployeePage(m_root, m_order, m_starts[k], m_pageSize, &e);
+    if (!e.isEmpty()) {
+        if (err) *err = e;
+        return false;
+    }
+
+    //记下一页的起点
+    if (rows.size() == m_pageSize && m_starts.size() == k + 1) {
+        EmpCursor next;
+        next.valid = true;
+        next.no = rows.last().no;
+        next.salary = rows.last().salary;
+        m_starts.push_back(next);
+    }
+
+    if (out) *out = rows;
+    m_pages.insert(k, new QVector<Emp>(rows), std::max(1, int(rows.size())));
+
+    //被 QCache 挤掉的页不再统计
+    for (auto it = m_pageMem.begin(); it != m_pageMem.end();) {
+        if (m_pages.contains(it.key())) ++it;
+        else it = m_pageMem.erase(it);
+    }
+    if (m_pages.contains(k)) {
+        MemUsage u;
+        MemAcct::addVector(rows, &u);
+        m_pageMem.insert(k, u);
+    }
+    return true;
+}
+
+bool SqlEmpPager::page(int k, QVector<Emp>* out, QString* err) {
+    TRACE_SCOPE("sqlPager.page");
+    if (k < 0) k = 0;
+
+    if (const QVector<Emp>* hit = m_pages.object(k)) {
+        if (out) *out = *hit;
+        return true;
+    }
+
+    //起点未知：从最后一个已知起点逐页向后（只为拿到起点，不必全部缓存）
+    while (m_starts.size() <= k) {
+        const int known = m_starts.size() - 1;
+        const int before = m_starts.size();
+        if (!fetch(known, nullptr, err)) return false;
+        if (m_starts.size() == before) { //已到末尾，k 超出范围
+            if (out) out->clear();
+            return true;
+        }
+    }
+    return fetch(k, out, err);
+}
+
+bool SqlEmpPager::aggregate(EmpAggregate* out, QString* err) {
+    if (!m_aggValid) {
+        if (!m_db->aggregateEmployees(m_root, &m_agg, err)) return false;
+        m_aggValid = true;
+    }
+    if (out) *out = m_agg;
+    return true;
+}
+
+int SqlEmpPager::pageCount() {
+    EmpAggregate a;
+    if (!aggregate(&a)) return 0;
+    return int((a.count + m_pageSize - 1) / m_pageSize);
+}
+
+MemUsage SqlEmpPager::memoryUsage() const {
+    MemUsage u;
+    for (auto it = m_pageMem.cbegin(); it != m_pageMem.cend(); ++it) {
+        if (m_pages.contains(it.key())) u += it.value();
+    }
+    //QCache 内部是 QHash<页号, 节点>，每页一个节点（前后链指针 + 成本）
+    u.index += qint64(m_pages.count()) * 48;
+    MemAcct::addVector(m_starts, &u);
+    return u;
+}
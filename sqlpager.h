@@ -0,0 +1,54 @@
+#ifndef SQLPAGER_H
+#define SQLPAGER_H
+
+#include <QCache>
+#include <QHash>
+#include <QVector>
+
+#include "dbmanager.h"
+#include "memusage.h"
+
+//SQL 直查模式的分页器：员工表不整体进内存，按页向 DbManager 要数据
+//  keyset 分页：记住每一页的起点（上一页最后一行的排序键），翻页不用 OFFSET
+//  最近访问的若干页放在 QCache 里（按行数计成本），内存占用有上限
+//  数据库被改写后调用 invalidate()
+class SqlEmpPager {
+public:
+    explicit SqlEmpPager(DbManager* db, int pageSize = 200, int maxCachedRows = 20000);
+
+    //切换查询（部门子树 / 排序方式），相同查询不会清空缓存
+    void setQuery(int rootDeptId, DbManager::EmpOrder order);
+    int rootDeptId() const { return m_root; }
+    DbManager::EmpOrder order() const { return m_order; }
+
+    //第 k 页（0 起）。起点未知时从最近的已知起点顺序向后翻
+    bool page(int k, QVector<Emp>* out, QString* err = nullptr);
+
+    //当前查询的总数与工资汇总（缓存到 invalidate 为止）
+    bool aggregate(EmpAggregate* out, QString* err = nullptr);
+
+    int pageSize() const { return m_pageSize; }
+    int pageCount(); //需要汇总结果，失败返回 0
+
+    void invalidate();
+
+    //缓存页与起点表的内存占用
+    MemUsage memoryUsage() const;
+
+private:
+    DbManager* m_db;
+    int m_pageSize;
+
+    int m_root = 0;
+    DbManager::EmpOrder m_order = DbManager::EmpOrder::ByNo;
+
+    QVector<EmpCursor> m_starts;         //m_starts[k] 为第 k 页起点
+    QCache<int, QVector<Emp>> m_pages;   //页号 -> 行，成本为行数
+    QHash<int, MemUsage> m_pageMem;      //入缓存时记下每页占用（QCache::object 会改动 LRU 顺序，统计时不用它）
+    bool m_aggValid = false;
+    EmpAggregate m_agg;
+
+    bool fetch(int k, QVector<Emp>* out, QString* err);
+};
+
+#endif
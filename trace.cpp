@@ -0,0 +1,124 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace Trace {
+
+std::atomic<bool> g_enabled{ qEnvironmentVariableIntValue("EM_TRACE") != 0 }; //EM_TRACE=0 或非数字时关闭
+
+namespace {
+
+//环形缓冲：写满后覆盖最旧的事件
+const int kCapacity = 1 << 16;
+
+struct Ring {
+    QMutex mu;
+    QVector<Event> buf;
+    int head = 0;   //下一次写入位置
+    int count = 0;
+
+    Ring() { buf.resize(kCapacity); }
+};
+
+Ring& ring() {
+    static Ring r;
+    return r;
+}
+
+QElapsedTimer& clock() {
+    static QElapsedTimer t = [] { QElapsedTimer x; x.start(); return x; }();
+    return t;
+}
+
+//JSON 字符串转义（事件名都是字面量，这里只处理最基本的字符）
+QByteArray jsonEscape(const char* s) {
+    QByteArray out;
+    for (const char* p = s; p && *p; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += *p;
+    }
+    return out;
+}
+
+} // namespace
+
+void setEnabled(bool on) {
+    clock(); //确保时钟在第一次记录前已经启动
+    g_enabled.store(on, std::memory_order_relaxed);
+}
+
+qint64 nowUs() {
+    return clock().nsecsElapsed() / 1000;
+}
+
+void record(const char* name, qint64 startUs, qint64 durUs) {
+    Event e;
+    e.name = name;
+    e.startUs = startUs;
+    e.durUs = durUs;
+    e.tid = quint64(quintptr(QThread::currentThreadId()));
+
+    Ring& r = ring();
+    QMutexLocker lock(&r.mu);
+    r.buf[r.head] = e;
+    r.head = (r.head + 1) % kCapacity;
+    if (r.count < kCapacity) r.count++;
+}
+
+QVector<Event> recent(int n) {
+    Ring& r = ring();
+    QMutexLocker lock(&r.mu);
+    n = qBound(0, n, r.count);
+    QVector<Event> out;
+    out.reserve(n);
+    int start = (r.head - n + kCapacity) % kCapacity;
+    for (int i = 0; i < n; ++i) {
+        out.push_back(r.buf[(start + i) % kCapacity]);
+    }
+    return out;
+}
+
+void clear() {
+    Ring& r = ring();
+    QMutexLocker lock(&r.mu);
+    r.head = 0;
+    r.count = 0;
+}
+
+bool exportChromeJson(const QString& path, QString* err) {
+    QVector<Event> evs = recent(kCapacity);
+
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out;
+    out.reserve(evs.size() * 96 + 64);
+    out += "{\"traceEvents\":[\n";
+    for (int i = 0; i < evs.size(); ++i) {
+        const Event& e = evs[i];
+        out += "{\"name\":\"" + jsonEscape(e.name) + "\",\"cat\":\"em\",\"ph\":\"X\"";
+        out += ",\"ts\":" + QByteArray::number(e.startUs);
+        out += ",\"dur\":" + QByteArray::number(e.durUs);
+        out += ",\"pid\":" + QByteArray::number(pid);
+        out += ",\"tid\":" + QByteArray::number(e.tid);
+        out += (i + 1 < evs.size()) ? "},\n" : "}\n";
+    }
+    out += "],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (f.write(out) != out.size()) {
+        if (err) *err = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace Trace
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+//轻量级耗时追踪：
+//  TRACE_SCOPE("name") 在作用域结束时记录一次耗时事件
+//  未启用时只有一次原子读，几乎无开销；定义 EM_NO_TRACE 可在编译期完全去掉
+//  事件可导出为 Chrome trace_event JSON（chrome://tracing / Perfetto 打开）
+namespace Trace {
+
+struct Event {
+    const char* name = nullptr; //必须是字符串字面量（不拷贝）
+    qint64 startUs = 0;         //相对进程启动的微秒
+    qint64 durUs = 0;
+    quint64 tid = 0;
+};
+
+extern std::atomic<bool> g_enabled;
+
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool on);
+
+qint64 nowUs();
+void record(const char* name, qint64 startUs, qint64 durUs);
+
+//最近 n 条事件（按时间先后）
+QVector<Event> recent(int n);
+void clear();
+
+//导出全部缓存事件为 Chrome trace_event JSON
+bool exportChromeJson(const QString& path, QString* err = nullptr);
+
+class Scope {
+public:
+    explicit Scope(const char* name)
+        : m_name(name), m_start(enabled() ? nowUs() : -1) {}
+    ~Scope() {
+        if (m_start >= 0) record(m_name, m_start, nowUs() - m_start);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_name;
+    qint64 m_start;
+};
+
+} // namespace Trace
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+#ifdef EM_NO_TRACE
+#define TRACE_SCOPE(name) do {} while (0)
+#else
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CAT(_traceScope_, __LINE__)(name)
+#endif
+
+#endif
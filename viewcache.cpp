@@ -0,0 +1,42 @@
+#include "viewcache.h"
+
+const EmpViewCache::View* EmpViewCache::find(const QString& key, quint64 dataGen, quint64 deptGen) {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->dataGen != dataGen || it->deptGen != deptGen) {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    it->lastUse = ++m_tick;
+    return &it->view;
+}
+
+const EmpViewCache::View* EmpViewCache::insert(const QString& key, quint64 dataGen, quint64 deptGen, View v) {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->dataGen != dataGen || it->deptGen != deptGen) it = m_entries.erase(it);
+        else ++it;
+    }
+    if (!m_entries.contains(key) && m_entries.size() >= kMaxEntries) { //淘汰最久没用的
+        auto victim = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+            if (it->lastUse < victim->lastUse) victim = it;
+        m_entries.erase(victim);
+    }
+    Entry e;
+    e.view = std::move(v);
+    e.dataGen = dataGen;
+    e.deptGen = deptGen;
+    e.lastUse = ++m_tick;
+    return &m_entries.insert(key, e)->view;
+}
+
+MemUsage EmpViewCache::memoryUsage() const {
+    MemUsage u;
+    MemAcct::addHash(m_entries, &u);
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        MemAcct::addString(it.key(), &u);
+        MemAcct::addVector(it->view.rows, &u);
+        MemAcct::addString(it->view.filterPlan, &u);
+    }
+    return u;
+}
@@ -0,0 +1,47 @@
+#ifndef VIEWCACHE_H
+#define VIEWCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "empcolumns.h"
+#include "memusage.h"
+
+//员工表视图结果缓存：(选中部门, 排序规则, 筛选表达式) -> 排好序的行号与工资统计
+//  每个条目记下生成时的员工数据版本与部门树版本，任一变了就作废（按 key 查到也不用）
+//  来回切换部门或排序方式时，第二次起不再过滤、排序；满了淘汰最久没用的
+class EmpViewCache {
+public:
+    struct View {
+        QVector<int> rows; //列式副本的行号，已按排序规则排好
+        EmpColumns::SalaryStats stats;
+        QString filterPlan;
+    };
+
+    //命中且两个版本都一致时返回视图，否则 nullptr；返回的指针在下一次 insert/clear 前有效
+    const View* find(const QString& key, quint64 dataGen, quint64 deptGen);
+    //放入新结果；版本已经落后的条目顺便一起清掉（它们不会再命中）
+    const View* insert(const QString& key, quint64 dataGen, quint64 deptGen, View v);
+    void clear() { m_entries.clear(); }
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+    MemUsage memoryUsage() const;
+
+private:
+    struct Entry {
+        View view;
+        quint64 dataGen = 0;
+        quint64 deptGen = 0;
+        quint64 lastUse = 0;
+    };
+    static const int kMaxEntries = 8;
+    QHash<QString, Entry> m_entries;
+    quint64 m_tick = 0;
+    int m_hits = 0;
+    int m_misses = 0;
+};
+
+#endif